@@ -1,5 +1,11 @@
-g++ -o assembler ./src/assembler.cpp
+g++ -o assembler ./src/assembler.cpp ./src/lexer.cpp ./src/reader.cpp ./src/interner.cpp -pthread
 g++ -o linker ./src/linker.cpp
-g++ -o emulator ./src/emulator.cpp
+g++ -o emulator ./src/emulator.cpp ./src/jit.cpp ./src/batch.cpp ./src/lockstep.cpp ./src/aot.cpp -pthread
+g++ -o translator ./src/translator.cpp
+
+# the emulator as a static library for programs that embed it (see the embedding methods in inc/emulator.h)
+mkdir -p lib
+for SOURCE in emulator jit batch lockstep aot; do g++ -c -O2 -DEMULATOR_LIBRARY -o ./lib/${SOURCE}.o ./src/${SOURCE}.cpp; done
+ar rcs ./lib/libemulator.a ./lib/emulator.o ./lib/jit.o ./lib/batch.o ./lib/lockstep.o ./lib/aot.o
 
 # chmod +x ./compile.sh
@@ -0,0 +1,71 @@
+#ifndef AOT_H
+#define AOT_H
+
+#include <ostream>
+#include <functional>
+
+#include "emulator.h"
+
+using namespace std;
+
+/* return values of the translated blocks */
+#define AOT_EXIT_CONTINUE 0
+#define AOT_EXIT_HALT 1
+#define AOT_EXIT_ERROR 2
+
+/* state of the Emulator shared with the translated blocks */
+struct AotContext {
+    short *registers;
+    char *memory;
+    unsigned long long *instructionsRetired;
+    unsigned long long *nextEventCycle; // translated code returns to the dispatcher once it is reached
+    Emulator *emulator;
+};
+
+/* a basic block translated ahead of time (the code is valid only while memory still holds the translated bytes) */
+struct AotBlock {
+    unsigned short address; // the first command
+    unsigned short length;  // bytes of its commands
+    const char *code;       // the translated bytes
+    int (*function)(AotContext &);
+};
+
+/* a linked image and its translation, registered by the unit that the translator generates */
+struct AotProgram {
+    const char *imagePath;      // the translated image (informative)
+    const unsigned char *image; // the image itself, loaded when no input file is given
+    unsigned imageSize;
+    const AotBlock *blocks;
+    unsigned nOfBlocks;
+};
+
+/* runtime of the translated code (src/aot.cpp) */
+struct AotRuntime {
+    static const AotProgram *program; // nullptr - the executable has no translated program
+
+    static bool registerProgram(const AotProgram *);
+    static bool check(function<void(Emulator &)>, ostream &); // the translated program against the interpreter, false on a difference
+
+    /* helpers called from the translated code (0 - continue with the block, otherwise an exit code + 1) */
+    static int execute(AotContext &, unsigned);      // interpreter fallback for the command at the given address
+    static int store(AotContext &, unsigned, short); // a store that overwrote translated code exits the block
+    static void recordFlags(AotContext &, short, char, char, short); // cmp or test (mnemonic, rDst, rSrc, result)
+    static bool jumpCondition(AotContext &, short);  // jeq, jne or jgt
+    static void backwardJump(AotContext &, unsigned); // idle loop detection (the address of the command following the jump)
+
+    static short load(AotContext &c, unsigned address) { // the same word as readFromMemory()
+        return c.memory[address + 1] << 8 | (0xFF & c.memory[address]);
+    }
+};
+
+/* the translated code counts a command before its execution and returns to the dispatcher once an event is due after it */
+#define AOT_RETIRE() (*c.instructionsRetired)++
+#define AOT_EVENTS(nextAddress) \
+    do { \
+        if (*c.instructionsRetired >= *c.nextEventCycle) { \
+            c.registers[R_INDEX::pc] = nextAddress; \
+            return AOT_EXIT_CONTINUE; \
+        } \
+    } while (0)
+
+#endif
@@ -5,6 +5,11 @@
 #include <vector>
 #include <map>
 
+#include "lexer.h"
+#include "reader.h"
+#include "interner.h"
+#include "isa.h"
+
 using namespace std;
 
 class Assembler {
@@ -12,15 +17,18 @@ private:
     string inputFilePath;  // path to the input file
     string outputFilePath; // path to the output file
 
-    vector<string> inputFile;              // cleared input file (without additional spaces, comments etc.)
-    vector<unsigned> inputFileLineNumbers; // line numbers in the input file; the index in the array is the line number in the 'inputFile'
-    unsigned currentLine;                  // current line number
+    SourceReader source;  // lines of the input file
+    unsigned currentLine; // current line number in the input file
 
     bool errorOccurred;
     map<unsigned, string> errorMessages; // the error and the line in which it occurred
 
+    /* names of the symbols and sections - the records below refer to them by their interned ids */
+    StringInterner names;
+    static constexpr unsigned UNDEF = 0, ABS = 1; // name ids of the sections added by the constructor
+
     /* symbol table and more */
-    static unsigned nextSymbolID; // id of the next symbol in the symbol table
+    unsigned nextSymbolID; // id of the next symbol in the symbol table
 
     struct SymbolTableRecord {
         unsigned id; // symbol id
@@ -30,26 +38,28 @@ private:
         bool isLocal;  // is the symbol local or global
         bool isExtern; // is the symbol imported
 
-        string section; // the section in which the symbol is defined
-        string name;    // symbol identifier
+        unsigned section; // the section in which the symbol is defined (name id)
+        unsigned name;    // symbol identifier (name id)
     };
-    map<string, SymbolTableRecord> symbolTable;
+    vector<SymbolTableRecord> symbolTable; // indexed by the symbol id
+    vector<unsigned> symbolOfName;         // name id -> symbol id (StringInterner::NONE - not a symbol)
 
     /* section table and more */
-    static unsigned nextSectionID; // id of the next section in the section table
+    unsigned nextSectionID; // id of the next section in the section table
 
     struct SectionTableRecord {
         unsigned id;     // section id
         unsigned length; // section size
-        string name;     // section identifier
+        unsigned name;   // section identifier (name id)
 
         vector<char> sectionData;
     };
-    map<string, SectionTableRecord> sectionTable;
+    vector<SectionTableRecord> sectionTable; // in the order of the section ids
+    vector<unsigned> sectionOfName;          // name id -> index in the 'sectionTable' (StringInterner::NONE - not a section)
 
     /* forward reference table and more */
     struct ForwardReferenceTableRecord {
-        string section;      // section in which the symbol was used
+        unsigned section;    // section in which the symbol was used (name id)
         unsigned offset;     // offset to the field that needs to be modified, in the 'section'
         bool isLittleEndian; // how do we place bytes starting from 'offset' (directives -> little endian, commands -> big endian)
 
@@ -57,35 +67,40 @@ private:
         // int size; // the number of bytes occupied by the symbol to be modified is always 2 (see the text of the project)
         unsigned currentLine; // for error printing purposes after backpatching()
 
-        string symbol; // identifier of the referenced symbol
+        unsigned symbol; // identifier of the referenced symbol (name id)
     };
     vector<ForwardReferenceTableRecord> forwardReferenceTable;
 
     /* relocation table and more */
     struct RelocationTableRecord {
-        string section;  // section to which the given record is linked
-        unsigned offset; // offset to the first byte of the field to be modified in the 'section'
+        unsigned section; // section to which the given record is linked (name id)
+        unsigned offset;  // offset to the first byte of the field to be modified in the 'section'
 
-        string type;   // relocation type (absolute or PC relative)
-        string symbol; // local symbols -> the name of the section; global symbols -> the name of the symbol itself
+        string_view type; // relocation type (absolute or PC relative)
+        unsigned symbol;  // local symbols -> the name of the section; global symbols -> the name of the symbol itself (name id)
 
         // int addend; // unused
     };
     vector<RelocationTableRecord> relocationTable;
 
     unsigned locationCounter;
-    string currentSection; // name of the current section
+    unsigned currentSection; // name id of the current section (StringInterner::NONE - no section is open)
 
     /* utility methods */
-    int getDecimalFromLiteral(string);
+    unsigned intern(string_view);            // the name id of a symbol or section name
+    SymbolTableRecord *findSymbol(unsigned); // nullptr if the name is not in the symbol table
+    SectionTableRecord &section(unsigned);   // the section of the name (it has to be in the section table)
+    vector<unsigned> symbolsByName();        // symbol ids sorted by the names (the order of the symbol table in the object files)
+    vector<unsigned> sectionsByName();       // 'sectionTable' indices sorted by the names (the order of the text file)
+    int getDecimalFromLiteral(string_view);
     string decimalToHexadecimal(int);
 
     /* processing of the symbol addressing */
-    int absoluteAddressing(string, bool, char); // absolute addressing
-    int relativeAddressing(string);             // pc relative addressing
+    int absoluteAddressing(unsigned, bool, char); // absolute addressing (of the symbol name id)
+    int relativeAddressing(unsigned);             // pc relative addressing (of the symbol name id)
 
     /* methods called by assemble() */
-    bool readFile();
+    bool openFile();
     bool assemblePass();
     bool backpatching();
 
@@ -93,15 +108,34 @@ private:
     bool writeBinaryFile();
 
     /* methods for directives and commands processing - called by assemblePass() */
-    bool addSymbol(string);        // label:
-    bool addSectionSymbol(string); // .section
-    bool addGlobalSymbol(string);  // .global
-    bool addExternSymbol(string);  // .extern
-
-    bool processSkipDirective(string); // .skip
-    bool processWordDirective(string); // .word
+    bool addSymbol(string_view);        // label:
+    bool addSectionSymbol(string_view); // .section
+    bool addGlobalSymbol(string_view);  // .global
+    bool addExternSymbol(string_view);  // .extern
+
+    bool processSkipDirective(string_view); // .skip
+    bool processWordDirective(string_view); // .word
+
+    bool processCommand(Lexer &); // processing an assembler command
+
+    /* parsing of the source lines - called by assemblePass() and processCommand() */
+    enum OPERAND_SYNTAX {
+        operand_register,          // jmp *rX | ldr rD, rX
+        operand_register_indirect, // jmp *[rX] | ldr rD, [rX]
+        operand_immediate,         // jmp <symbol/literal> | ldr rD, $<symbol/literal>
+        operand_pc_relative,       // jmp %<symbol> | ldr rD, %<symbol>
+        operand_displacement,      // jmp *[rX +/- <symbol/literal>] | ldr rD, [rX +/- <symbol/literal>]
+        operand_memory             // jmp *<symbol/literal> | ldr rD, <symbol/literal>
+    };
+    struct Operand {
+        OPERAND_SYNTAX syntax;
+        char rIndex;       // register of the register syntaxes
+        string_view value; // symbol or literal of the payload (a view into the line)
+        char operation;    // '+' or '-' before a displacement
+    };
 
-    bool processCommand(string); // processing an assembler command
+    bool parseList(Lexer &, bool, vector<string_view> &); // ' <s1>,...,<sn>' (symbols) or ' <s1/l1>,...,<sn/ln>'
+    bool parseOperand(Lexer &, bool, Operand &);           // the operand of a jump (true) or a load/store command (false)
 
     /* methods called by writeTextFile() */
     void printSymbolTable(ostream &);
@@ -112,8 +146,8 @@ private:
 public:
     Assembler(string, string); // constructor
 
-    bool assemble();
-    void printErrorMessages();
+    bool assemble(ostream &); // messages are written to the stream
+    void printErrorMessages(ostream &);
 };
 
 #endif
@@ -0,0 +1,63 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <ostream>
+#include <functional>
+
+#include "emulator.h"
+
+using namespace std;
+
+/* batch mode - every image is emulated by its own Emulator, concurrently on a work-stealing thread pool */
+class BatchRunner {
+private:
+    string inputPath; // manifest file or a directory with images
+    vector<string> batchErrors;
+
+    /* an image, its expected final state and the result of its emulation */
+    struct BatchImage {
+        string path;
+        vector<pair<int, short>> expectedRegisters; // R_INDEX and value (psw included)
+
+        string status; // pass, fail (a register differs), error (emulating errors) or timeout (no halt within the instruction limit)
+        unsigned long long instructionsRetired;
+        double wallMilliseconds;
+        vector<string> messages; // differing registers or emulating errors
+    };
+    vector<BatchImage> images;
+
+    /* work-stealing pool - a worker takes images from the front of its own queue and steals from the back of the others */
+    struct WorkQueue {
+        mutex lock;
+        deque<unsigned> images; // indices into 'images'
+    };
+    unsigned nOfThreads;
+    vector<WorkQueue> queues; // one for every worker
+
+    function<void(Emulator &)> configure; // command line options applied to every Emulator
+    double wallMilliseconds;              // of the whole batch
+
+    /* methods called by run() */
+    bool readManifest();                              // lines '<image> [register=value ...]'
+    bool readDirectory();                             // '*.hex' images with optional '*.expected' files next to them
+    bool parseExpectedValues(string, BatchImage &);   // 'register=value' items of a line
+    void worker(unsigned);                            // runs until all queues are empty
+    bool takeImage(unsigned, unsigned &);             // worker index, taken image index
+    void emulateImage(BatchImage &);
+
+public:
+    BatchRunner(string, unsigned, function<void(Emulator &)>); // input path, the number of threads, configuration of an Emulator
+
+    bool run(); // false if the images could not be listed
+    bool allPassed();
+
+    /* printing methods */
+    void printSummary(ostream &); // JSON
+    void printErrorMessages();
+};
+
+#endif
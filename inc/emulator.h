@@ -3,13 +3,23 @@
 
 #include <string>
 #include <vector>
+#include <ostream>
+#include <queue>      // device event queue
+#include <bitset>     // dirty memory pages
+#include <map>        // call graph
+#include <functional> // callbacks of an embedding program
+#include <termios.h>  // terminal settings while the emulator reads the keyboard
+
+#include "isa.h" // commands, their addressing modes and decoding
 
 using namespace std;
 
 /* memory & registers */
-#define MEMORY_SIZE 1 << 16 // 2^16
+#define MEMORY_SIZE (1 << 16) // 2^16
 #define MMAP_REGISTERS_START_ADDRESS 0xFF00
 #define NO_REGISTERS 9 // r[0-7] & psw
+#define MEMORY_PAGE_SIZE 256 // granularity of the dirty memory tracking for snapshots
+#define NO_MEMORY_PAGES ((MEMORY_SIZE) / MEMORY_PAGE_SIZE)
 
 enum R_INDEX {
     r0,
@@ -32,55 +42,72 @@ enum FLAG_MASK {
     n = 1 << 3
 };
 
+enum INTERRUPT_MASK { // psw bits that mask interrupt requests (the initial psw 0x6000 masks the timer and the terminal)
+    tr = 1 << 13, // timer
+    tl = 1 << 14, // terminal
+    i = 1 << 15   // all interrupts (set on the interrupt routine entry)
+};
+
+/* memory mapped device registers */
+#define TERM_OUT_ADDRESS 0xFF00 // a character written here is printed
+#define TERM_IN_ADDRESS 0xFF02  // the last character typed in
+#define TIM_CFG_ADDRESS 0xFF10  // timer period (0 - 500ms, 1 - 1s, 2 - 1.5s, 3 - 2s, 4 - 5s, 5 - 10s, 6 - 30s, 7 - 60s)
+
+/* virtual time - every command takes one cycle of a 1 MHz clock */
+#define CYCLES_PER_MILLISECOND 1000
+#define TERMINAL_POLL_CYCLES 1000 // how often the keyboard is checked for a new character
+
 /* IVT table and its entries */
 #define IVT_ENTRY_PROGRAM_START 0
 #define IVT_ENTRY_INVALID_INSTRUCTION 1
 #define IVT_ENTRY_TIMER 2
 #define IVT_ENTRY_TERMINAL 3
+#define IVT_ENTRY_SEMIHOSTING 7 // int with this entry is a request to the host while semihosting is on (see setSemihostingEnabled())
+#define SEMIHOSTING_MAX_LENGTH 0x7FFF // bytes transferred by one request at most (a count stays apart from -1 in r1)
 
-/* assembler commands */
-enum MNEMONIC {
-    halt = 0x00,
-    _int = 0x10,
-    iret = 0x20,
-    call = 0x30,
-    ret = 0x40,
-    jmp = 0x50,
-    jeq,
-    jne,
-    jgt,
-    xchg = 0x60,
-    add = 0x70,
-    sub,
-    mul,
-    _div,
-    cmp,
-    _not = 0x80,
-    _and,
-    _or,
-    _xor,
-    test,
-    shl = 0x90,
-    shr,
-    ldr_pop = 0xA0, // ldr and pop have the same first byte
-    str_push = 0xB0 // str and push have the same first byte
+/* semihosting requests - the operation in r1, the arguments in r2-r4, the result in r1 (-1 - the request failed) */
+enum SEMIHOSTING_OPERATION {
+    semihosting_write = 1, // r2 - address of the file path (0 - the terminal output), r3 - buffer, r4 - length; r1 <= bytes written
+    semihosting_append,    // like semihosting_write, the file is not truncated
+    semihosting_read,      // r2 - address of the file path, r3 - buffer, r4 - the most bytes read; r1 <= bytes read
+    semihosting_clock      // r1 <= microseconds of the host monotonic clock since the program load (lower word), r2 <= higher word
 };
 
-enum UPDATE_TYPE {
-    no_update,
-    pre_decrement,
-    pre_increment,
-    post_decrement,
-    post_increment
+/* interpreter cores */
+enum ENGINE {
+    switch_engine,   // decoding followed by a switch over the mnemonic (reference implementation)
+    threaded_engine, // direct-threaded dispatch over the predecoded commands
+    jit_engine,      // basic blocks translated to x86-64 code (src/jit.cpp)
+    aot_engine       // basic blocks translated to C++ ahead of time by the translator (src/aot.cpp)
 };
 
-enum ADDRESSING_MODE {
-    immed,
-    regdir,
-    regind,
-    regind_disp,
-    memdir,
-    regdir_disp
+/* formats of the memory dump written after the emulation */
+enum DUMP_FORMAT {
+    no_dump,
+    hex_dump,    // 8 bytes per line, as text (default)
+    bin_dump,    // the raw 64KB
+    sparse_dump, // hex without the lines of zeros
+    diff_dump    // the bytes that differ from the loaded image, one per line
+};
+
+/* superinstructions - idiomatic command sequences executed as one command by the switch engine */
+enum FUSION {
+    no_fusion,
+    ldr_immed_push,      // ldr rX, $imm; push rY
+    ldr_immed_push_call, // ldr rX, $imm; push rY; call operand
+    push_call,           // push rY; call operand
+    pop_ret,             // pop rX; ret
+    cmp_jcc,             // cmp rA, rB; jeq/jne/jgt operand
+    test_jcc,            // test rA, rB; jeq/jne/jgt operand
+    NO_FUSIONS
+};
+
+/* devices with events in the event queue */
+enum DEVICE {
+    timer_device,
+    terminal_device,
+    instruction_limit, // not a device - the emulation stops (see setInstructionLimit())
+    instruction_budget // not a device - run() returns (see run())
 };
 
 /* additional constants */
@@ -88,20 +115,78 @@ enum ADDRESSING_MODE {
 #define WORD 2
 #define LITTLE_ENDIAN_ORDER true
 #define BIG_ENDIAN_ORDER false
+#define MEMORY_DUMP_FILE "emulator_out_memory_sample.hex"
+
+/* profiler report */
+#define PROFILE_HOT_SPOTS 10 // commands and memory pages listed in the report
+#define CALL_GRAPH_MAX_DEPTH 1024 // deeper calls are charged to the deepest frame
+
+/* execution trace */
+#define TRACE_DEFAULT_RECORDS 65536 // the last commands kept in the ring buffer
+#define TRACE_FILE_MAGIC 0x52544D45 // "EMTR"
+
+struct TraceRecord { // a retired command (16B, written to the trace file as it is)
+    unsigned short pc;
+    unsigned char bytes[MAX_COMMAND_LENGTH]; // the command as it was fetched
+    unsigned char length;
+    unsigned char rDst;          // R_INDEX of the rDst field (NO_REGISTERS - the command has none)
+    unsigned char written;       // 1 - the command wrote to memory
+    short rDstValue;             // rDst after the command
+    unsigned short writeAddress; // the last memory write of the command
+    short writeValue;
+};
+
+/* embedding - results of run(), runUntil() and step() */
+enum RUN_RESULT {
+    run_error,   // see getErrors()
+    run_halted,  // the halt command
+    run_limit,   // the instruction budget or the instruction limit was reached
+    run_address  // pc reached the address of runUntil()
+};
+
+enum ERROR_KIND {
+    file_error,      // a file can not be opened, mapped, read or written
+    image_error,     // the input is not a valid image
+    decode_error,    // a command with an invalid encoding
+    execution_error, // a command that can not be executed (e.g. division by zero)
+    state_error      // the request does not fit the state of the emulation (e.g. no snapshot)
+};
+
+struct EmulatorError {
+    ERROR_KIND kind;
+    unsigned short pc;                      // pc when the error was reported (past the fetched command)
+    unsigned long long instructionsRetired; // including the command that failed
+    string message;
+};
+
+typedef function<void(unsigned, bool, short &)> DeviceCallback; // address, write (false - read), value (can be replaced)
+typedef function<bool(int)> InterruptCallback;                  // IVT entry of an int command, true - the routine is not entered
+
+/* device bus - every 256B page of the address space is RAM or belongs to a device (see Emulator::mapDevice()) */
+class BusDevice { // the registers of a device keep their values in memory, so snapshots, dumps and translated code see them
+public:
+    virtual ~BusDevice() {}
+    virtual short read(unsigned, short) = 0;   // address, the stored word -> the word a command reads
+    virtual void write(unsigned, short &) = 0; // address, the word (or byte) about to be stored (it can be changed)
+};
+
+/* JIT engine limits */
+#define JIT_CODE_BUFFER_SIZE (16 << 20) // executable buffer for the translated blocks
+#define JIT_MAX_BLOCK_COMMANDS 64       // longer basic blocks are split
+#define JIT_MAX_BLOCK_SIZE (16 << 10)   // upper bound for the host code of one basic block
 
 class Emulator {
+    friend class LockstepRunner; // runs the commands of many emulators at once (src/lockstep.cpp)
+    friend struct AotRuntime;    // helpers of the ahead-of-time translated code (src/aot.cpp)
+
 private:
     string inputFilePath;
-    vector<string> emulatingErrors;
-
-    /* data structure about the program segment */
-    struct ProgramSegmentData {
-        vector<char> segmentData; // segment data
-        unsigned baseAddress; // proposed location of the program segment in VMEM
-    };
+    const unsigned char *inputImage; // an image in memory instead of the input file (nullptr - none)
+    size_t inputImageSize;
+    vector<EmulatorError> emulatingErrors;
 
     /* elements of the emulated computer system */
-    vector<char> memory;     // memory (addressable unit == 1B)
+    vector<char> memory;     // memory (addressable unit == 1B), the byte past 0xFFFF mirrors address 0 (words at 0xFFFF wrap around)
     vector<short> registers; // 8 GPR and psw registers
 
     /* data about the current command */
@@ -118,13 +203,212 @@ private:
 
         /* fourth and fifth byte (a command payload) */
         short payload; // exists if 'length' == 5
+
+        char length; // command size in bytes (1, 2, 3 or 5)
+
+        const void *handler; // threaded engine handler address (labels-as-values)
+
+        char fusion;        // FUSION of the commands starting here (set in the decode cache only)
+        bool fusionChecked; // fuseCommands() has already looked at the commands following this one
     };
     CommandData cd;
 
+    /* decoded command cache (indexed by the address of the first byte of a command) */
+    bool decodeCacheEnabled;
+    vector<CommandData> decodeCache;
+    vector<char> decodeCacheValid; // 1 if 'decodeCache' holds the command starting at that address
+
+    unsigned long long decodeCacheHits;          // commands taken from the cache instead of being decoded
+    unsigned long long decodeCacheInvalidations; // cached commands dropped because a store overwrote them
+
+    /* superinstructions formed in the decode cache */
+    bool commandFusionEnabled;
+    unsigned long long fusionHits[FUSION::NO_FUSIONS]; // superinstructions executed to the end
+
+    /* lazily evaluated psw flags - cmp, test, shl and shr only record their operands */
+    struct PswFlagsState {
+        bool pending;   // psw does not contain the flags of the last flag-producing command yet
+        short mnemonic; // the last flag-producing command
+        short op1, op2; // its rDst and rSrc values (before the command)
+        short result;
+    };
+    bool lazyFlagsEnabled; // false -> flags are computed eagerly after every flag-producing command
+    PswFlagsState lazyFlags;
+
+    /* devices - their next events are kept in a min-heap on virtual time (cycles) */
+    struct DeviceEvent {
+        unsigned long long cycle; // virtual time of the event
+        char device;              // DEVICE
+
+        bool operator>(const DeviceEvent &other) const { return cycle > other.cycle; }
+    };
+    typedef priority_queue<DeviceEvent, vector<DeviceEvent>, greater<DeviceEvent>> DeviceEventQueue;
+    DeviceEventQueue deviceEvents;
+
+    unsigned long long nextEventCycle;  // cycle of the first event in 'deviceEvents' (0 - interrupts are checked after the current command)
+    unsigned long long timerEventCycle; // the current timer event (a write to tim_cfg leaves the old one in the queue)
+    char interruptRequests;             // a bit for every IVT entry with an unaccepted request
+    unsigned long long timerInterrupts, terminalInterrupts;
+
+    /*
+        idle loops - a backward jump that repeats the state of the previous one can only be left after a device event;
+        this holds only for an iteration without effects outside of the registers and memory, so everything the host
+        sees (callbacks, accesses of mapped devices, semihosting) counts in 'hostEffects' and ends the idle state
+    */
+    struct IdleLoopState {
+        unsigned target;                  // target of the last taken backward jump
+        unsigned long long cycle;         // instructionsRetired at that jump
+        unsigned long long memoryWrites;  // memory has not changed if this is still equal to 'memoryWrites'
+        unsigned long long hostEffects;   // nor has the host seen anything if this is still equal to 'hostEffects'
+        short registers[NO_REGISTERS];
+        PswFlagsState lazyFlags;
+    };
+    bool idleLoopSkipEnabled;
+    IdleLoopState idleLoop;
+    unsigned long long memoryWrites;  // writeToMemory() calls (the CPU, interrupt entries and devices)
+    unsigned long long hostEffects;   // effects of the commands seen by the host
+    unsigned long long skippedCycles; // virtual time that passed without executing the idle loop
+
+    int terminalInputFd;               // file descriptor of the keyboard (-1 - no input)
+    bool terminalInputClosed;          // end of the input
+    bool terminalSettingsSaved;        // the standard input is a terminal switched to the non-canonical mode
+    struct termios savedTerminalSettings;
+
+    /* machine snapshot - a restore copies back only the memory pages written since the snapshot or the previous restore */
+    struct MachineSnapshot {
+        bool taken;
+        vector<char> memory;
+        vector<short> registers;
+        PswFlagsState lazyFlags;
+        DeviceEventQueue deviceEvents;
+        unsigned long long nextEventCycle, timerEventCycle;
+        char interruptRequests;
+        IdleLoopState idleLoop;
+        unsigned long long memoryWrites, hostEffects, skippedCycles, instructionsRetired;
+        bool terminalInputClosed; // the input itself is not rewound
+        vector<unsigned> callStack; // the call graph keeps its counts
+        unsigned callStackOverflow;
+    };
+    MachineSnapshot snapshot;
+    bitset<NO_MEMORY_PAGES> dirtyPages; // pages written since the snapshot was taken or restored
+
+    int snapshotAddress;  // the harness snapshots the machine before the command at this address (-1 - at the program start)
+    unsigned restoreRuns; // the harness reruns the program from the snapshot this many times (0 - no harness)
+    unsigned long long snapshotRestores, restoredPages;
+    double restoreLoopSeconds;
+
+    /* execution statistics */
+    ENGINE engine;
+    bool statisticsEnabled;
+    double loadSeconds; // fillMemoryFromInputFile()
+    unsigned long long instructionsRetired;
+    unsigned long long instructionLimit; // the emulation stops when it is reached (an event of DEVICE::instruction_limit)
+    unsigned long long instructionBudget; // run() returns when it is reached (an event of DEVICE::instruction_budget)
+    bool stopRequested;                  // the limit or the budget was reached
+    bool programHalted;                  // the emulation ended with the halt command
+
+    ostream *output; // final state, terminal output and errors (nullptr - nothing is printed)
+
+    DUMP_FORMAT dumpFormat;
+    vector<char> loadedMemory; // memory after the program load (kept for diff_dump only)
+
+    /* profiler - flat counters of the retired commands and of the data accesses */
+    bool profilingEnabled;
+    vector<unsigned long long> profilePcs;       // retired commands by their address (allocated when profiling is turned on)
+    vector<unsigned long long> profileFoldedPcs; // the part of 'profilePcs' already added to the counts below
+    unsigned long long profileMnemonics[256], profileAddressingModes[NO_ADDRESSING_MODES + 1]; // the last one - no operand
+    unsigned long long profilePageReads[NO_MEMORY_PAGES], profilePageWrites[NO_MEMORY_PAGES]; // word reads and writes
+
+    void profileCommand();                               // counts the command in 'cd' (pc already points to the following one)
+    void profileFold(unsigned, unsigned char, unsigned); // adds the new count of an address to its MNEMONIC and ADDRESSING_MODE
+    void profileFoldFromMemory(unsigned);                // the same for the command in memory
+    void profileCodeChanging(unsigned, unsigned);        // folds the commands over the bytes about to be overwritten (no decode cache)
+    void profileFoldAll();                               // brings the counts per command and addressing mode up to date
+
+    /* execution trace - a ring buffer of the last retired commands, written to a file after the emulation */
+    bool traceEnabled;
+    vector<TraceRecord> traceBuffer;
+    unsigned traceNext;                // the record of the current command
+    bool tracePending;                 // the current command is recorded, but it has not finished yet
+    unsigned long long traceRecords;   // finished records (also those overwritten since)
+
+    void traceCommand(); // records the command in 'cd' (pc already points to the following one)
+    void traceFinish();  // completes the record of the previous command with its results
+
+    /* call graph - a shadow call stack kept by call, ret, int, iret and the accepted interrupts */
+    struct CallGraphFrame {
+        unsigned parent;           // the caller (the root frame is its own parent)
+        unsigned address;          // the entered routine
+        int interruptEntry;        // IVT entry of an interrupt routine (-1 - a subroutine)
+        unsigned long long cycles; // charged while the frame was on top of the stack
+    };
+    bool callGraphEnabled;
+    vector<CallGraphFrame> callGraphFrames;              // every call path seen so far (0 - the program start)
+    map<unsigned long long, unsigned> callGraphChildren; // (caller, IVT entry, address) -> frame
+    vector<unsigned> callStack;                          // frames of the active routines
+    unsigned callStackOverflow;                          // calls beyond CALL_GRAPH_MAX_DEPTH that have not returned yet
+    unsigned long long callGraphCharged;                 // instructionsRetired already charged to a frame
+    map<unsigned, string> symbols;                       // symbol map (address -> name)
+
+    void callGraphEnter(unsigned, int); // address of the entered routine, IVT entry (-1 - call)
+    void callGraphLeave();              // ret or iret
+    void callGraphCharge();             // the cycles since the last call, return or interrupt go to the top frame
+    string callGraphFrameName(const CallGraphFrame &);
+
+    /* callbacks of an embedding program (the JIT and AOT engines are replaced by the switch engine while one is set) */
+    DeviceCallback deviceCallback;       // accesses of the memory mapped registers (by the commands and the terminal input)
+    InterruptCallback interruptCallback; // int commands
+
+    bool interruptCallbackHandled(int); // calls the interrupt callback (IVT entry), true - the routine is not entered
+
+    /* semihosting - buffers are copied between memory and the host at once, paths are zero-terminated */
+    bool semihostingEnabled;
+    unsigned long long semihostingClockStart; // host monotonic clock at the program load (microseconds)
+
+    void semihostingRequest();              // executes the request of the int command in 'cd'
+    bool semihostingBuffer(unsigned, unsigned); // the buffer lies in RAM pages and does not wrap around (address, length)
+    void memoryCopiedIn(unsigned, unsigned);    // what writeToMemory() does after a store, for a copied buffer (address, length)
+
+    /* device bus - a page is read in place through its RAM pointer, or by its device */
+    struct BusPage {
+        char *ram;         // the page in 'memory' (nullptr - a device page)
+        BusDevice *device; // nullptr - a RAM page
+    };
+    BusPage bus[NO_MEMORY_PAGES];
+    bool busDevicesMapped; // mapDevice() has mapped a device (the JIT and AOT engines read memory in place, so they are replaced by the switch engine)
+
+    struct RegistersDevice : BusDevice { // the terminal and the timer (the page of MMAP_REGISTERS_START_ADDRESS)
+        Emulator *emulator;
+
+        RegistersDevice(Emulator *e) : emulator(e) {}
+        short read(unsigned, short) override;
+        void write(unsigned, short &) override;
+    };
+    RegistersDevice registersDevice;
+
     /* utility methods */
+    void reportError(ERROR_KIND, string); // adds an error with the current pc and instruction count
+
     short readFromMemory(int, unsigned, bool = LITTLE_ENDIAN_ORDER); // up to 2B can be read at one time
+    short readFromDevice(int, unsigned, bool); // readFromMemory() of a device page (or of a word that ends in one)
+    bool deviceWord(unsigned);                 // a byte of the word at the address belongs to a device page
+    short deviceRead(BusDevice *, unsigned, short);  // BusDevice::read() of a device (nullptr - RAM, the value is kept)
+    void deviceWrite(BusDevice *, unsigned, short &); // BusDevice::write() of a device (nullptr - RAM)
     void writeToMemory(int, unsigned, short);
 
+    void invalidateDecodeCache(unsigned); // drops cached commands that contain the byte at the given address
+
+    void startDevices();                      // schedules the first device events
+    void scheduleDeviceEvent(char, unsigned long long); // DEVICE, cycle
+    void deviceRegisterWritten(int, short);   // reaction of a device to a write to its register (address, value)
+    void handleEvents();                      // runs the due device events and accepts an unmasked interrupt request
+    void requestInterruptCheck();             // psw may have unmasked a pending request
+    void checkIdleLoop(unsigned);             // called after a taken jump (the address of the command following the jump)
+
+    void fuseCommands(unsigned);                     // tries to form a superinstruction starting with the cached command at the given address
+    void unfuseCommands(unsigned);                   // splits superinstructions that contain the dropped command at the given address
+    bool fetchFusedCommand(unsigned, unsigned char); // moves 'cd' to the next command of a superinstruction (head address, FUSION)
+
     void updateSource(); // updating rSrc before/after the forming of the address of the operand
 
     short getOperand(); // operand fetch
@@ -134,21 +418,130 @@ private:
     short popFromStack();    // gets a value from the stack (and updates sp)
 
     bool evaluateJumpCondition(); // returns the result of checking the jump condition
-    void updatePswFlags(short);   // sets psw flags
+    void updatePswFlags(short, short, short, short); // sets psw flags (mnemonic, rDst value, rSrc value, result)
+
+    short flagsWrittenBy(short);  // flags (FLAG_MASK) that a flag-producing command sets or clears
+    void recordPswFlags(short);   // remembers the current command's flags (result) until psw is read
+    void materializePswFlags();   // brings psw up to date with the recorded flags
 
     /* methods called by emulate() */
-    bool fillMemoryFromInputFile(); // loads segments into memory
+    bool fillMemoryFromInputFile(); // maps the input file (or takes the built-in image) and loads it
+    bool loadImage(const unsigned char *, size_t); // a linked image (segments) or a flat image (see isFlatImage())
 
     bool commandFetchAndDecode(); // fetching and decoding a command
     bool commandExecute(bool &);  // command execution
 
+    bool prepare();                 // loads the program and resets the processor and the devices
+    bool execute();                 // runs the selected engine until halt or the instruction limit
+    bool executeCommands(int);       // runs the switch engine command by command until pc reaches the given address (-1 - none), halt or a limit
+    bool executeToAddress(unsigned); // executeCommands(), the address has to be reached
+    RUN_RESULT startRun(unsigned long long); // schedules the budget of run(), runUntil() or step() (run_limit - the run can start)
+    void printFinalState(double);    // emulation time in seconds
+
+    bool threadedExecute(); // runs the threaded engine until halt
+
+    /* JIT engine (src/jit.cpp) */
+    struct JitContext { // state shared with the translated code (field offsets are hard-coded in the emitted code)
+        short *registers;                       // +0
+        char *memory;                           // +8
+        Emulator *emulator;                     // +16
+        unsigned long long instructionsRetired; // +24
+        unsigned long long *nextEventCycle;     // +32; translated code returns to the dispatcher before it is reached
+        unsigned char *chainSite;               // +40; jump of the last exit that could be chained to the next block
+        bool *pswFlagsPending;                  // +48; lazyFlags.pending
+        unsigned long long *skippedCycles;      // +56; a jmp to itself fast-forwards to the next event
+        unsigned long long *emulatorRetired;    // +64; Emulator::instructionsRetired, as seen by the helpers
+    };
+
+    unsigned char *jitCode; // mmap'd code buffer, writable or executable but never both (see jitProtect())
+    unsigned jitCodeUsed;
+    bool jitCodeWritable;
+    unsigned char *jitEnter, *jitExit; // trampoline into the translated code and the common way back
+
+    vector<unsigned char *> jitBlocks; // translated block for every start address (nullptr if there is none)
+    vector<unsigned> jitBlockStarts;   // addresses with a translated block
+    vector<char> jitCodeBytes;         // 1 for every byte of memory covered by a translated block
+    vector<CommandData> jitCommands;   // commands executed by the interpreter on behalf of the translated code
+
+    bool jitFlushed;                  // translations were dropped while the translated code was running
+    unsigned long long jitTranslations, jitFlushes;
+
+    bool jitExecute();                    // runs the JIT engine until halt
+    unsigned char *jitTranslate(unsigned); // translates the basic block starting at the given address
+    bool jitDecode(unsigned);              // decodes the command at the given address into 'cd' for translation
+    void jitFlush();                      // drops all translations (after a store into translated code)
+    bool jitProtect(bool);                // switches the code buffer to writable (true) or executable (false)
+
+    static int jitExecuteCommand(Emulator *, unsigned); // called from the translated code
+    static int jitStore(Emulator *, unsigned, short);    // called from the translated code
+    static void jitMaterializePswFlags(Emulator *);      // called from the translated code
+
+    /* AOT engine (src/aot.cpp) - blocks of the program translated by the translator and built into the executable */
+    vector<int> aotBlocks;     // index of the translated block for every start address (-1 if there is none or its code was overwritten)
+    vector<char> aotCodeBytes; // 1 for every byte of memory covered by a translated block
+    bool aotCodeModified;      // a store or a restore changed bytes of translated code since the blocks were validated
+    unsigned long long aotBlockEntries, aotInterpretedCommands;
+
+    bool aotExecute();  // runs the AOT engine until halt
+    void aotValidate(); // enables the blocks whose code is still in memory
+
 public:
-    Emulator(string); // constructor
+    Emulator(string); // constructor (input file path)
+    Emulator(const unsigned char *, size_t); // an image in memory (linked or flat), it has to stay valid until load()
+    ~Emulator();
+
+    void setDecodeCacheEnabled(bool); // the cache can be turned on/off at any point of the emulation (threaded runs use it anyway)
+    void setLazyFlagsEnabled(bool);
+    void setCommandFusionEnabled(bool); // superinstructions (switch engine only)
+    void setIdleLoopSkipEnabled(bool);  // turned off for runs that have to execute every cycle
+    void setInstructionLimit(unsigned long long);
+    void setOutputStream(ostream *);    // cout by default
+    void setTerminalInput(int);         // standard input by default
+    void setSnapshotHarness(int, unsigned); // snapshot address (-1 - the program start), the number of runs restored from the snapshot
+    void setEngine(ENGINE);
+    void setStatisticsEnabled(bool);  // printout of the retired instructions count and MIPS
+    void setProfilingEnabled(bool);   // the counters can be turned on/off at any point of the emulation (the JIT and AOT engines are replaced by the switch engine meanwhile)
+    void setCallGraphEnabled(bool);   // the shadow call stack is started by the program load (the JIT and AOT engines are replaced by the switch engine)
+    bool loadSymbolMap(string);       // the linker's -map file, false if it cannot be read
+    void setDumpFormat(DUMP_FORMAT);  // hex_dump by default, set before the emulation (see memoryDump())
+    void setTraceRecords(unsigned);   // size of the trace ring buffer (0 - no trace; the JIT and AOT engines are replaced by the switch engine)
 
     bool emulate(); // emulation of program execution on the described system
-    
+
+    /* embedding - the program is loaded once and then run in parts, nothing is printed (see printFinalState()) */
+    bool load();                            // loads the program and resets the processor and the devices, false on errors
+    RUN_RESULT run(unsigned long long);     // the selected engine, until halt or at most the given number of commands
+    RUN_RESULT runUntil(unsigned, unsigned long long = ~0ULL); // the switch engine, until pc reaches the address (or halt, or the number of commands)
+    RUN_RESULT step();                      // one command (the switch engine)
+    void setDeviceCallback(DeviceCallback); // nullptr - no callback
+    void setInterruptCallback(InterruptCallback);
+    void setSemihostingEnabled(bool); // int with IVT_ENTRY_SEMIHOSTING (off - the routine of the entry is entered)
+    void mapDevice(unsigned, BusDevice *);  // page (address / MEMORY_PAGE_SIZE), device (nullptr - RAM); the device is not owned
+
+    /* snapshots - e.g. the same code run with different inputs without reloading the program */
+    void takeSnapshot();
+    bool restoreSnapshot();           // false if there is no snapshot
+    bool resume();                    // continues the emulation from the current state until halt or the instruction limit
+    void setRegister(unsigned, short); // R_INDEX, value (a state error for another index)
+    void writeMemoryWord(unsigned, short);
+    void writeMemoryByte(unsigned, unsigned char);
+
+    /* final state */
+    bool isHalted();
+    short getRegister(unsigned); // R_INDEX (0 and a state error for another index)
+    short readMemoryWord(unsigned);
+    unsigned char readMemoryByte(unsigned);
+    unsigned long long getInstructionsRetired();
+    const vector<EmulatorError> &getErrors();
+    vector<string> getErrorMessages();
+
     /* printing methods */
-    bool memoryDump();
+    bool memoryDump(string); // output file path (nothing is written for no_dump)
+    void printProfile(ostream &);  // hot-spot report
+    bool writeProfileJson(string); // output file path
+    bool writeCallGraph(string);   // folded stacks (output file path)
+    bool writeTrace(string);       // the trace ring buffer, the oldest record first (output file path)
+    static bool decodeTrace(string, ostream &); // a trace file as text, false if it cannot be read
     void printErrorMessages(); // error printout
 };
 
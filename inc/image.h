@@ -0,0 +1,57 @@
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include <string>
+#include <vector>
+#include <cstring> // memcpy(), memcmp()
+
+using namespace std;
+
+/*
+    A linked image (see Linker::writeBinaryFile()) - the number of segments, then the length, data and base address of
+    each; the emulator and the translator read it with the same checks, so the translator takes only images that its
+    executables load
+*/
+struct ImageSegment {
+    size_t offset;        // of the data in the image
+    unsigned length;
+    unsigned baseAddress;
+};
+
+/*
+    A flat image (see Linker::writeFlatFile()) - FLAT_IMAGE_MAGIC followed by the whole 64KB address space; a linked
+    image of the same size would have to start with more segments than fit in it, so the two can not be mistaken
+*/
+#define FLAT_IMAGE_MAGIC "FLAT"
+#define FLAT_IMAGE_MAGIC_SIZE 4
+#define FLAT_IMAGE_SIZE (FLAT_IMAGE_MAGIC_SIZE + (1 << 16))
+
+inline bool isFlatImage(const unsigned char *image, size_t imageSize) {
+    return imageSize == FLAT_IMAGE_SIZE && memcmp(image, FLAT_IMAGE_MAGIC, FLAT_IMAGE_MAGIC_SIZE) == 0;
+}
+
+// every segment header is checked against the size of the image and the end of the memory below 'limit' before
+// anything is copied; returns the error ("" for a valid image) with 'imageName' as the subject of the message
+inline string imageSegments(const unsigned char *image, size_t imageSize, unsigned limit, const string &imageName, vector<ImageSegment> &segments) {
+    unsigned nOfSegments, length, baseAddress;
+    if (imageSize < sizeof(nOfSegments)) return imageName + " is not a linked image.";
+    memcpy(&nOfSegments, image, sizeof(nOfSegments));
+
+    size_t offset = sizeof(nOfSegments);
+    for (unsigned i = 0; i < nOfSegments; i++) {
+        if (imageSize - offset < sizeof(length)) return imageName + " ends in the header of segment " + to_string(i) + ".";
+        memcpy(&length, image + offset, sizeof(length));
+        offset += sizeof(length);
+        if (length > imageSize - offset || imageSize - offset - length < sizeof(baseAddress))
+            return imageName + " ends in segment " + to_string(i) + ".";
+        memcpy(&baseAddress, image + offset + length, sizeof(baseAddress));
+        if (baseAddress > limit || length > limit - baseAddress) return "Program segment overlaps with memory reserved for registers.";
+
+        segments.push_back({offset, length, baseAddress});
+        offset += length + sizeof(baseAddress);
+    }
+    if (offset != imageSize) return imageName + " has " + to_string(imageSize - offset) + " bytes after its last segment.";
+    return "";
+}
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef INTERNER_H
+#define INTERNER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+
+using namespace std;
+
+/*
+    The interner keeps one copy of every distinct string (symbol and section names) in an arena of blocks and numbers
+    them densely in the order they are added; an open-addressing hash table (linear probing) finds the id of a string
+*/
+class StringInterner {
+private:
+    static constexpr size_t BLOCK_SIZE = 1 << 16; // bytes of an arena block (a longer string gets a block of its own)
+
+    vector<unique_ptr<char[]>> blocks; // the arena
+    char *block;                       // the block being filled
+    size_t blockUsed;                  // bytes used in the 'block'
+
+    vector<string_view> strings; // by id, into the arena
+    vector<unsigned> hashes;     // by id, for the rehashing
+    vector<unsigned> slots;      // id + 1 of the string in the slot (0 - an empty slot), the size is a power of two
+
+    static unsigned hash(string_view);
+    unsigned slot(string_view, unsigned) const; // the slot of the string or the empty slot where it belongs
+    void grow();                                // doubles the slots (at most half of them are used)
+
+public:
+    static constexpr unsigned NONE = ~0u; // no string (not interned)
+
+    StringInterner();
+
+    unsigned intern(string_view);     // the id of the string, which is added if it is new
+    unsigned find(string_view) const; // the id of the string or NONE
+    string_view name(unsigned id) const { return strings[id]; }
+    unsigned size() const { return strings.size(); }
+};
+
+#endif
@@ -0,0 +1,262 @@
+#ifndef ISA_H
+#define ISA_H
+
+#include <array>
+#include <string>
+#include <string_view>
+#include <cstdio> // snprintf() of the disassembler
+
+using namespace std;
+
+/*
+    The instruction set, described once for the assembler (encoding), the emulator and the translator (decoding) and
+    the disassembler; the mnemonic lookup and the decode table are generated from the description at compile time
+*/
+
+/* assembler commands - the first byte [operation code (4b) | modifier (4b)] */
+enum MNEMONIC {
+    halt = 0x00,
+    _int = 0x10,
+    iret = 0x20,
+    call = 0x30,
+    ret = 0x40,
+    jmp = 0x50,
+    jeq,
+    jne,
+    jgt,
+    xchg = 0x60,
+    add = 0x70,
+    sub,
+    mul,
+    _div,
+    cmp,
+    _not = 0x80,
+    _and,
+    _or,
+    _xor,
+    test,
+    shl = 0x90,
+    shr,
+    ldr_pop = 0xA0, // ldr and pop have the same first byte
+    str_push = 0xB0 // str and push have the same first byte
+};
+
+enum UPDATE_TYPE {
+    no_update,
+    pre_decrement,
+    pre_increment,
+    post_decrement,
+    post_increment
+};
+
+enum ADDRESSING_MODE {
+    immed,
+    regdir,
+    regind,
+    regind_disp,
+    memdir,
+    regdir_disp
+};
+#define NO_ADDRESSING_MODES 6
+
+#define MAX_COMMAND_LENGTH 5 // commands with a payload
+
+/* the bytes following the first one */
+enum OPERAND_CLASS {
+    operands_none,      // halt, iret, ret (1B)
+    operands_register,  // int, not - [rDst | 1 1 1 1] (2B)
+    operands_registers, // xchg, add, ... - [rDst | rSrc] (2B)
+    operands_jump,      // call, jmp, ... - [1 1 1 1 | rSrc] [update | addressing] (payload) (3B or 5B)
+    operands_data,      // ldr, str - [rDst | rSrc] [update | addressing] (payload) (3B or 5B)
+    operands_stack      // push, pop - the data form [rDst | sp] [update | regind] of str and ldr (3B)
+};
+
+struct InstructionInfo {
+    const char *name;               // the mnemonic in the source
+    unsigned char code;             // the first byte
+    OPERAND_CLASS operands;
+    unsigned short addressingModes; // allowed ADDRESSING_MODEs (a bit per mode)
+    unsigned short updateTypes;     // allowed values of the update field (a bit per value)
+    unsigned char length;           // bytes without a payload (modes with a payload add 2, see isaHasPayload())
+    bool isAlias;                   // a form of another command (push, pop) - not a result of decoding
+};
+
+#define ISA_MODES(first, last) (((1 << ((last) + 1)) - 1) & ~((1 << (first)) - 1))
+#define ISA_NO_UPDATE (1 << UPDATE_TYPE::no_update)
+#define ISA_ANY_UPDATE 0xFFFF // ldr and str do not check the field (the values above post_increment mean no update)
+
+constexpr InstructionInfo ISA_INSTRUCTIONS[] = {
+    {"halt", MNEMONIC::halt, operands_none, 0, 0, 1, false},
+    {"int", MNEMONIC::_int, operands_register, 0, 0, 2, false},
+    {"iret", MNEMONIC::iret, operands_none, 0, 0, 1, false},
+    {"call", MNEMONIC::call, operands_jump, ISA_MODES(immed, regdir_disp), ISA_NO_UPDATE, 3, false},
+    {"ret", MNEMONIC::ret, operands_none, 0, 0, 1, false},
+    {"jmp", MNEMONIC::jmp, operands_jump, ISA_MODES(immed, regdir_disp), ISA_NO_UPDATE, 3, false},
+    {"jeq", MNEMONIC::jeq, operands_jump, ISA_MODES(immed, regdir_disp), ISA_NO_UPDATE, 3, false},
+    {"jne", MNEMONIC::jne, operands_jump, ISA_MODES(immed, regdir_disp), ISA_NO_UPDATE, 3, false},
+    {"jgt", MNEMONIC::jgt, operands_jump, ISA_MODES(immed, regdir_disp), ISA_NO_UPDATE, 3, false},
+    {"xchg", MNEMONIC::xchg, operands_registers, 0, 0, 2, false},
+    {"add", MNEMONIC::add, operands_registers, 0, 0, 2, false},
+    {"sub", MNEMONIC::sub, operands_registers, 0, 0, 2, false},
+    {"mul", MNEMONIC::mul, operands_registers, 0, 0, 2, false},
+    {"div", MNEMONIC::_div, operands_registers, 0, 0, 2, false},
+    {"cmp", MNEMONIC::cmp, operands_registers, 0, 0, 2, false},
+    {"not", MNEMONIC::_not, operands_register, 0, 0, 2, false},
+    {"and", MNEMONIC::_and, operands_registers, 0, 0, 2, false},
+    {"or", MNEMONIC::_or, operands_registers, 0, 0, 2, false},
+    {"xor", MNEMONIC::_xor, operands_registers, 0, 0, 2, false},
+    {"test", MNEMONIC::test, operands_registers, 0, 0, 2, false},
+    {"shl", MNEMONIC::shl, operands_registers, 0, 0, 2, false},
+    {"shr", MNEMONIC::shr, operands_registers, 0, 0, 2, false},
+    {"ldr", MNEMONIC::ldr_pop, operands_data, ISA_MODES(immed, memdir), ISA_ANY_UPDATE, 3, false},
+    {"str", MNEMONIC::str_push, operands_data, ISA_MODES(regdir, memdir), ISA_ANY_UPDATE, 3, false},
+    {"push", MNEMONIC::str_push, operands_stack, 1 << ADDRESSING_MODE::regind, 1 << UPDATE_TYPE::pre_decrement, 3, true},
+    {"pop", MNEMONIC::ldr_pop, operands_stack, 1 << ADDRESSING_MODE::regind, 1 << UPDATE_TYPE::post_increment, 3, true}
+};
+#define ISA_NO_INSTRUCTIONS (sizeof(ISA_INSTRUCTIONS) / sizeof(ISA_INSTRUCTIONS[0]))
+
+constexpr bool isaHasPayload(unsigned addressingMode) {
+    return addressingMode != ADDRESSING_MODE::regdir && addressingMode != ADDRESSING_MODE::regind;
+}
+
+/* decoding - the instruction of every first byte (-1 - not a command) */
+constexpr array<signed char, 256> isaDecodeTable() {
+    array<signed char, 256> table = {};
+    for (unsigned i = 0; i < table.size(); i++) table[i] = -1;
+    for (unsigned i = 0; i < ISA_NO_INSTRUCTIONS; i++)
+        if (!ISA_INSTRUCTIONS[i].isAlias) table[ISA_INSTRUCTIONS[i].code] = i;
+    return table;
+}
+constexpr array<signed char, 256> ISA_DECODE_TABLE = isaDecodeTable();
+
+inline const InstructionInfo *isaDecode(unsigned char code) {
+    return ISA_DECODE_TABLE[code] < 0 ? nullptr : &ISA_INSTRUCTIONS[(int)ISA_DECODE_TABLE[code]];
+}
+
+constexpr bool isaOperationCodeExists(unsigned operationCode) { // some modifier of the operation code is a command
+    for (unsigned i = 0; i < ISA_NO_INSTRUCTIONS; i++)
+        if (ISA_INSTRUCTIONS[i].code >> 4 == operationCode) return true;
+    return false;
+}
+
+inline const char *isaName(unsigned char code, const char *unknown = "unknown") {
+    const InstructionInfo *instruction = isaDecode(code);
+    return instruction != nullptr ? instruction->name : unknown;
+}
+
+/* checks of the fields that follow the first byte (registers up to psw - 8) */
+inline bool isaValidRegisters(const InstructionInfo &instruction, unsigned rDst, unsigned rSrc) {
+    switch (instruction.operands) {
+        case operands_register: return rDst <= 8 && rSrc == 0xF;
+        case operands_registers: return rDst <= 8 && rSrc <= 8;
+        case operands_data: return rDst <= 8;
+        default: return true;
+    }
+}
+
+inline bool isaValidAddressingMode(const InstructionInfo &instruction, unsigned addressingMode) {
+    return (instruction.addressingModes >> addressingMode) & 1;
+}
+
+inline bool isaValidUpdateType(const InstructionInfo &instruction, unsigned updateType) {
+    return (instruction.updateTypes >> updateType) & 1;
+}
+
+/* the assembler's mnemonic lookup - a perfect hash of the names (a seed without collisions is found at compile time) */
+#define ISA_HASH_SLOTS 64
+
+constexpr unsigned isaHash(const char *name, unsigned length, unsigned seed) {
+    unsigned hash = 2166136261u ^ seed; // FNV-1a
+    for (unsigned i = 0; i < length; i++) hash = (hash ^ (unsigned char)name[i]) * 16777619u;
+    return (hash ^ hash >> 16) % ISA_HASH_SLOTS;
+}
+
+constexpr unsigned isaNameLength(const char *name) {
+    unsigned length = 0;
+    while (name[length] != '\0') length++;
+    return length;
+}
+
+constexpr unsigned isaHashSeed() {
+    for (unsigned seed = 0; seed < 0x10000; seed++) {
+        bool used[ISA_HASH_SLOTS] = {}, collision = false;
+        for (unsigned i = 0; i < ISA_NO_INSTRUCTIONS && !collision; i++) {
+            unsigned slot = isaHash(ISA_INSTRUCTIONS[i].name, isaNameLength(ISA_INSTRUCTIONS[i].name), seed);
+            collision = used[slot];
+            used[slot] = true;
+        }
+        if (!collision) return seed;
+    }
+    return 0x10000;
+}
+constexpr unsigned ISA_HASH_SEED = isaHashSeed();
+static_assert(ISA_HASH_SEED < 0x10000, "the mnemonics have no perfect hash of ISA_HASH_SLOTS slots");
+
+constexpr array<signed char, ISA_HASH_SLOTS> isaLookupTable() {
+    array<signed char, ISA_HASH_SLOTS> table = {};
+    for (unsigned i = 0; i < table.size(); i++) table[i] = -1;
+    for (unsigned i = 0; i < ISA_NO_INSTRUCTIONS; i++)
+        table[isaHash(ISA_INSTRUCTIONS[i].name, isaNameLength(ISA_INSTRUCTIONS[i].name), ISA_HASH_SEED)] = i;
+    return table;
+}
+constexpr array<signed char, ISA_HASH_SLOTS> ISA_LOOKUP_TABLE = isaLookupTable();
+
+inline const InstructionInfo *isaLookup(string_view name) { // nullptr - not a mnemonic
+    signed char index = ISA_LOOKUP_TABLE[isaHash(name.data(), name.size(), ISA_HASH_SEED)];
+    if (index < 0 || name != ISA_INSTRUCTIONS[(int)index].name) return nullptr;
+    return &ISA_INSTRUCTIONS[(int)index];
+}
+
+/* the disassembler - a command at 'address' in the syntax of the assembler (pc relative operands as their targets) */
+inline string isaDisassemble(const unsigned char *bytes, unsigned length, unsigned address) {
+    const InstructionInfo *instruction = isaDecode(bytes[0]);
+    if (instruction == nullptr || length < instruction->length) return "?";
+
+    const char *registerNames[16] = {"r0", "r1", "r2", "r3", "r4", "r5", "r6", "r7", "psw"};
+    auto reg = [&registerNames](unsigned index) { return string(registerNames[index] != nullptr ? registerNames[index] : "r?"); };
+    auto word = [](unsigned value) {
+        char text[8];
+        snprintf(text, sizeof(text), "0x%04x", 0xFFFF & value);
+        return string(text);
+    };
+
+    string text = instruction->name;
+    unsigned rDst = instruction->length > 1 ? bytes[1] >> 4 : 0, rSrc = instruction->length > 1 ? 0x0F & bytes[1] : 0;
+    switch (instruction->operands) {
+        case operands_none: return text;
+        case operands_register: return text + " " + reg(rDst);
+        case operands_registers: return text + " " + reg(rDst) + ", " + reg(rSrc);
+        default: break;
+    }
+
+    /* jumps and loads/stores */
+    unsigned updateType = bytes[2] >> 4, addressingMode = 0x0F & bytes[2];
+    if (isaHasPayload(addressingMode) && length < MAX_COMMAND_LENGTH) return "?";
+    short payload = isaHasPayload(addressingMode) ? bytes[3] << 8 | bytes[4] : 0;
+    bool isJump = instruction->operands == operands_jump;
+
+    if (!isJump && addressingMode == ADDRESSING_MODE::regind && rSrc == 6) { // push and pop
+        if (bytes[0] == MNEMONIC::str_push && updateType == UPDATE_TYPE::pre_decrement) return "push " + reg(rDst);
+        if (bytes[0] == MNEMONIC::ldr_pop && updateType == UPDATE_TYPE::post_increment) return "pop " + reg(rDst);
+    }
+
+    string operand, mark = isJump ? "*" : "";
+    const char *updates[] = {"", "--", "++", "", ""}; // pre
+    const char *postUpdates[] = {"", "", "", "--", "++"};
+    string updated = updateType <= UPDATE_TYPE::post_increment ? updates[updateType] + reg(rSrc) + postUpdates[updateType] : reg(rSrc);
+    string displacement = payload < 0 ? " - " + word(-payload) : " + " + word(payload);
+    unsigned target = address + MAX_COMMAND_LENGTH + payload;
+
+    switch (addressingMode) {
+        case ADDRESSING_MODE::immed: operand = (isJump ? "" : "$") + word(payload); break;
+        case ADDRESSING_MODE::regdir: operand = mark + reg(rSrc); break;
+        case ADDRESSING_MODE::regind: operand = mark + "[" + updated + "]"; break;
+        case ADDRESSING_MODE::regind_disp: operand = !isJump && rSrc == 7 ? "%" + word(target) : mark + "[" + updated + displacement + "]"; break;
+        case ADDRESSING_MODE::memdir: operand = mark + word(payload); break;
+        case ADDRESSING_MODE::regdir_disp: operand = rSrc == 7 ? "%" + word(target) : reg(rSrc) + displacement; break;
+        default: return "?";
+    }
+    return text + " " + (isJump ? "" : reg(rDst) + ", ") + operand;
+}
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef LEXER_H
+#define LEXER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+enum TOKEN_TYPE {
+    token_symbol,      // [a-zA-Z][a-zA-Z_0-9]*
+    token_literal,     // -?[0-9]+ or 0[xX][0-9A-Fa-f]+
+    token_space,       // a single space (cleared lines have no other whitespace)
+    token_punctuator,  // one of . , : $ % * [ ] + -
+    token_other,       // a character that belongs to no token (no rule accepts it)
+    token_end          // the end of the line
+};
+
+struct Token {
+    TOKEN_TYPE type;
+    unsigned start;  // the index of the first character in the line
+    unsigned length; // number of characters
+};
+
+/*
+    The lexer splits a cleared source line into tokens in a single pass; the parser (in the assembler) then descends
+    through them with the matching methods below, each of which consumes tokens only if they match
+*/
+class Lexer {
+private:
+    string_view line;     // the line being parsed (owned by the caller)
+    vector<Token> tokens; // tokens of the line, ending with 'token_end'
+    unsigned next;        // index of the next token
+
+    bool is(TOKEN_TYPE, const char * = nullptr); // the next token is of the type (and the text)
+    string_view text(const Token &);
+
+public:
+    static void clearLine(string_view, string &); // removes comments, tabs and redundant spaces of a source line (into the string)
+    static bool isSymbol(string_view);
+
+    void tokenize(string_view); // a cleared line
+
+    unsigned mark() { return next; }           // the position to backtrack to
+    void reset(unsigned position) { next = position; }
+    string_view rest();                        // the text from the next token to the end of the line
+
+    /* matching methods */
+    bool end();
+    bool space();
+    bool punctuator(char);
+    bool keyword(const char *); // a symbol with the given text (mnemonics, directive names)
+    bool symbol(string_view &); // the views of the matched text are valid as long as the line
+    bool literal(string_view &);
+    bool literalOrSymbol(string_view &);
+    bool reg(char &); // r0-r7 or psw (index 8)
+};
+
+#endif
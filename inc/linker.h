@@ -11,6 +11,8 @@ class Linker {
 private:
     vector<string> inputFilesPaths; // files we link
     string outputFilePath;
+    string mapFilePath;  // symbol map ("" - not written)
+    string flatFilePath; // memory image ("" - not written)
 
     vector<string> linkingErrors;
 
@@ -78,9 +80,11 @@ private:
 
     bool writeHexFile();    // creates a .hex output file
     bool writeBinaryFile(); // creates a binary output file
+    bool writeMapFile();    // creates a text symbol map (addresses of the labels)
+    bool writeFlatFile();   // creates a 64KB memory image
 
 public:
-    Linker(vector<string>, string); // constructor
+    Linker(vector<string>, string, string = "", string = ""); // constructor (input files, output file, symbol map, flat image)
 
     bool link();
     void printErrorMessages();
@@ -0,0 +1,83 @@
+#ifndef LOCKSTEP_H
+#define LOCKSTEP_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <ostream>
+#include <functional>
+
+#include "emulator.h"
+
+using namespace std;
+
+/* lockstep engine limits */
+#define LOCKSTEP_MAX_LANES 32
+
+// one register of every lane (GCC vector extension - SSE2 by default, AVX2 with -mavx2)
+typedef short LaneVector __attribute__((vector_size(LOCKSTEP_MAX_LANES * sizeof(short))));
+
+/* lockstep mode - groups of emulators that run the same program on different inputs execute each command once for the whole group */
+class LockstepRunner {
+private:
+    string inputFilePath; // the program
+    string inputsPath;    // a line of 'register=value' and 'address=value' items for every instance
+    vector<string> lockstepErrors;
+
+    /* an instance, its inputs and its final state */
+    struct Instance {
+        vector<pair<int, short>> registerInputs;      // R_INDEX and value
+        vector<pair<unsigned, short>> memoryInputs;   // address and word
+
+        string status; // halt, timeout (the instruction limit was reached) or error
+        short registers[NO_REGISTERS];
+        unsigned long long instructionsRetired;
+        vector<string> messages; // emulating errors
+    };
+    vector<Instance> instances;
+
+    unsigned nOfLanes;                       // instances in a group (1 - every instance runs on the scalar core)
+    function<void(Emulator &)> configure;    // command line options applied to every Emulator
+
+    /* the group being run - a structure-of-arrays register file, lanes leave it when their pc diverges */
+    LaneVector registerFile[NO_REGISTERS];
+    LaneVector activeLanes; // -1 in the lanes that are still in the group
+    unique_ptr<Emulator> lanes[LOCKSTEP_MAX_LANES]; // restored from their snapshots for every group
+    bool peeled[LOCKSTEP_MAX_LANES];       // the lane waits for the scalar core
+    unsigned groupFirstInstance;           // instance of the lane 0
+    unsigned long long groupCycle;         // virtual time of the group (instructionsRetired of every active lane)
+    unsigned long long groupNextEventCycle; // the first due device event of the active lanes
+
+    /* statistics */
+    unsigned long long groupCommands;  // commands executed for a whole group
+    unsigned long long vectorCommands; // of them executed as vector operations
+    unsigned long long laneCommands;   // the sum of active lanes over all group commands
+    unsigned long long peeledLanes;    // lanes that continued on the scalar core
+
+    /* methods called by run() */
+    bool readInputs();
+    void runGroup(unsigned);         // the first instance of the group
+    bool executeVector(Emulator &);  // executes the decoded command of the leading lane in all lanes at once, false if it is not a vector command
+    void executeScalar(Emulator &);  // executes the decoded command of the leading lane in every lane by its own emulator
+    void readLanes(const LaneVector &, LaneVector &);        // a word of every lane's memory (addresses, values)
+    bool writeLanes(const LaneVector &, const LaneVector &); // false if a lane would write a device register
+    void handleDueEvents();          // device events of the lanes
+    void updateNextEventCycle();
+    void keepCommonPc();             // peels the lanes that left the pc of the majority
+    void loadLane(unsigned);         // registers of a lane into its emulator
+    void storeLane(unsigned);        // registers of a lane from its emulator
+    void peelLane(unsigned);         // the lane continues on the scalar core
+    void finishLane(unsigned, string); // records the final state of the lane's instance (lane, status)
+
+public:
+    LockstepRunner(string, string, unsigned, function<void(Emulator &)>); // program, inputs, lanes in a group, configuration of an Emulator
+
+    bool run(); // false if the inputs could not be read
+    bool allHalted();
+
+    /* printing methods */
+    void printResults(ostream &);
+    void printErrorMessages();
+};
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef READER_H
+#define READER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+/*
+    The reader hands out the lines of an assembly source one at a time as views without copying them: a regular file is
+    mapped into memory, the standard input ("-") and pipes are read in chunks into a buffer that only grows to the
+    longest line; a view is valid until the next call of nextLine()
+*/
+class SourceReader {
+private:
+    static const size_t CHUNK_SIZE = 1 << 16; // bytes read at once from the standard input or a pipe
+
+    int fileDescriptor;
+
+    /* a mapped regular file */
+    char *mapping;
+    size_t mappingSize;
+
+    /* chunks of the standard input or a pipe */
+    vector<char> buffer;
+    size_t begin, end; // the unread bytes in the 'buffer'
+    bool endOfFile;
+
+    const char *position, *limit; // the unread bytes of the mapping
+
+    bool readChunk(); // false at the end of the input
+
+public:
+    SourceReader();
+    ~SourceReader();
+    SourceReader(const SourceReader &) = delete;
+    SourceReader &operator=(const SourceReader &) = delete;
+
+    bool open(const string &); // a file path or "-" (the standard input)
+    bool nextLine(string_view &); // a line without its '\n' (getline() semantics), false at the end of the input
+};
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef TRANSLATOR_H
+#define TRANSLATOR_H
+
+#include <string>
+#include <vector>
+#include <set>
+#include <map>
+#include <ostream>
+
+#include "emulator.h"
+
+using namespace std;
+
+/* sources of the emulator built together with the translated unit (relative to the directory of the translator) */
+#define TRANSLATOR_RUNTIME_SOURCES {"src/emulator.cpp", "src/jit.cpp", "src/batch.cpp", "src/lockstep.cpp", "src/aot.cpp"}
+#define TRANSLATOR_DEFAULT_COMPILER "g++"
+#define TRANSLATOR_COMPILER_FLAGS "-O2 -pthread"
+
+/* IVT entries whose routines are the roots of the translated code */
+#define IVT_NO_ENTRIES 8
+
+class Translator {
+private:
+    string inputFilePath;  // the linker's binary output
+    string outputFilePath; // native executable
+    string sourceFilePath; // the generated translation unit
+    bool buildExecutable;  // false - only the translation unit is written
+
+    vector<string> translatingErrors;
+
+    /* the image */
+    vector<char> image;  // contents of the input file
+    vector<char> memory; // segments at their addresses
+    vector<char> loaded; // 1 for every byte of memory that belongs to a segment
+
+    /* a decoded command (see Emulator::commandFetchAndDecode()) */
+    struct Command {
+        short mnemonic;
+        char rDst, rSrc;
+        char updateType, addressingMode;
+        short payload;
+        char length;
+    };
+
+    /* the code reachable from the IVT entries */
+    map<unsigned, Command> commands; // by address
+    set<unsigned> leaders;           // addresses where a basic block starts
+    map<unsigned, unsigned> blockLengths; // bytes of the translated block of every leader
+
+    /* methods called by translate() */
+    bool readImage();                     // segments of the input file
+    bool decodeCommand(unsigned, Command &); // false if there is no valid command at the address
+    void findCode();                      // follows the control flow from the IVT entries
+    bool writeSource();
+    void writeBlock(ostream &, unsigned); // the function of the block starting at the given address
+    bool writeCommand(ostream &, unsigned, const Command &, unsigned, bool &); // address, command, block start, 'blockEnded' - true if it jumps back to the block start
+    bool build();                         // compiles the translation unit with the emulator into an executable
+
+public:
+    Translator(string, string, string, bool); // input file, executable, translation unit, build
+
+    bool translate();
+    void printErrorMessages();
+};
+
+#endif
@@ -0,0 +1,175 @@
+#include <cstring>   // memcmp() of the translated code
+#include <sstream>
+
+#include "../inc/aot.h"
+
+/*
+    AOT engine - an image translated to C++ by the translator (src/translator.cpp) and built together with the emulator
+
+    - the translated unit registers the image and one function for every basic block reachable from the IVT entries
+    - a block is entered by the dispatcher only while memory still holds the bytes it was translated from, a store
+      into its code disables it until the bytes are the same again (see aotValidate())
+    - commands that are not translated, and pc values without a block (e.g. indirect jumps into code the translator
+      has not seen), are executed by the interpreter
+    - every command is counted before its execution and a block returns to the dispatcher as soon as an event is
+      due, so device events and interrupts come in the same cycles as with the switch engine
+*/
+
+const AotProgram *AotRuntime::program = nullptr;
+
+bool AotRuntime::registerProgram(const AotProgram *translatedProgram) {
+    program = translatedProgram;
+    return true;
+}
+
+/* helpers called from the translated code */
+int AotRuntime::execute(AotContext &c, unsigned address) {
+    Emulator *e = c.emulator;
+    bool running = true;
+
+    e->registers[R_INDEX::pc] = address;
+    e->cd = {};
+    if (!e->commandFetchAndDecode() || !e->commandExecute(running)) return AOT_EXIT_ERROR + 1;
+    e->aotInterpretedCommands++;
+    if (!running) return AOT_EXIT_HALT + 1;
+    return e->aotCodeModified ? AOT_EXIT_CONTINUE + 1 : 0;
+}
+
+int AotRuntime::store(AotContext &c, unsigned address, short value) {
+    Emulator *e = c.emulator;
+    e->writeToMemory(address, WORD, value);
+    return e->aotCodeModified ? AOT_EXIT_CONTINUE + 1 : 0;
+}
+
+void AotRuntime::recordFlags(AotContext &c, short mnemonic, char rDst, char rSrc, short result) {
+    Emulator *e = c.emulator;
+    e->cd.mnemonic = mnemonic;
+    e->cd.rDst = rDst;
+    e->cd.rSrc = rSrc;
+    e->recordPswFlags(result);
+}
+
+bool AotRuntime::jumpCondition(AotContext &c, short mnemonic) {
+    Emulator *e = c.emulator;
+    e->cd.mnemonic = mnemonic;
+    return e->evaluateJumpCondition();
+}
+
+void AotRuntime::backwardJump(AotContext &c, unsigned nextAddress) {
+    Emulator *e = c.emulator;
+    if (e->idleLoopSkipEnabled) e->checkIdleLoop(nextAddress);
+}
+
+/* AOT engine */
+bool Emulator::aotExecute() {
+    const AotProgram *program = AotRuntime::program;
+    if (program == nullptr) { // an executable without a translated program uses the threaded engine instead
+        engine = ENGINE::threaded_engine;
+        return threadedExecute();
+    }
+
+    /* the code of every block is looked up in memory before the block is entered for the first time */
+    if (aotBlocks.empty()) {
+        aotBlocks.assign(MEMORY_SIZE, -1);
+        aotCodeBytes.assign(MEMORY_SIZE, 0);
+        for (unsigned i = 0; i < program->nOfBlocks; i++)
+            for (unsigned j = 0; j < program->blocks[i].length; j++)
+                aotCodeBytes[0xFFFF & (program->blocks[i].address + j)] = 1;
+        aotCodeModified = true;
+    }
+
+    AotContext context = {&registers[0], &memory[0], &instructionsRetired, &nextEventCycle, this};
+
+    while (true) {
+        /* device events are checked at the entry of every block, the blocks exit as soon as one is due */
+        if (instructionsRetired >= nextEventCycle) {
+            handleEvents();
+            if (stopRequested) return true;
+        }
+        if (aotCodeModified) aotValidate();
+
+        int block = aotBlocks[0xFFFF & registers[R_INDEX::pc]];
+        if (block < 0) { // the interpreter executes (or reports) what has not been translated
+            bool running = true;
+            cd = {};
+            if (!commandFetchAndDecode()) return false;
+            instructionsRetired++;
+            if (!commandExecute(running)) return false;
+            aotInterpretedCommands++;
+            if (!running) break;
+            continue;
+        }
+
+        aotBlockEntries++;
+        int exitCode = program->blocks[block].function(context);
+        if (exitCode == AOT_EXIT_HALT) {
+            /* 'cd' of halt is expected after the emulation */
+            cd = {};
+            cd.mnemonic = MNEMONIC::halt;
+            break;
+        }
+        if (exitCode == AOT_EXIT_ERROR) return false;
+    }
+
+    // events due in the cycle of halt are handled, like in the switch engine
+    if (instructionsRetired >= nextEventCycle) handleEvents();
+    return true;
+}
+
+void Emulator::aotValidate() {
+    const AotProgram *program = AotRuntime::program;
+
+    for (unsigned i = 0; i < program->nOfBlocks; i++) {
+        const AotBlock &block = program->blocks[i];
+        bool unchanged = memcmp(&memory[block.address], block.code, block.length) == 0;
+        aotBlocks[block.address] = unchanged ? i : -1;
+    }
+    aotCodeModified = false;
+}
+
+/* check mode - the built-in image is emulated by the interpreter and by the translated code */
+bool AotRuntime::check(function<void(Emulator &)> configure, ostream &out) {
+    if (program == nullptr) {
+        out << "The executable does not contain a translated program." << endl;
+        return false;
+    }
+
+    // no terminal input, since it could not be given to both emulations
+    Emulator interpreter(""), translated("");
+    Emulator *emulators[2] = {&interpreter, &translated};
+    ostringstream outputs[2];
+    bool succeeded[2];
+    for (unsigned i = 0; i < 2; i++) {
+        Emulator &e = *emulators[i];
+        configure(e);
+        e.setEngine(i == 0 ? ENGINE::switch_engine : ENGINE::aot_engine);
+        e.setOutputStream(&outputs[i]);
+        e.setTerminalInput(-1);
+        succeeded[i] = e.prepare() && e.execute();
+    }
+
+    /* the final states have to be the same */
+    vector<string> differences;
+    if (succeeded[0] != succeeded[1] || interpreter.getErrorMessages() != translated.getErrorMessages())
+        differences.push_back("emulating errors");
+    if (interpreter.programHalted != translated.programHalted) differences.push_back("halt");
+    if (interpreter.instructionsRetired != translated.instructionsRetired) differences.push_back("instructions retired");
+    const char *registerNames[NO_REGISTERS] = {"r0", "r1", "r2", "r3", "r4", "r5", "r6", "r7", "psw"};
+    for (unsigned i = 0; i < NO_REGISTERS; i++)
+        if (interpreter.registers[i] != translated.registers[i]) differences.push_back(registerNames[i]);
+    if (interpreter.memory != translated.memory) differences.push_back("memory");
+    if (outputs[0].str() != outputs[1].str()) differences.push_back("terminal output");
+
+    out << "AOT check: " << program->imagePath << ", blocks=" << program->nOfBlocks;
+    out << ", instructions=" << translated.instructionsRetired << ", block entries=" << translated.aotBlockEntries;
+    out << ", interpreted commands=" << translated.aotInterpretedCommands << endl;
+    if (differences.empty()) {
+        out << "The translated program and the interpreter end in the same state." << endl;
+        return true;
+    }
+    out << "The translated program differs from the interpreter in:";
+    for (string &difference : differences)
+        out << " " << difference;
+    out << endl;
+    return false;
+}
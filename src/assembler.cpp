@@ -1,40 +1,119 @@
 #include <iostream>
 #include <fstream>
 #include <iomanip>
+#include <sstream>
+#include <algorithm>  // sort()
+#include <thread>
+#include <atomic>
+#include <cstdlib>    // strtoul()
+#include <sys/stat.h> // mkdir()
 
 #include "../inc/assembler.h"
-#include "../inc/regexes.h"
 
-unsigned Assembler::nextSymbolID = 0;
-unsigned Assembler::nextSectionID = 0;
+/* object file of a source in the output directory: '<path>/<name>.s' -> '<outputDirectory>/<name>.o' */
+static string objectFilePath(string outputDirectory, string inputFilePath) {
+    string name = inputFilePath.substr(inputFilePath.find_last_of('/') + 1);
+    if (name.size() > 2 && name.compare(name.size() - 2, 2, ".s") == 0) name.erase(name.size() - 2);
+    return outputDirectory + "/" + name + ".o";
+}
 
 /* main program */
 int main(int argc, const char *argv[]) {
-    // expected format: './asembler -o <output_file> <input_file>'
-    if (argc < 2) {
-        cout << "Files paths are not specified." << endl;
-        return -1;
+    // expected format: './asembler [-j <threads>] -o <output_file> <input_file>' or
+    //                  './asembler [-j <threads>] -o <output_directory> <input_file_1> ... <input_file_n>'
+    unsigned jobs = thread::hardware_concurrency();
+    string outputPath = "";
+    vector<string> inputFilePaths;
+
+    for (int i = 1; i < argc; i++) {
+        string currentArgument = argv[i];
+        if ((currentArgument == "-o" || currentArgument == "-j") && i + 1 == argc) {
+            cout << "Option " << currentArgument << " requires an argument." << endl;
+            return -1;
+        }
+
+        if (currentArgument == "-o") outputPath = argv[++i];
+        else if (currentArgument == "-j") jobs = strtoul(argv[++i], nullptr, 10);
+        else inputFilePaths.push_back(currentArgument);
     }
-    if ((string)argv[1] == "-o" && argc < 4) {
-        cout << "Input file path is not specified." << endl;
+    if (inputFilePaths.empty()) {
+        cout << (outputPath.empty() ? "Files paths are not specified." : "Input file path is not specified.") << endl;
         return -1;
     }
 
-    /* creating the 'assembler' object */
-    string outputFilePath = (string)argv[1] == "-o" ? argv[2] : "assembler_output_generic.o";
-    string inputFilePath = (string)argv[1] == "-o" ? argv[3] : argv[1];
-    Assembler assembler(inputFilePath, outputFilePath);
+    /* a single source is assembled to the output file, several sources to the output directory (one object file each) */
+    struct stat info;
+    bool toDirectory = inputFilePaths.size() > 1 || (!outputPath.empty() && stat(outputPath.c_str(), &info) == 0 && S_ISDIR(info.st_mode));
+    if (!toDirectory) {
+        Assembler assembler(inputFilePaths[0], outputPath.empty() ? "assembler_output_generic.o" : outputPath);
 
-    /* assembling start */
-    if (!assembler.assemble()) {
-        assembler.printErrorMessages();
+        /* assembling start */
+        if (!assembler.assemble(cout)) {
+            assembler.printErrorMessages(cout);
+            return -1;
+        }
+        return 0;
+    }
+
+    if (outputPath.empty()) outputPath = ".";
+    if (stat(outputPath.c_str(), &info) != 0 && mkdir(outputPath.c_str(), 0777) != 0) {
+        cout << "Can't create the directory " << outputPath << "." << endl;
         return -1;
     }
-    return 0;
+
+    /* the object files are named after the sources only ('a/x.s' and 'b/x.s' would both write x.o, 'x.s' and 'x_text.s'
+       x_text.o), so the paths of both files of every source are checked before any worker starts writing */
+    vector<string> objectFilePaths;
+    map<string, unsigned> sourceOfOutput;
+    for (unsigned file = 0; file < inputFilePaths.size(); file++) {
+        objectFilePaths.push_back(objectFilePath(outputPath, inputFilePaths[file]));
+        const string &path = objectFilePaths.back();
+        for (const string &outputFilePath : {path, path.substr(0, path.size() - 2) + "_text.o"}) { // see writeTextFile()
+            auto inserted = sourceOfOutput.insert({outputFilePath, file});
+            if (!inserted.second) {
+                cout << "Input files " << inputFilePaths[inserted.first->second] << " and " << inputFilePaths[file] << " would both write "
+                     << outputFilePath << "." << endl;
+                return -1;
+            }
+        }
+    }
+
+    /* the workers take the sources in turn; the reports are kept until all of them are assembled */
+    vector<string> reports(inputFilePaths.size());
+    vector<char> failed(inputFilePaths.size(), false);
+    atomic<unsigned> nextFile(0);
+
+    auto worker = [&]() {
+        for (unsigned file = nextFile++; file < inputFilePaths.size(); file = nextFile++) {
+            ostringstream report;
+            Assembler assembler(inputFilePaths[file], objectFilePaths[file]);
+            if (!assembler.assemble(report)) {
+                assembler.printErrorMessages(report);
+                failed[file] = true;
+            }
+            reports[file] = report.str();
+        }
+    };
+
+    jobs = max(1u, min<unsigned>(jobs, inputFilePaths.size()));
+    vector<thread> workers;
+    for (unsigned i = 1; i < jobs; i++)
+        workers.emplace_back(worker);
+    worker(); // the calling thread is a worker too
+    for (thread &t : workers)
+        t.join();
+
+    /* the reports in the order of the sources, as if they were assembled one at a time */
+    bool errorOccurred = false;
+    for (unsigned file = 0; file < inputFilePaths.size(); file++) {
+        cout << reports[file];
+        if (failed[file]) errorOccurred = true;
+    }
+    return errorOccurred ? -1 : 0;
 }
 
 /* constructor */
-Assembler::Assembler(string inputFilePath, string outputFilePath) : inputFilePath(inputFilePath), outputFilePath(outputFilePath), locationCounter(0), errorOccurred(false) {
+Assembler::Assembler(string inputFilePath, string outputFilePath) : inputFilePath(inputFilePath), outputFilePath(outputFilePath), errorOccurred(false), nextSymbolID(0), nextSectionID(0), locationCounter(0), currentSection(StringInterner::NONE) {
     // adding section 'UNDEF' with id == 0 to the section and symbol tables
     // 'UNDEF' will contain undefined global symbols
     addSectionSymbol("UNDEF");
@@ -43,160 +122,110 @@ Assembler::Assembler(string inputFilePath, string outputFilePath) : inputFilePat
     // 'ABS' will contain symbols defined via .equ (not implemented for this assembler)
     addSectionSymbol("ABS");
 
-    currentSection = "";
+    currentSection = StringInterner::NONE;
 }
 
 /* assemble() and methods called by it */
-bool Assembler::assemble() {
-    /* opening and reading the input file */
-    if (!readFile()) {
-        cout << "Can't open the file " << inputFilePath << "." << endl;
+bool Assembler::assemble(ostream &out) {
+    /* opening the input file */
+    if (!openFile()) {
+        out << "Can't open the file " << inputFilePath << "." << endl;
         return false;
     }
 
-    /* assembler pass using the input file vector 'inputFile' */
+    /* assembler pass reading the input file line by line */
     if (!assemblePass() || !backpatching()) return false;
 
     /* printing of text and object files */
     if (!writeTextFile() || !writeBinaryFile()) {
-        cout << "Can't open the file " << outputFilePath << " for writing." << endl;
+        out << "Can't open the file " << outputFilePath << " for writing." << endl;
         return false;
     }
 
     return true;
 }
 
-bool Assembler::readFile() {
-    ifstream file; // input assembly source code (aka .s file)
-    string inputLine;
-
-    /* file opening */
-    file.open(inputFilePath);
-    if (!file.is_open()) return false;
-
-    /* reading the input file line by line */
-    unsigned inputFileLineNumber = 0;  // effectively starts at 1
-    inputFileLineNumbers.push_back(0); // we will count only from currentLine == 1
-    while (getline(file, inputLine)) {
-        inputFileLineNumber++;
-        inputLine = regex_replace(inputLine, commentsRegex, "$1", regex_constants::format_first_only);
-        inputLine = regex_replace(inputLine, tabsRegex, " ");
-
-        inputLine = regex_replace(inputLine, extraSpacesRegex, " ");       // let's replace all extra spaces with a single space
-        inputLine = regex_replace(inputLine, extraBoundsSpacesRegex, "$2"); // let's replace all extra spaces with a single space on both ends
-        inputLine = regex_replace(inputLine, commaSpacesRegex, ",");       // '... , ...' -> ','
-        inputLine = regex_replace(inputLine, colonSpacesRegex, ":");       // '... : ...' -> ':'
-
-        if (inputLine != " " && inputLine != "") {
-            inputFileLineNumbers.push_back(inputFileLineNumber);
-            Assembler::inputFile.push_back(inputLine);
-        }
-    }
-
-    /* file closing */
-    file.close();
-    return true; // everything went well
+bool Assembler::openFile() {
+    return source.open(inputFilePath); // the lines are read by assemblePass()
 }
 
 bool Assembler::assemblePass() {
     // cout << "Pass:\n" << endl;
 
+    Lexer lexer;            // tokens of the current line
+    string_view sourceLine; // the line as it is in the input file
+    string inputLine;       // the cleared line (without comments, tabs and extra spaces, '... , ...' -> '...,...')
+    vector<string_view> arguments; // views of the tokens, like the names below (the storage is kept between lines)
     currentLine = 0;
-    for (string inputLine : inputFile) {
-        bool match1 = false, match2 = false;
-        smatch matchedLineParts; // match object that contains matched string
+    while (source.nextLine(sourceLine)) {
+        arguments.clear();
+        string_view labelName, sectionName, literal;
         currentLine++;
 
+        Lexer::clearLine(sourceLine, inputLine);
+        if (inputLine == " " || inputLine == "") continue;
+        lexer.tokenize(inputLine);
+
         // cout << "(" << currentSection << ":" << locationCounter << ")" << inputLine << endl;
 
         /* label at the beginning of the 'inputLine' */
-        if ((match1 = regex_search(inputLine, matchedLineParts, labelRegex)) || (match2 = regex_search(inputLine, matchedLineParts, labelWithInstructionRegex))) {
-            string labelName = matchedLineParts.str(1); // let's extract 'labelName' from 'labelName: <instruction>'
-
-            // cout << "RX_label:" << endl;
-            // cout << "Find:#" << labelName << endl;
-
+        bool isCarriageReturned = inputLine.find('\r') != string::npos; // (a CRLF file) the rest of a line is not taken past a '\r'
+        if (lexer.symbol(labelName) && lexer.punctuator(':') && (lexer.end() || !isCarriageReturned)) {
             if (!addSymbol(labelName)) errorOccurred = true;
 
             /* label followed with an instruction (command or directive) */
-            if (match2)
-                inputLine = matchedLineParts.str(2); // '<instruction>' part to be processed in one of the following if statements
-            else continue;
-        }
+            if (lexer.end()) continue; // otherwise the instruction is processed by one of the following if statements
+        } else lexer.reset(0);
+        unsigned instruction = lexer.mark();
 
         /* .extern and .global directives */
-        if ((match1 = regex_search(inputLine, matchedLineParts, externDirectiveRegex)) || (match2 = regex_search(inputLine, matchedLineParts, globalDirectiveRegex))) {
-            string symbol, symbolList = matchedLineParts.str(1); // '.extern/.global <s1>, ... <sn>' -> '<s1>, ..., <sn>'
-            stringstream ss(symbolList);
-
-            // cout << "Extern/Global:" << endl;
-            // cout << "Find:#" << symbolList << endl;
-
+        bool isExtern = false;
+        if (lexer.punctuator('.') && ((isExtern = lexer.keyword("extern")) || lexer.keyword("global")) && parseList(lexer, true, arguments)) {
             /* we take one symbol at a time from the list and add it to the symbol table */
-            while (getline(ss, symbol, ',')) {
-                // cout << "#" << symbol << endl;
-                if (match1 && !addExternSymbol(symbol)) errorOccurred = true;
-                if (match2 && !addGlobalSymbol(symbol)) errorOccurred = true;
+            for (string_view symbol : arguments) {
+                if (isExtern && !addExternSymbol(symbol)) errorOccurred = true;
+                if (!isExtern && !addGlobalSymbol(symbol)) errorOccurred = true;
             }
-            // cout << "###" << endl;
             continue;
         }
+        lexer.reset(instruction);
 
         /* .section directive */
-        if (regex_search(inputLine, matchedLineParts, sectionDirectiveRegex)) {
-            string sectionName = matchedLineParts.str(1); // '.section sectionName' -> 'sectionName'
-
-            // cout << "Section_start:" << endl;
-            // cout << "Find:#" << sectionName << endl;
-
+        if (lexer.punctuator('.') && lexer.keyword("section") && lexer.space() && lexer.symbol(sectionName) && lexer.end()) {
             if (!addSectionSymbol(sectionName)) errorOccurred = true;
-            // cout << "###" << endl;
             continue;
         }
+        lexer.reset(instruction);
 
         /* .word directive */
-        if (regex_search(inputLine, matchedLineParts, wordDirectiveRegex)) {
-            string literalOrSymbol, valueList = matchedLineParts.str(1); // '.word <s1/l1>, ..., <sn/ln>' -> '<s1/l1>, ..., <sn/ln>'
-
-            // cout << "WORD:" << endl;
-            // cout << "Find:#" << valueList << endl;
-
+        if (lexer.punctuator('.') && lexer.keyword("word") && parseList(lexer, false, arguments)) {
             /* we take one symbol/literal at a time from the list and add symbol to the symbol table */
-            stringstream ss(valueList);
-            while (getline(ss, literalOrSymbol, ',')) {
-                // cout << "#" << literalOrSymbol << endl;
+            for (string_view literalOrSymbol : arguments)
                 if (!processWordDirective(literalOrSymbol)) errorOccurred = true;
-            }
-            // cout << "###" << endl;
             continue;
         }
+        lexer.reset(instruction);
 
         /* .skip directive */
-        if (regex_search(inputLine, matchedLineParts, skipDirectiveRegex)) {
-            string literal = matchedLineParts.str(1);
-
-            // cout << "SKIP_found:" << endl;
-            // cout << "Find:#" << literal << endl;
-
+        if (lexer.punctuator('.') && lexer.keyword("skip") && lexer.space() && lexer.literal(literal) && lexer.end()) {
             if (!processSkipDirective(literal)) errorOccurred = true;
-            // cout << "###" << endl;
             continue;
         }
+        lexer.reset(instruction);
 
         /* .end directive */
-        if (regex_search(inputLine, matchedLineParts, endDirectiveRegex)) {
+        if (lexer.punctuator('.') && lexer.keyword("end") && lexer.end()) {
             break; // end of an assembler pass
         }
+        lexer.reset(instruction);
 
         /* assembler command in the 'inputLine' */
-        // cout << "Command_Found:" << endl;
-        if (!processCommand(inputLine)) errorOccurred = true;
-        // cout << "###" << endl;
+        if (!processCommand(lexer)) errorOccurred = true;
     }
 
     /* closing the last section in the file */
-    if (currentSection != "")
-        sectionTable[currentSection].length = locationCounter;
+    if (currentSection != StringInterner::NONE)
+        section(currentSection).length = locationCounter;
 
     return !errorOccurred;
 }
@@ -204,9 +233,7 @@ bool Assembler::assemblePass() {
 bool Assembler::backpatching() {
     // cout << "\nBackpatching:\n" << endl;
     for (ForwardReferenceTableRecord &record : forwardReferenceTable) {
-        auto item = symbolTable.find(record.symbol);
-
-        if (item != symbolTable.end()) { // symbol found in the symbol table
+        if (findSymbol(record.symbol) != nullptr) { // symbol found in the symbol table
             short fillValue;
 
             /* we change LC and currentSection for the following calls to make the correct relocation records */
@@ -222,16 +249,16 @@ bool Assembler::backpatching() {
             }
 
             /* we modify a 2B of data with the value 'fillValue' now that we have the symbol in the table */
-            SectionTableRecord &section = sectionTable[currentSection];
+            vector<char> &sectionData = section(currentSection).sectionData;
             if (record.isLittleEndian) { // directives use little endian
-                section.sectionData[record.offset] = 0xFF & fillValue;
-                section.sectionData[record.offset + 1] = 0xFF & (fillValue >> 8);
+                sectionData[record.offset] = 0xFF & fillValue;
+                sectionData[record.offset + 1] = 0xFF & (fillValue >> 8);
             } else { // commands use big endian
-                section.sectionData[record.offset] = 0xFF & (fillValue >> 8);
-                section.sectionData[record.offset + 1] = 0xFF & fillValue;
+                sectionData[record.offset] = 0xFF & (fillValue >> 8);
+                sectionData[record.offset + 1] = 0xFF & fillValue;
             }
         } else {
-            errorMessages.insert({record.currentLine, "Symbol " + record.symbol + " is not in the symbol table."});
+            errorMessages.insert({record.currentLine, "Symbol " + string(names.name(record.symbol)) + " is not in the symbol table."});
             errorOccurred = true;
         }
     }
@@ -259,6 +286,13 @@ bool Assembler::writeTextFile() {
     return true; // everything went well
 }
 
+/* a name in the binary file - the number of characters (bytes) followed by the characters */
+static void writeName(ostream &file, string_view name) {
+    unsigned length = name.size();
+    file.write((char *)(&length), sizeof(length));
+    file.write(name.data(), length);
+}
+
 bool Assembler::writeBinaryFile() {
     ofstream file; // output binary .o file
 
@@ -270,39 +304,29 @@ bool Assembler::writeBinaryFile() {
     unsigned tmp = sectionTable.size(); // the number of "rows" (sections) in the section table
     file.write((char *)(&tmp), sizeof(tmp));
 
-    // linker implementation will have to read sections sorted by the id (not by the name)
-    map<int, SectionTableRecord> sectionTableOrderedByID; // map by default sorts elements by the integer key in the ascending order
-    for (auto item = sectionTable.begin(); item != sectionTable.end(); item++) {
-        SectionTableRecord &section = item->second;
-        sectionTableOrderedByID.insert({section.id, section});
-    }
-
-    for (auto item = sectionTableOrderedByID.begin(); item != sectionTableOrderedByID.end(); item++) {
-        SectionTableRecord &section = item->second;
+    // linker implementation will have to read sections sorted by the id (not by the name) - the order of the 'sectionTable'
+    for (SectionTableRecord &section : sectionTable) {
 
         /* section.id and section.length */
         file.write((char *)(&section.id), sizeof(section.id));
         file.write((char *)(&section.length), sizeof(section.length));
 
         /* section.name */
-        tmp = section.name.length(); // number of characters (bytes) in the section name
-
-        file.write((char *)(&tmp), sizeof(tmp));
-        file.write((char *)section.name.c_str(), tmp);
+        writeName(file, names.name(section.name));
 
         /* section.sectionData */
         tmp = section.sectionData.size(); // section data length
 
         file.write((char *)(&tmp), sizeof(tmp));
-        file.write((char *)(&section.sectionData[0]), section.sectionData.size() * sizeof(section.sectionData[0]));
+        file.write(section.sectionData.data(), section.sectionData.size() * sizeof(section.sectionData[0]));
     }
 
     /* writing the symbol table */
     tmp = symbolTable.size(); // number of "rows" (symbols) in the symbol table
     file.write((char *)(&tmp), sizeof(tmp));
 
-    for (auto item = symbolTable.begin(); item != symbolTable.end(); item++) {
-        SymbolTableRecord &symbol = item->second;
+    for (unsigned id : symbolsByName()) {
+        SymbolTableRecord &symbol = symbolTable[id];
 
         /* symbol.id and symbol.offset */
         file.write((char *)(&symbol.id), sizeof(symbol.id));
@@ -314,43 +338,28 @@ bool Assembler::writeBinaryFile() {
         file.write((char *)(&symbol.isExtern), sizeof(symbol.isExtern));
 
         /* symbol.section */
-        tmp = symbol.section.length(); // number of characters (bytes) in the section name
-
-        file.write((char *)(&tmp), sizeof(tmp));
-        file.write((char *)symbol.section.c_str(), tmp);
+        writeName(file, names.name(symbol.section));
 
         /* symbol.name */
-        tmp = symbol.name.length(); // number of characters (bytes) in the symbol name
-
-        file.write((char *)(&tmp), sizeof(tmp));
-        file.write((char *)symbol.name.c_str(), tmp);
+        writeName(file, names.name(symbol.name));
     }
 
     /* writing the relocation table */
     tmp = relocationTable.size(); // number of relocation records in the relocation table
     file.write((char *)(&tmp), sizeof(tmp));
 
-    for (RelocationTableRecord r : relocationTable) {
+    for (RelocationTableRecord &r : relocationTable) {
         /* r.section */
-        tmp = r.section.length(); // number of characters (bytes) in the section name
-
-        file.write((char *)(&tmp), sizeof(tmp));
-        file.write((char *)r.section.c_str(), tmp);
+        writeName(file, names.name(r.section));
 
         /* r.offset */
         file.write((char *)(&r.offset), sizeof(r.offset));
 
         /* r.type */
-        tmp = r.type.length(); // number of characters (bytes) in the relocation type string
-
-        file.write((char *)(&tmp), sizeof(tmp));
-        file.write((char *)r.type.c_str(), tmp);
+        writeName(file, r.type);
 
         /* r.symbol */
-        tmp = r.symbol.length(); // number of characters (bytes) in the symbol name
-
-        file.write((char *)(&tmp), sizeof(tmp));
-        file.write((char *)r.symbol.c_str(), tmp);
+        writeName(file, names.name(r.symbol));
 
         /* r.addend */
         // file.write((char*)(&r.addend), sizeof(r.addend)); // unused
@@ -362,18 +371,19 @@ bool Assembler::writeBinaryFile() {
 }
 
 /* methods for directives and commands processing - called by assemblePass() */
-bool Assembler::addSymbol(string symbolLabel) {
+bool Assembler::addSymbol(string_view symbolLabel) {
     /* we check if any section is open */
-    if (currentSection == "") {
+    if (currentSection == StringInterner::NONE) {
         errorMessages.insert({currentLine, "Symbol as label has to be defined in a section."});
         return false;
     }
 
     /* we check if the symbol of the same name is already defined */
-    auto item = symbolTable.find(symbolLabel);
+    unsigned name = intern(symbolLabel);
+    SymbolTableRecord *item = findSymbol(name);
 
-    if (item != symbolTable.end()) { // symbol found in the symbol table
-        SymbolTableRecord &symbol = item->second;
+    if (item != nullptr) { // symbol found in the symbol table
+        SymbolTableRecord &symbol = *item;
         if (symbol.isDefined || symbol.isExtern) {
             string messageString = symbol.isDefined ? "Symbol is previously defined." : "Symbol with the same name is already imported.";
             errorMessages.insert({currentLine, messageString});
@@ -391,33 +401,37 @@ bool Assembler::addSymbol(string symbolLabel) {
         symbol.isDefined = symbol.isLocal = true;
         symbol.isExtern = false;
 
-        symbol.name = symbolLabel;
+        symbol.name = name;
         symbol.section = currentSection;
         symbol.offset = locationCounter;
 
-        symbolTable.insert({symbol.name, symbol});
+        symbolOfName[name] = symbol.id;
+        symbolTable.push_back(symbol);
     }
     return true;
 }
 
-bool Assembler::addSectionSymbol(string sectionName) { // .section directive
+bool Assembler::addSectionSymbol(string_view sectionName) { // .section directive
     /* we check if this is the first section to be open */
-    if (currentSection != "") {
-        sectionTable[currentSection].length = locationCounter;
-        // cout << "End section: " << sectionTable[currentSection].length << "-" << locationCounter << endl;
+    if (currentSection != StringInterner::NONE) {
+        section(currentSection).length = locationCounter;
+        // cout << "End section: " << section(currentSection).length << "-" << locationCounter << endl;
     }
 
     /* the new section opening */
     locationCounter = 0; // let's reset the 'locationCounter'
-    currentSection = sectionName;
+    currentSection = intern(sectionName);
 
-    /* we add a new section to the section table */
+    /* we add a new section to the section table (a section opened again keeps its record, the id is used up anyway) */
     SectionTableRecord section;
     section.id = nextSectionID++;
-    section.name = sectionName;
+    section.name = currentSection;
 
     section.length = 0;
-    sectionTable.insert({section.name, section});
+    if (sectionOfName[currentSection] == StringInterner::NONE) {
+        sectionOfName[currentSection] = sectionTable.size();
+        sectionTable.push_back(section);
+    }
 
     /* we add the new section name to the symbol table */
     addSymbol(sectionName); // adds the section as a symbol to the symbol table
@@ -425,12 +439,13 @@ bool Assembler::addSectionSymbol(string sectionName) { // .section directive
     return true;
 }
 
-bool Assembler::addGlobalSymbol(string symbolName) { // .global directive
+bool Assembler::addGlobalSymbol(string_view symbolName) { // .global directive
     /* we check if the symbol of the same name is already defined */
-    auto item = symbolTable.find(symbolName);
+    unsigned name = intern(symbolName);
+    SymbolTableRecord *item = findSymbol(name);
 
-    if (item != symbolTable.end()) { // symbol found in the symbol table
-        SymbolTableRecord &symbol = item->second;
+    if (item != nullptr) { // symbol found in the symbol table
+        SymbolTableRecord &symbol = *item;
         if (symbol.isExtern) {
             errorMessages.insert({currentLine, "Symbol with the same name has an external definition."});
             return false;
@@ -446,21 +461,23 @@ bool Assembler::addGlobalSymbol(string symbolName) { // .global directive
         symbol.isDefined = false; // because we add it to the table encountering '.global symbolName'
         symbol.isLocal = symbol.isExtern = false;
 
-        symbol.name = symbolName;
-        symbol.section = "UNDEF"; // because we add it to the table encountering '.global symbolName'
+        symbol.name = name;
+        symbol.section = UNDEF; // because we add it to the table encountering '.global symbolName'
         symbol.offset = 0;
 
-        symbolTable.insert({symbol.name, symbol});
+        symbolOfName[name] = symbol.id;
+        symbolTable.push_back(symbol);
     }
     return true;
 }
 
-bool Assembler::addExternSymbol(string symbolName) { // .extern directive
+bool Assembler::addExternSymbol(string_view symbolName) { // .extern directive
     /* we check if the symbol of the same name is already defined */
-    auto item = symbolTable.find(symbolName);
+    unsigned name = intern(symbolName);
+    SymbolTableRecord *item = findSymbol(name);
 
-    if (item != symbolTable.end()) { // symbol found in the symbol table
-        SymbolTableRecord &symbol = item->second;
+    if (item != nullptr) { // symbol found in the symbol table
+        SymbolTableRecord &symbol = *item;
         if (symbol.isDefined) { // <=> symbol.isDefined || symbol.isLocal
             errorMessages.insert({currentLine, "Symbol is previously defined locally."});
             return false;
@@ -477,28 +494,29 @@ bool Assembler::addExternSymbol(string symbolName) { // .extern directive
         symbol.isLocal = false;
         symbol.isExtern = true;
 
-        symbol.name = symbolName;
-        symbol.section = "UNDEF"; // because we add it to the table encountering '.extern symbolName'
+        symbol.name = name;
+        symbol.section = UNDEF; // because we add it to the table encountering '.extern symbolName'
         symbol.offset = 0;
 
-        symbolTable.insert({symbol.name, symbol});
+        symbolOfName[name] = symbol.id;
+        symbolTable.push_back(symbol);
     }
     return true;
 }
 
-bool Assembler::processWordDirective(string literalOrSymbol) { // .word directive
+bool Assembler::processWordDirective(string_view literalOrSymbol) { // .word directive
     /* .word directive must be specified within a section */
-    if (currentSection == "") {
+    if (currentSection == StringInterner::NONE) {
         errorMessages.insert({currentLine, "Directive .word is not specified within a section."});
         return false;
     }
     // cout << "WORD_pass:" << literalOrSymbol << "->";
 
     /* the .word argument list can contain literals and symbols; 2B is allocated for all list elements */
-    SectionTableRecord &section = sectionTable[currentSection];
+    SectionTableRecord &section = this->section(currentSection);
 
     int fillValue;
-    if (regex_match(literalOrSymbol, regex("^(" + symbolPattern + ")$"))) { // we are processing a symbol
+    if (Lexer::isSymbol(literalOrSymbol)) { // we are processing a symbol
         /*
             let's allocate 2B for a symbol and in an address field leave:
             - symbol.offset for local symbols leave
@@ -512,7 +530,7 @@ bool Assembler::processWordDirective(string literalOrSymbol) { // .word directiv
               so for the given 'locationCounter' we create a relocation record
             - if the symbol is not in the symbol table, a forward referencing record is created
         */
-        fillValue = absoluteAddressing(literalOrSymbol, true, '+'); // isLittleEndian == true (because the .word is a directive)
+        fillValue = absoluteAddressing(intern(literalOrSymbol), true, '+'); // isLittleEndian == true (because the .word is a directive)
     } else fillValue = getDecimalFromLiteral(literalOrSymbol); // we are processing a literal
 
     /* the .word directive allocates 2B filled with the 'fillValue' */
@@ -522,9 +540,9 @@ bool Assembler::processWordDirective(string literalOrSymbol) { // .word directiv
     return true;
 }
 
-bool Assembler::processSkipDirective(string literal) { // .skip directive
+bool Assembler::processSkipDirective(string_view literal) { // .skip directive
     /* .skip directive must be specified within a section */
-    if (currentSection == "") {
+    if (currentSection == StringInterner::NONE) {
         errorMessages.insert({currentLine, "Directive .skip is not specified within a section."});
         return false;
     }
@@ -533,7 +551,7 @@ bool Assembler::processSkipDirective(string literal) { // .skip directive
     int nOfBytes = getDecimalFromLiteral(literal);
 
     /* let's allocate space of 'nOfBytes' bytes */
-    SectionTableRecord &section = sectionTable[currentSection];
+    SectionTableRecord &section = this->section(currentSection);
 
     /* the .skip directive starting from the 'locationCounter' writes 5 bytes of zeros */
     for (int i = 0; i < nOfBytes; i++)
@@ -543,349 +561,242 @@ bool Assembler::processSkipDirective(string literal) { // .skip directive
     return true;
 }
 
-bool Assembler::processCommand(string inputLine) {
-    smatch matchedLineParts;
+bool Assembler::processCommand(Lexer &lexer) {
+    string_view inputLine = lexer.rest(), command; // the text of an error message is copied only then
     // cout << "COMMAND_pass:" << endl;
 
     /* assembler command must be specified within a section */
-    if (currentSection == "") {
-        errorMessages.insert({currentLine, "Command is not specified within a section. " + inputLine});
+    if (currentSection == StringInterner::NONE) {
+        errorMessages.insert({currentLine, "Command is not specified within a section. " + string(inputLine)});
         return false;
     }
 
-    /* command without operands (size == 1B) */
-    if (regex_search(inputLine, matchedLineParts, regex("^(halt|iret|ret)$"))) {
-        string command = matchedLineParts.str(1);
-        // cout << "Command_NOP_1B:#" << i;
+    /* the mnemonic gives the first byte and the operands that follow it (see inc/isa.h) */
+    const InstructionInfo *instruction = lexer.symbol(command) ? isaLookup(command) : nullptr;
+    SectionTableRecord &section = this->section(currentSection);
+    char rDIndex, rSIndex;
 
-        /* let's allocate space and fill it properly */
-        SectionTableRecord &section = sectionTable[currentSection];
-        section.sectionData.push_back(command == "halt" ? 0x00 : (command == "iret" ? 0x20 : 0x40));
-        locationCounter++;
+    switch (instruction != nullptr ? instruction->operands : operands_none) {
+        case operands_none: // halt, iret, ret (size == 1B)
+            if (instruction == nullptr || !lexer.end()) break;
 
-        return true;
-    }
-
-    /* command with a register as an operand (size == 2B [int, not] || size == 3B [push, pop]) */
-    if (regex_search(inputLine, matchedLineParts, regex("^(int|push|pop|not) (r[0-7]|psw)$"))) {
-        string command = matchedLineParts.str(1), r = matchedLineParts.str(2);
-        // cout << "Command_1OP:#" << i << "#reg:" << r;
-
-        /* let's allocate space and fill it properly */
-        char rIndex = r != "psw" ? (r.at(1) - '0') : 8; // r == 'rX' -> X
-        SectionTableRecord &section = sectionTable[currentSection];
+            section.sectionData.push_back(instruction->code);
+            locationCounter++;
+            return true;
 
-        if (command == "int" || command == "not") { // size == 2B
+        case operands_register: // int, not (size == 2B)
             /* int - software interrupt (the number of the IVT table entry for which the interrupt request is generated is in the 'r') */
             /* not - bitwise not */
-            section.sectionData.push_back(command == "int" ? 0x10 : 0x80); // first byte
-            section.sectionData.push_back(0x0F | (rIndex << 4));     // second byte - _ _ _ _ [reg] | 1 1 1 1
-        } else { // command == "push" || command == "pop"; size == 3B
-            /* push - places a value from the register in mem16[sp], but before that it executes sp <= sp - 2 (the stack grows downwards) */
-            /* pop - loads a value from mem16[sp] into the register, and then executes sp <= sp + 2 (sp points to the last occupied location) */
-            section.sectionData.push_back(command == "push" ? 0xB0 : 0xA0); // first byte
-            section.sectionData.push_back(0x06 | (rIndex << 4));      // second byte - _ _ _ _ [reg] | 0 1 1 0 [sp]
-            section.sectionData.push_back(command == "push" ? 0x12 : 0x42); // third byte - 1 or 4 [1: (sp--) x 2 before; 4: (sp++) x 2 after] | 0 0 1 0 [regind]
-        }
-        locationCounter += (command == "int" || command == "not" ? 2 : 3);
-
-        return true;
-    }
-
-    /* command with two registers as operands (size == 2B) */
-    if (regex_search(inputLine, matchedLineParts, regex("^(xchg|add|sub|mul|div|cmp|and|or|xor|test|shl|shr) (r[0-7]|psw),(r[0-7]|psw)$"))) {
-        string command = matchedLineParts.str(1), rD = matchedLineParts.str(2), rS = matchedLineParts.str(3);
-        // cout << "Command_2OP:#" << i << "#reg1:" << rD << "#reg2:" << rS;
-
-        /* let's allocate space and fill it properly */
-        char rDIndex = (rD != "psw" ? (rD.at(1) - '0') : 8), rSIndex = (rS != "psw" ? (rS.at(1) - '0') : 8);
-        SectionTableRecord &section = sectionTable[currentSection];
-
-        char tmpValue = 0x60; // command == "xchg"; value of the first byte
-        if (command == "add") tmpValue = 0x70;
-        else if (command == "sub") tmpValue = 0x71;
-        else if (command == "mul") tmpValue = 0x72;
-        else if (command == "div") tmpValue = 0x73;
-        else if (command == "cmp") tmpValue = 0x74;
-        else if (command == "and") tmpValue = 0x81;
-        else if (command == "or") tmpValue = 0x82;
-        else if (command == "xor") tmpValue = 0x83;
-        else if (command == "test") tmpValue = 0x84;
-        else if (command == "shl") tmpValue = 0x90;
-        else if (command == "shr") tmpValue = 0x91;
-
-        section.sectionData.push_back(tmpValue);                 // first byte
-        section.sectionData.push_back(rSIndex | (rDIndex << 4)); // second byte - _ _ _ _ [rDst] | _ _ _ _ [rSrc]
-
-        locationCounter += 2;
-        return true;
-    }
-
-    /* jump commands (all with one operand) */
-    if (regex_search(inputLine, matchedLineParts, regex("^(call|jmp|jeq|jne|jgt) (.*)$"))) {
-        string command = matchedLineParts.str(1), operand = matchedLineParts.str(2);
-        // cout << "JUMPS_1OP:#" << i << "#op:" << operand;
+            if (!lexer.space() || !lexer.reg(rDIndex) || !lexer.end()) break;
 
-        /*
-            we expect <[LC <= LC + 3 | a command has no payload]> for the following:
-                - register direct addressing <-> jmp *rX
-                - register indirect addressing <-> jmp *[rX]
-            we expect <[LC <= LC + 5 | a command has a payload]> for the following:
-                - absolute addressing of symbols and literals <-> jmp <symbol/literal>
-                - pc relative symbol addressing <-> jmp %<symbol>
-                - register indirect addressing with displacement <-> jmp *[rX +/- <symbol/literal>]
-                - memory direct addressing <-> jmp *<symbol/literal>
-        */
-
-        /* let's allocate space and fill it properly */
-        SectionTableRecord &section = sectionTable[currentSection];
-
-        int tmpValue = (command == "call" ? 0x30 : (command == "jmp" ? 0x50 : (command == "jeq" ? 0x51 : (command == "jne" ? 0x52 : 0x53))));
-        section.sectionData.push_back(0xFF & tmpValue); // first byte
-
-        /* register direct addressing <-> jmp *rX */
-        if (regex_search(operand, matchedLineParts, regex("^\\*(r[0-7]|psw)$"))) {
-            string r = matchedLineParts.str(1);
-            char rIndex = r != "psw" ? (r.at(1) - '0') : 8; // r == 'rX' -> X
-
-            section.sectionData.push_back(0xF0 | rIndex); // second byte - 1 1 1 1 | _ _ _ _ [rSrc == operand]
-            section.sectionData.push_back(0x01);          // third byte - 0 0 0 0 | 0 0 0 1 [regdir]
-
-            locationCounter += 3;
+            section.sectionData.push_back(instruction->code);     // first byte
+            section.sectionData.push_back(0x0F | (rDIndex << 4)); // second byte - _ _ _ _ [reg] | 1 1 1 1
+            locationCounter += 2;
             return true;
-        }
-
-        /* register indirect addressing <-> jmp *[rX] */
-        if (regex_search(operand, matchedLineParts, regex("^\\*\\[(r[0-7]|psw)\\]$"))) {
-            string r = matchedLineParts.str(1);
-            char rIndex = r != "psw" ? (r.at(1) - '0') : 8; // r == 'rX' -> X
 
-            section.sectionData.push_back(0xF0 | rIndex); // second byte - 1 1 1 1 | _ _ _ _ [rSrc == operand]
-            section.sectionData.push_back(0x02);          // third byte - 0 0 0 0 | 0 0 1 0 [regind]
+        case operands_stack: // push, pop (size == 3B)
+            /* push - places a value from the register in mem16[sp], but before that it executes sp <= sp - 2 (the stack grows downwards) */
+            /* pop - loads a value from mem16[sp] into the register, and then executes sp <= sp + 2 (sp points to the last occupied location) */
+            if (!lexer.space() || !lexer.reg(rDIndex) || !lexer.end()) break;
 
+            section.sectionData.push_back(instruction->code);     // first byte
+            section.sectionData.push_back(0x06 | (rDIndex << 4)); // second byte - _ _ _ _ [reg] | 0 1 1 0 [sp]
+            section.sectionData.push_back(__builtin_ctz(instruction->updateTypes) << 4 | ADDRESSING_MODE::regind); // third byte - [(sp--) x 2 before or (sp++) x 2 after] | [regind]
             locationCounter += 3;
             return true;
-        }
 
-        /* absolute addressing of symbols and literals <-> jmp <symbol/literal> */
-        if (regex_search(operand, matchedLineParts, regex("^(" + literalOrSymbolPattern + ")$"))) {
-            section.sectionData.push_back(0xFF); // second byte - 1 1 1 1 | 1 1 1 1 [reg; irrelevant, unused]
-            section.sectionData.push_back(0x00); // third byte - 0 0 0 0 | 0 0 0 0 [immed]
+        case operands_registers: // xchg, add, sub, ... (size == 2B)
+            if (!lexer.space() || !lexer.reg(rDIndex) || !lexer.punctuator(',') || !lexer.reg(rSIndex) || !lexer.end()) break;
 
-            /* 4th and 5th byte are the payload - the value that remains in the address field of the instruction */
-            if (regex_match(operand, regex("^(" + symbolPattern + ")$"))) // operand == symbol
-                tmpValue = absoluteAddressing(operand, false, '+');       // a relocation (or forward referencing) record is also created
-            else tmpValue = getDecimalFromLiteral(operand);
-
-            section.sectionData.push_back(0xFF & (tmpValue >> 8)); // fourth byte - most significant byte of the payload
-            section.sectionData.push_back(0xFF & tmpValue);        // fifth byte - least significant byte of the payload
-
-            locationCounter += 5;
+            section.sectionData.push_back(instruction->code);        // first byte
+            section.sectionData.push_back(rSIndex | (rDIndex << 4)); // second byte - _ _ _ _ [rDst] | _ _ _ _ [rSrc]
+            locationCounter += 2;
             return true;
-        }
-
-        /* pc relative symbol addressing <-> jmp %<symbol> */
-        if (regex_search(operand, matchedLineParts, regex("^%(" + symbolPattern + ")$"))) {
-            section.sectionData.push_back(0xF7); // second byte - 1 1 1 1 | 0 1 1 1 [rSrc == PC]
-            section.sectionData.push_back(0x05); // third byte - 0 0 0 0 | 0 1 0 1 [regdir with displacement; rSrc == PC]
-
-            /* 4th and 5th byte are the payload - the value that remains in the address field of the instruction */
-            tmpValue = relativeAddressing(matchedLineParts.str(1)); // a relocation (or forward referencing) record is also created
 
-            section.sectionData.push_back(0xFF & (tmpValue >> 8)); // fourth byte - most significant byte of the payload
-            section.sectionData.push_back(0xFF & tmpValue);        // fifth byte - least significant byte of the payload
-
-            locationCounter += 5;
-            return true;
-        }
-
-        /* register indirect addressing with displacement <-> jmp *[rX +/- <symbol/literal>] */
-        if (regex_search(operand, matchedLineParts, regex("^\\*\\[(r[0-7]|psw) \\+ (" + literalOrSymbolPattern + ")\\]$"))
-            || regex_search(operand, matchedLineParts, regex("^\\*\\[(r[0-7]|psw) \\- (" + literalOrSymbolPattern + ")\\]$"))) {
-            string reg = matchedLineParts.str(1), displacement = matchedLineParts.str(2);
-            char regIndex = reg != "psw" ? (reg.at(1) - '0') : 8; // r == 'rX' -> X
-
-            section.sectionData.push_back(0xF0 | regIndex); // second byte - 1 1 1 1 | _ _ _ _ [reg]
-            section.sectionData.push_back(0x03);            // third byte - 0 0 0 0 | 0 0 1 1 [regind with displacement]
-
-            /* 4th and 5th byte are the payload - the value that remains in the address field of the instruction */
-            char operation = '+';
-            if (regex_search(operand, matchedLineParts, regex("^\\*\\[(r[0-7]|psw) \\- (" + literalOrSymbolPattern + ")\\]$")))
-                operation = '-';
-
-            if (regex_match(displacement, regex("^(" + symbolPattern + ")$"))) // operand == symbol
-                tmpValue = absoluteAddressing(displacement, false, operation); // a relocation (or forward referencing) record is also created
-            else tmpValue = getDecimalFromLiteral((operation == '-' ? "-" : "") + displacement);
-
-            section.sectionData.push_back(0xFF & (tmpValue >> 8)); // fourth byte - most significant byte of the payload
-            section.sectionData.push_back(0xFF & tmpValue);        // fifth byte - least significant byte of the payload
-
-            locationCounter += 5;
-            return true;
-        }
-
-        /* memory direct addressing <-> jmp *<symbol/literal> */
-        if (regex_search(operand, matchedLineParts, regex("^\\*(" + literalOrSymbolPattern + ")$"))) {
-            section.sectionData.push_back(0xFF); // second byte - 1 1 1 1 | 1 1 1 1 [reg; irrelevant, unused]
-            section.sectionData.push_back(0x04); // third byte - 0 0 0 0 | 0 1 0 0 [memdir]
+        case operands_jump: case operands_data: {
+            /*
+                jump commands (all with one operand) and load and store commands (rD and one operand);
+                we expect <[LC <= LC + 3 | a command has no payload]> for the following:
+                    - register direct addressing <-> jmp *rX | ldr <ri>, rX
+                    - register indirect addressing <-> jmp *[rX] | ldr <ri>, [rX]
+                we expect <[LC <= LC + 5 | a command has a payload]> for the following:
+                    - absolute addressing of symbols and literals <-> jmp <symbol/literal> | ldr <ri>, $<symbol/literal>
+                    - pc relative symbol addressing <-> jmp %<symbol> | ldr <ri>, %<symbol>
+                    - register indirect addressing with displacement <-> jmp *[rX +/- <symbol/literal>] | ldr <ri>, [rX +/- <symbol/literal>]
+                    - memory direct addressing <-> jmp *<symbol/literal> | ldr <ri>, <symbol/literal>
+            */
+            bool isJump = instruction->operands == operands_jump;
+            bool isCarriageReturned = inputLine.find('\r') != string_view::npos; // (a CRLF file) the operand is not taken past a '\r'
+            if (isCarriageReturned || !lexer.space() || (!isJump && (!lexer.reg(rDIndex) || !lexer.punctuator(',')))) break;
+            if (isJump) rDIndex = 0x0F; // jumps have no rDst (1 1 1 1 [irrelevant, unused])
+
+            section.sectionData.push_back(instruction->code); // first byte
+
+            Operand operand;
+            if (!parseOperand(lexer, isJump, operand)) {
+                errorMessages.insert({currentLine, "The addressing mode is not supported. " + string(inputLine)});
+                return false;
+            }
 
-            /* 4th and 5th byte are the payload - the value that remains in the address field of the instruction */
-            string literalOrSymbol = matchedLineParts.str(1);                     // removes a '*'
-            if (regex_match(literalOrSymbol, regex("^(" + symbolPattern + ")$"))) // operand == symbol
-                tmpValue = absoluteAddressing(literalOrSymbol, false, '+');       // a relocation (or forward referencing) record is also created
-            else tmpValue = getDecimalFromLiteral(literalOrSymbol);
+            /* second byte - _ _ _ _ [rDst] | _ _ _ _ [rSrc] and third byte - 0 0 0 0 | _ _ _ _ [addressing] */
+            int payload = 0;
+            switch (operand.syntax) {
+                case operand_register:
+                    section.sectionData.push_back(operand.rIndex | (rDIndex << 4));
+                    section.sectionData.push_back(ADDRESSING_MODE::regdir);
+                    locationCounter += 3;
+                    return true;
+
+                case operand_register_indirect:
+                    section.sectionData.push_back(operand.rIndex | (rDIndex << 4));
+                    section.sectionData.push_back(ADDRESSING_MODE::regind);
+                    locationCounter += 3;
+                    return true;
+
+                case operand_immediate:
+                case operand_memory:
+                    section.sectionData.push_back(0x0F | (rDIndex << 4)); // rSrc irrelevant, unused
+                    section.sectionData.push_back(operand.syntax == operand_immediate ? ADDRESSING_MODE::immed : ADDRESSING_MODE::memdir);
+
+                    /* 4th and 5th byte are the payload - the value that remains in the address field of the instruction */
+                    if (Lexer::isSymbol(operand.value))                          // operand == symbol
+                        payload = absoluteAddressing(intern(operand.value), false, '+'); // a relocation (or forward referencing) record is also created
+                    else payload = getDecimalFromLiteral(operand.value);
+                    break;
+
+                case operand_pc_relative:
+                    // rSrc == PC; jumps take the pc with the displacement, loads/stores the word it points to
+                    section.sectionData.push_back(0x07 | (rDIndex << 4));
+                    section.sectionData.push_back(isaValidAddressingMode(*instruction, ADDRESSING_MODE::regdir_disp) ? ADDRESSING_MODE::regdir_disp : ADDRESSING_MODE::regind_disp);
+
+                    /* 4th and 5th byte are the payload - the value that remains in the address field of the instruction */
+                    payload = relativeAddressing(intern(operand.value)); // a relocation (or forward referencing) record is also created
+                    break;
+
+                case operand_displacement:
+                    section.sectionData.push_back(operand.rIndex | (rDIndex << 4));
+                    section.sectionData.push_back(ADDRESSING_MODE::regind_disp);
+
+                    /* 4th and 5th byte are the payload - the value that remains in the address field of the instruction */
+                    if (!isJump) operand.operation = '+'; // a load/store displacement is added whatever its sign
+
+                    if (Lexer::isSymbol(operand.value))                                         // operand == symbol
+                        payload = absoluteAddressing(intern(operand.value), false, operand.operation); // a relocation (or forward referencing) record is also created
+                    else payload = getDecimalFromLiteral((operand.operation == '-' ? "-" : "") + string(operand.value));
+                    break;
+            }
 
-            section.sectionData.push_back(0xFF & (tmpValue >> 8)); // fourth byte - most significant byte of the payload
-            section.sectionData.push_back(0xFF & tmpValue);        // fifth byte - least significant byte of the payload
+            section.sectionData.push_back(0xFF & (payload >> 8)); // fourth byte - most significant byte of the payload
+            section.sectionData.push_back(0xFF & payload);        // fifth byte - least significant byte of the payload
 
             locationCounter += 5;
             return true;
         }
-
-        errorMessages.insert({currentLine, "The addressing mode is not supported. " + inputLine});
-        return false;
     }
 
-    /* load and store commands */
-    if (regex_search(inputLine, matchedLineParts, regex("^(ldr|str) (r[0-7]|psw),(.*)$"))) {
-        string command = matchedLineParts.str(1), rD = matchedLineParts.str(2), operand = matchedLineParts.str(3);
-        // cout << "LDR/STR_2OP:#" << i << "#reg:" << rD << " #op:" << operand;
-
-        /*
-            we expect <[LC <= LC + 3 | a command has no payload]> for the following:
-                - register direct addressing <-> ldr <ri>, rX
-                - register indirect addressing <-> ldr <ri>, [rX]
-            we expect <[LC <= LC + 5 | a command has a payload]> for the following:
-                - absolute addressing of symbols and literals <-> jmp <symbol/literal>
-                - pc relative symbol addressing <-> ldr <ri>, %<symbol>
-                - register indirect addressing with displacement <-> ldr <ri>, [rX +/- <symbol/literal>]
-                - memory direct addressing <-> ldr <ri>, <symbol/literal>
-        */
-
-        /* let's allocate space and fill it properly */
-        char rDIndex = (rD != "psw" ? (rD.at(1) - '0') : 8);
-        SectionTableRecord &section = sectionTable[currentSection];
-
-        int tmpValue = (command == "ldr" ? 0xA0 : 0xB0);
-        section.sectionData.push_back(0xFF & tmpValue); // first byte
-
-        /* register direct addressing <-> ldr <ri>, rX */
-        if (regex_search(operand, matchedLineParts, regex("^(r[0-7]|psw)$"))) {
-            string rX = matchedLineParts.str(1);
-            char rXIndex = rX != "psw" ? (rX.at(1) - '0') : 8; // r == 'rX' -> X
-
-            section.sectionData.push_back(rXIndex | (rDIndex << 4)); // second byte - _ _ _ _ [rDst] | _ _ _ _ [rSrc]
-            section.sectionData.push_back(0x01);                     // third byte - 0 0 0 0 | 0 0 0 1 [regdir]
-
-            locationCounter += 3;
-            return true;
-        }
-
-        /* register indirect addressing <-> ldr <ri>, [rX] */
-        if (regex_search(operand, matchedLineParts, regex("^\\[(r[0-7]|psw)\\]$"))) {
-            string rX = matchedLineParts.str(1);
-            char rXIndex = rX != "psw" ? (rX.at(1) - '0') : 8; // r == 'rX' -> X
-
-            section.sectionData.push_back(rXIndex | (rDIndex << 4)); // second byte - _ _ _ _ [rDst] | _ _ _ _ [rSrc]
-            section.sectionData.push_back(0x02);                     // third byte - 0 0 0 0 | 0 0 1 0 [regind]
-
-            locationCounter += 3;
-            return true;
-        }
-
-        /* absolute addressing of symbols and literals <-> ldr <ri>, $<symbol/literal> */
-        if (regex_search(operand, matchedLineParts, regex("^\\$(" + literalOrSymbolPattern + ")$"))) {
-            section.sectionData.push_back(0x0F | (rDIndex << 4)); // second byte - _ _ _ _ [rDst] | 1 1 1 1 [rSrc; irrelevant, unused]
-            section.sectionData.push_back(0x00);                  // third byte - 0 0 0 0 | 0 0 0 0 [immed]
-
-            /* 4th and 5th byte are the payload - the value that remains in the address field of the instruction */
-            string literalOrSymbol = matchedLineParts.str(1);
-            if (regex_match(literalOrSymbol, regex("^(" + symbolPattern + ")$"))) // operand == symbol
-                tmpValue = absoluteAddressing(literalOrSymbol, false, '+');       // a relocation (or forward referencing) record is also created
-            else tmpValue = getDecimalFromLiteral(literalOrSymbol);
-
-            section.sectionData.push_back(0xFF & (tmpValue >> 8)); // fourth byte - most significant byte of the payload
-            section.sectionData.push_back(0xFF & tmpValue);        // fifth byte - least significant byte of the payload
-
-            locationCounter += 5;
-            return true;
-        }
-
-        /* pc relative symbol addressing <-> ldr <ri>, %<symbol> */
-        if (regex_search(operand, matchedLineParts, regex("^%(" + symbolPattern + ")$"))) {
-            section.sectionData.push_back(0x07 | (rDIndex << 4)); // second byte - _ _ _ _ [rDst] | 0 1 1 1 [rSrc == PC]
-            section.sectionData.push_back(0x03);                  // third byte - 0 0 0 0 | 0 0 1 1 [regind with displacement; rSrc == PC]
+    /* unsupported command */
+    errorMessages.insert({currentLine, "The assembler command is not supported. " + string(inputLine)});
+    return false;
+}
 
-            /* 4th and 5th byte are the payload - the value that remains in the address field of the instruction */
-            tmpValue = relativeAddressing(matchedLineParts.str(1)); // a relocation (or forward referencing) record is also created
-            section.sectionData.push_back(0xFF & (tmpValue >> 8)); // fourth byte - most significant byte of the payload
-            section.sectionData.push_back(0xFF & tmpValue);        // fifth byte - least significant byte of the payload
+/* parsing of the source lines */
+bool Assembler::parseList(Lexer &lexer, bool symbolsOnly, vector<string_view> &list) {
+    string_view item;
+    list.clear();
 
-            locationCounter += 5;
-            return true;
-        }
+    if (!lexer.space()) return false;
+    do {
+        if (symbolsOnly ? !lexer.symbol(item) : !lexer.literalOrSymbol(item)) return false;
+        list.push_back(item);
+    } while (lexer.punctuator(','));
 
-        /* register indirect addressing with displacement <-> ldr <ri>, [rX +/- <symbol/literal>] */
-        if (regex_search(operand, matchedLineParts, regex("^\\[(r[0-7]|psw) \\+ (" + literalOrSymbolPattern + ")\\]$"))
-            || regex_search(operand, matchedLineParts, regex("^\\[(r[0-7]|psw) \\- (" + literalOrSymbolPattern + ")\\]$"))) {
-            string rX = matchedLineParts.str(1), displacement = matchedLineParts.str(2);
-            char rXIndex = rX != "psw" ? (rX.at(1) - '0') : 8; // r == 'rX' -> X
+    return lexer.end();
+}
 
-            section.sectionData.push_back(rXIndex | (rDIndex << 4)); // second byte - _ _ _ _ [rDst] | _ _ _ _ [rSrc]
-            section.sectionData.push_back(0x03);                     // third byte - 0 0 0 0 | 0 0 1 1 [regind with displacement]
+bool Assembler::parseOperand(Lexer &lexer, bool isJump, Operand &operand) {
+    /* pc relative symbol addressing <-> jmp %<symbol> | ldr <ri>, %<symbol> */
+    if (lexer.punctuator('%')) {
+        operand.syntax = operand_pc_relative;
+        return lexer.symbol(operand.value) && lexer.end();
+    }
 
-            /* 4th and 5th byte are the payload - the value that remains in the address field of the instruction */
-            char operation = '+';
-            if (regex_search(operand, matchedLineParts, regex("^\\*\\[(r[0-7]|psw) \\- (" + literalOrSymbolPattern + ")\\]$")))
-                operation = '-';
+    /* data of jumps is marked with '*', immediate values of loads/stores with '$' */
+    bool isMarked = lexer.punctuator(isJump ? '*' : '$');
+    if (isMarked != isJump) {
+        operand.syntax = operand_immediate;
+        return lexer.literalOrSymbol(operand.value) && lexer.end();
+    }
 
-            if (regex_match(displacement, regex("^(" + symbolPattern + ")$"))) // operand == symbol
-                tmpValue = absoluteAddressing(displacement, false, operation); // a relocation (or forward referencing) record is also created
-            else tmpValue = getDecimalFromLiteral((operation == '-' ? "-" : "") + displacement);
+    /* register direct addressing <-> jmp *rX | ldr <ri>, rX */
+    unsigned start = lexer.mark();
+    if (lexer.reg(operand.rIndex) && lexer.end()) {
+        operand.syntax = operand_register;
+        return true;
+    }
+    lexer.reset(start);
 
-            section.sectionData.push_back(0xFF & (tmpValue >> 8)); // fourth byte - most significant byte of the payload
-            section.sectionData.push_back(0xFF & tmpValue);        // fifth byte - least significant byte of the payload
+    /* register indirect addressing (with displacement) <-> jmp *[rX (+/- <symbol/literal>)] | ldr <ri>, [rX (+/- <symbol/literal>)] */
+    if (lexer.punctuator('[')) {
+        if (!lexer.reg(operand.rIndex)) return false;
 
-            locationCounter += 5;
-            return true;
+        operand.syntax = operand_register_indirect;
+        if (!lexer.punctuator(']')) {
+            operand.syntax = operand_displacement;
+            if (!lexer.space()) return false;
+            if (lexer.punctuator('+')) operand.operation = '+';
+            else if (lexer.punctuator('-')) operand.operation = '-';
+            else return false;
+            if (!lexer.space() || !lexer.literalOrSymbol(operand.value) || !lexer.punctuator(']')) return false;
         }
+        return lexer.end();
+    }
 
-        /* memory direct addressing <-> ldr <ri>, <symbol/literal> */
-        if (regex_search(operand, matchedLineParts, regex("^(" + literalOrSymbolPattern + ")$"))) {
-            section.sectionData.push_back(0x0F | (rDIndex << 4)); // second byte - _ _ _ _ [rDst] | 1 1 1 1 [rSrc; irrelevant, unused]
-            section.sectionData.push_back(0x04);                  // third byte - 0 0 0 0 | 0 1 0 0 [memdir]
+    /* memory direct addressing <-> jmp *<symbol/literal> | ldr <ri>, <symbol/literal> */
+    operand.syntax = operand_memory;
+    return lexer.literalOrSymbol(operand.value) && lexer.end();
+}
 
-            /* 4th and 5th byte are the payload - the value that remains in the address field of the instruction */
-            if (regex_match(operand, regex("^(" + symbolPattern + ")$"))) // operand == symbol
-                tmpValue = absoluteAddressing(operand, false, '+');       // a relocation (or forward referencing) record is also created
-            else tmpValue = getDecimalFromLiteral(operand);
+/* utility methods */
+unsigned Assembler::intern(string_view name) {
+    unsigned id = names.intern(name);
+    if (id >= symbolOfName.size()) { // a new name is neither a symbol nor a section yet
+        symbolOfName.resize(names.size(), StringInterner::NONE);
+        sectionOfName.resize(names.size(), StringInterner::NONE);
+    }
+    return id;
+}
 
-            section.sectionData.push_back(0xFF & (tmpValue >> 8)); // fourth byte - most significant byte of the payload
-            section.sectionData.push_back(0xFF & tmpValue);        // fifth byte - least significant byte of the payload
+Assembler::SymbolTableRecord *Assembler::findSymbol(unsigned name) {
+    return symbolOfName[name] == StringInterner::NONE ? nullptr : &symbolTable[symbolOfName[name]];
+}
 
-            locationCounter += 5;
-            return true;
-        }
+Assembler::SectionTableRecord &Assembler::section(unsigned name) {
+    return sectionTable[sectionOfName[name]];
+}
 
-        errorMessages.insert({currentLine, "The addressing mode is not supported. " + inputLine});
-        return false;
-    }
+vector<unsigned> Assembler::symbolsByName() {
+    vector<unsigned> ids(symbolTable.size());
+    for (unsigned id = 0; id < ids.size(); id++) ids[id] = id;
+    sort(ids.begin(), ids.end(), [this](unsigned a, unsigned b) { return names.name(symbolTable[a].name) < names.name(symbolTable[b].name); });
+    return ids;
+}
 
-    /* unsupported command */
-    errorMessages.insert({currentLine, "The assembler command is not supported. " + inputLine});
-    return false;
+vector<unsigned> Assembler::sectionsByName() {
+    vector<unsigned> indices(sectionTable.size());
+    for (unsigned index = 0; index < indices.size(); index++) indices[index] = index;
+    sort(indices.begin(), indices.end(), [this](unsigned a, unsigned b) { return names.name(sectionTable[a].name) < names.name(sectionTable[b].name); });
+    return indices;
 }
 
-/* utility methods */
-int Assembler::getDecimalFromLiteral(string literal) {
-    smatch matchedValue;
-    int converted;
-
-    if (regex_search(literal, matchedValue, regex("^(" + hexadecimalPattern + ")$")))
-        converted = stoi(matchedValue.str(1), nullptr, 16); // hex -> decimal
-    if (regex_search(literal, matchedValue, regex("^(" + decimalPattern + ")$")))
-        converted = stoi(matchedValue.str(1)); // string -> decimal
-    return converted;
+int Assembler::getDecimalFromLiteral(string_view literal) {
+    // the view ends with the literal, so a short one ("-5") has no characters to read past its end
+    string_view negated = literal.size() > 1 && literal[0] == '-' ? literal.substr(1) : string_view();
+    if (negated.size() > 0 && (negated[0] == '-' || (negated.size() > 1 && (negated[1] == 'x' || negated[1] == 'X')))) // a negated displacement (-0x10, --5)
+        return -getDecimalFromLiteral(negated);
+
+    if (literal.size() > 2 && literal[0] == '0' && (literal[1] == 'x' || literal[1] == 'X'))
+        return stoi(string(literal), nullptr, 16); // hex -> decimal
+    return stoi(string(literal));                  // string -> decimal
 }
 
 string Assembler::decimalToHexadecimal(int value) {
@@ -896,15 +807,15 @@ string Assembler::decimalToHexadecimal(int value) {
 }
 
 /* processing of the symbol addressing */
-int Assembler::absoluteAddressing(string symbol, bool isLittleEndian, char operation) { // absolute addressing of a symbol in an assembler instruction
+int Assembler::absoluteAddressing(unsigned symbolName, bool isLittleEndian, char operation) { // absolute addressing of a symbol in an assembler instruction
     // cout << "ABS_ADDRESSING: " << symbol << endl;
 
-    auto item = symbolTable.find(symbol);
-    if (item != symbolTable.end()) { // symbol found in the symbol table
-        SymbolTableRecord &symbol = item->second;
+    SymbolTableRecord *item = findSymbol(symbolName);
+    if (item != nullptr) { // symbol found in the symbol table
+        SymbolTableRecord &symbol = *item;
 
         /* symbol is of known absolute value (defined via .equ directive) */
-        if (symbol.section == "ABS") {
+        if (symbol.section == ABS) {
             // cout << "EQU_Symbol_From_ABS:" << symbol.offset << endl;
             return symbol.offset;
         }
@@ -930,22 +841,22 @@ int Assembler::absoluteAddressing(string symbol, bool isLittleEndian, char opera
     record.isLittleEndian = isLittleEndian;                     // with commands we want the lower byte of the symbol to be placed at +4, and the older byte at +3 (big endian)
 
     record.operation = operation; // '+', '-' (absolute addressing)
-    record.symbol = symbol;
+    record.symbol = symbolName;
     record.currentLine = currentLine; // for error printing purposes after backpatching()
 
     forwardReferenceTable.push_back(record);
     return 0;
 }
 
-int Assembler::relativeAddressing(string symbol) { // relative addressing of a symbol in an assembler command
+int Assembler::relativeAddressing(unsigned symbolName) { // relative addressing of a symbol in an assembler command
     // cout << "REL_ADDRESSING: " << symbol << endl;
 
-    auto item = symbolTable.find(symbol);
-    if (item != symbolTable.end()) { // symbol found in the symbol table
-        SymbolTableRecord &symbol = item->second;
+    SymbolTableRecord *item = findSymbol(symbolName);
+    if (item != nullptr) { // symbol found in the symbol table
+        SymbolTableRecord &symbol = *item;
 
         /* symbol is of known absolute value (defined via .equ directive) */
-        if (symbol.section == "ABS") {
+        if (symbol.section == ABS) {
             // cout << "EQU_Symbol_From_ABS:" << symbol.offset << endl;
             return symbol.offset + (-2); // addend == -2
         } else if (symbol.isDefined && symbol.section == currentSection) {
@@ -982,7 +893,7 @@ int Assembler::relativeAddressing(string symbol) { // relative addressing of a s
     record.isLittleEndian = false;       // with commands we want the lower byte of the symbol to be placed at +4, and the older byte at +3 (big endian)
 
     record.operation = 'R'; // 'R' (PC relative addressing)
-    record.symbol = symbol;
+    record.symbol = symbolName;
     record.currentLine = currentLine; // for error printing purposes after backpatching()
 
     forwardReferenceTable.push_back(record);
@@ -995,13 +906,13 @@ void Assembler::printSymbolTable(ostream &stream) {
     stream << "ID\t\tOffset\tType\tSection\t\tName" << endl;
 
     stream << hex;
-    for (auto item = symbolTable.begin(); item != symbolTable.end(); item++) {
-        SymbolTableRecord &symbol = item->second;
+    for (unsigned id : symbolsByName()) {
+        SymbolTableRecord &symbol = symbolTable[id];
 
         stream << setfill('0') << setw(4) << symbol.id << "\t";
         stream << setfill('0') << setw(4) << symbol.offset << "\t";
         stream << (symbol.isLocal ? "local\t" : (symbol.isDefined ? "global\t" : (symbol.isExtern ? "extern\t" : "undef\t")));
-        stream << symbol.section << "\t\t" << symbol.name << endl;
+        stream << names.name(symbol.section) << "\t\t" << names.name(symbol.name) << endl;
     }
     stream << dec;
 }
@@ -1011,10 +922,10 @@ void Assembler::printSectionTable(ostream &stream) {
     stream << "ID\t\tName\t\tLength" << endl;
 
     stream << hex;
-    for (auto item = sectionTable.begin(); item != sectionTable.end(); item++) {
-        SectionTableRecord &section = item->second;
+    for (unsigned index : sectionsByName()) {
+        SectionTableRecord &section = sectionTable[index];
 
-        stream << setfill('0') << setw(4) << section.id << "\t" << section.name << (section.name.size() > 3 ? "\t\t" : "\t\t\t");
+        stream << setfill('0') << setw(4) << section.id << "\t" << names.name(section.name) << (names.name(section.name).size() > 3 ? "\t\t" : "\t\t\t");
         stream << setfill('0') << setw(4) << section.length << endl;
     }
     stream << dec;
@@ -1024,11 +935,11 @@ void Assembler::printSectionData(ostream &stream) {
     stream << "\n\nSection Data:" << endl;
 
     stream << hex;
-    for (auto item = sectionTable.begin(); item != sectionTable.end(); item++) {
-        SectionTableRecord &section = item->second;
+    for (unsigned index : sectionsByName()) {
+        SectionTableRecord &section = sectionTable[index];
         if (section.length == 0) continue;
 
-        stream << "\nSection: " << section.name;
+        stream << "\nSection: " << names.name(section.name);
         for (int i = 0; i < section.sectionData.size(); i++) {
             if (i % 8 == 0) stream << "\n" << setfill('0') << setw(4) << i << ":  ";
             stream << setfill('0') << setw(2) << (0xFF & section.sectionData[i]) << " ";
@@ -1044,20 +955,20 @@ void Assembler::printRelocationTable(ostream &stream) {
     stream << "Offset\tType\t\tData/Command\tSymbol\t\tSection name" << endl;
 
     stream << hex;
-    for (RelocationTableRecord r : relocationTable) {
+    for (RelocationTableRecord &r : relocationTable) {
         stream << setfill('0') << setw(4) << r.offset << "\t";
 
         bool isCommand = r.type.at(r.type.size() - 1) == 'C'; // we check if the last character is a 'C'
         stream << r.type.substr(0, r.type.size() - (isCommand ? 2 : 0)) << "\t";
-        stream << (isCommand ? "C" : "D") << "\t\t\t\t" << r.symbol << "\t\t" << r.section << endl;
+        stream << (isCommand ? "C" : "D") << "\t\t\t\t" << names.name(r.symbol) << "\t\t" << names.name(r.section) << endl;
     }
     stream << dec;
 }
 
-void Assembler::printErrorMessages() {
-    cout << "\nAssembling & backpatching errors:" << endl;
+void Assembler::printErrorMessages(ostream &out) {
+    out << "\nAssembling & backpatching errors:" << endl;
 
     for (auto item = errorMessages.begin(); item != errorMessages.end(); item++) {
-        cout << "Line: " << inputFileLineNumbers[item->first] << ":" << item->second << endl;
+        out << "Line: " << item->first << ":" << item->second << endl;
     }
 }
@@ -0,0 +1,251 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm> // std::sort()
+#include <chrono>
+#include <thread>
+#include <cstdlib>   // strtol()
+#include <dirent.h>   // listing of a directory with images
+#include <sys/stat.h>
+
+#include "../inc/batch.h"
+
+/* names of the registers in a manifest (R_INDEX order) */
+static const char *registerNames[NO_REGISTERS] = {"r0", "r1", "r2", "r3", "r4", "r5", "r6", "r7", "psw"};
+
+/* JSON string literal */
+static string jsonString(string value) {
+    ostringstream out;
+    out << '"';
+    for (char c : value) {
+        if (c == '"' || c == '\\') out << '\\' << c;
+        else if ((unsigned char)c < 0x20) out << "\\u" << hex << setfill('0') << setw(4) << (int)c << dec;
+        else out << c;
+    }
+    out << '"';
+    return out.str();
+}
+
+/* constructor */
+BatchRunner::BatchRunner(string path, unsigned threads, function<void(Emulator &)> configureEmulator) : inputPath(path),
+    nOfThreads(threads == 0 ? 1 : threads), queues(threads == 0 ? 1 : threads), configure(configureEmulator), wallMilliseconds(0) {}
+
+/* run() and methods called by it */
+bool BatchRunner::run() {
+    /* listing of the images */
+    struct stat info;
+    if (stat(inputPath.c_str(), &info) != 0) {
+        batchErrors.push_back(inputPath + " opening failed.");
+        return false;
+    }
+    if (!(S_ISDIR(info.st_mode) ? readDirectory() : readManifest())) return false;
+
+    /* images are dealt to the workers in turn, the ones that finish early steal from the others */
+    for (unsigned i = 0; i < images.size(); i++)
+        queues[i % nOfThreads].images.push_back(i);
+
+    auto startTime = chrono::steady_clock::now();
+
+    vector<thread> workers;
+    for (unsigned i = 1; i < nOfThreads; i++)
+        workers.emplace_back(&BatchRunner::worker, this, i);
+    worker(0); // the calling thread is a worker too
+    for (thread &t : workers)
+        t.join();
+
+    wallMilliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - startTime).count();
+    return true;
+}
+
+bool BatchRunner::readManifest() {
+    ifstream file; // input text manifest file
+    string line;
+
+    /* file opening */
+    file.open(inputPath);
+    if (!file.is_open()) {
+        batchErrors.push_back(inputPath + " opening failed.");
+        return false;
+    }
+
+    // relative image paths are relative to the manifest
+    size_t slash = inputPath.find_last_of('/');
+    string directory = slash == string::npos ? "" : inputPath.substr(0, slash + 1);
+
+    for (unsigned lineNumber = 1; getline(file, line); lineNumber++) {
+        if (line.find('#') != string::npos) line = line.substr(0, line.find('#')); // comments
+
+        istringstream items(line);
+        string item;
+        if (!(items >> item)) continue; // an empty line
+
+        BatchImage image = {};
+        image.path = item[0] == '/' ? item : directory + item;
+        while (items >> item)
+            if (!parseExpectedValues(item, image)) {
+                batchErrors.push_back(inputPath + ":" + to_string(lineNumber) + ": wrong expected value '" + item + "'.");
+                return false;
+            }
+        images.push_back(image);
+    }
+
+    /* file closing */
+    file.close();
+    return true;
+}
+
+bool BatchRunner::readDirectory() {
+    DIR *directory = opendir(inputPath.c_str());
+    if (directory == nullptr) {
+        batchErrors.push_back(inputPath + " opening failed.");
+        return false;
+    }
+
+    // executable images are '<name>.hex' (the linker also writes their textual form to '<name>_text.hex')
+    vector<string> names;
+    for (struct dirent *entry = readdir(directory); entry != nullptr; entry = readdir(directory)) {
+        string name = entry->d_name;
+        if (name.size() <= 4 || name.substr(name.size() - 4) != ".hex" || name == MEMORY_DUMP_FILE) continue;
+        if (name.size() >= 9 && name.substr(name.size() - 9) == "_text.hex") continue;
+        names.push_back(name);
+    }
+    closedir(directory);
+    sort(names.begin(), names.end());
+
+    for (string name : names) {
+        BatchImage image = {};
+        image.path = inputPath + "/" + name;
+
+        /* expected final state in '<name>.expected' */
+        string expectedPath = inputPath + "/" + name.substr(0, name.size() - 4) + ".expected";
+        ifstream file(expectedPath);
+        string item;
+        while (file >> item)
+            if (!parseExpectedValues(item, image)) {
+                batchErrors.push_back(expectedPath + ": wrong expected value '" + item + "'.");
+                return false;
+            }
+        images.push_back(image);
+    }
+    return true;
+}
+
+bool BatchRunner::parseExpectedValues(string item, BatchImage &image) {
+    size_t equals = item.find('=');
+    if (equals == string::npos) return false;
+
+    string name = item.substr(0, equals), value = item.substr(equals + 1);
+    if (name == "sp") name = "r6";
+    if (name == "pc") name = "r7";
+
+    char *end;
+    long number = strtol(value.c_str(), &end, 0); // decimal, 0x... or 0...
+    if (value.empty() || *end != '\0' || number < -0x8000 || number > 0xFFFF) return false;
+
+    for (int i = 0; i < NO_REGISTERS; i++)
+        if (name == registerNames[i]) {
+            image.expectedRegisters.push_back({i, (short)number});
+            return true;
+        }
+    return false;
+}
+
+void BatchRunner::worker(unsigned index) {
+    unsigned image;
+    while (takeImage(index, image))
+        emulateImage(images[image]);
+}
+
+bool BatchRunner::takeImage(unsigned index, unsigned &image) {
+    /* own queue first */
+    {
+        lock_guard<mutex> guard(queues[index].lock);
+        if (!queues[index].images.empty()) {
+            image = queues[index].images.front();
+            queues[index].images.pop_front();
+            return true;
+        }
+    }
+
+    /* stealing from the other end of the other queues */
+    for (unsigned i = 1; i < nOfThreads; i++) {
+        WorkQueue &victim = queues[(index + i) % nOfThreads];
+        lock_guard<mutex> guard(victim.lock);
+        if (!victim.images.empty()) {
+            image = victim.images.back();
+            victim.images.pop_back();
+            return true;
+        }
+    }
+    return false; // images are not added during the run, so all of them are taken
+}
+
+void BatchRunner::emulateImage(BatchImage &image) {
+    auto startTime = chrono::steady_clock::now();
+
+    Emulator emulator(image.path);
+    configure(emulator);
+    emulator.setOutputStream(nullptr); // there is no console and no keyboard in the batch mode
+    emulator.setTerminalInput(-1);
+
+    bool emulated = emulator.emulate();
+    image.instructionsRetired = emulator.getInstructionsRetired();
+
+    if (!emulated) {
+        image.status = "error";
+        image.messages = emulator.getErrorMessages();
+    } else if (!emulator.isHalted()) {
+        image.status = "timeout";
+    } else {
+        /* comparison with the expected final state */
+        image.status = "pass";
+        for (auto expected : image.expectedRegisters) {
+            short actual = emulator.getRegister(expected.first);
+            if (actual == expected.second) continue;
+
+            ostringstream message;
+            message << registerNames[expected.first] << ": expected 0x" << hex << setfill('0') << setw(4) << (0xFFFF & expected.second);
+            message << ", actual 0x" << setw(4) << (0xFFFF & actual);
+            image.messages.push_back(message.str());
+            image.status = "fail";
+        }
+    }
+
+    image.wallMilliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - startTime).count();
+}
+
+bool BatchRunner::allPassed() {
+    for (BatchImage &image : images)
+        if (image.status != "pass") return false;
+    return true;
+}
+
+/* printing methods */
+void BatchRunner::printSummary(ostream &out) {
+    unsigned passed = 0;
+
+    out << "{" << endl;
+    out << "  \"images\": [" << endl;
+    for (unsigned i = 0; i < images.size(); i++) {
+        BatchImage &image = images[i];
+        if (image.status == "pass") passed++;
+
+        out << "    {\"image\": " << jsonString(image.path) << ", \"status\": \"" << image.status << "\"";
+        out << ", \"instructions\": " << image.instructionsRetired;
+        out << ", \"wall_ms\": " << fixed << setprecision(3) << image.wallMilliseconds << ", \"messages\": [";
+        for (unsigned j = 0; j < image.messages.size(); j++)
+            out << (j == 0 ? "" : ", ") << jsonString(image.messages[j]);
+        out << "]}" << (i + 1 == images.size() ? "" : ",") << endl;
+    }
+    out << "  ]," << endl;
+    out << "  \"passed\": " << passed << ", \"failed\": " << images.size() - passed;
+    out << ", \"threads\": " << nOfThreads << ", \"wall_ms\": " << fixed << setprecision(3) << wallMilliseconds << endl;
+    out << "}" << endl;
+}
+
+void BatchRunner::printErrorMessages() {
+    cout << "\n\nBatch errors:" << endl;
+    for (string e : batchErrors)
+        cout << e << endl;
+}
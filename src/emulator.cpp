@@ -3,49 +3,462 @@
 #include <iomanip>
 #include <utility> // we use only std::swap() from here
 #include <bitset>  // for psw register printout
+#include <algorithm> // std::fill()
+#include <chrono>    // for MIPS statistics
+#include <sstream>
+#include <sys/mman.h> // JIT code buffer release
+#include <poll.h>     // keyboard polling
+#include <unistd.h>
+#include <thread>     // number of batch workers
+#include <cstdlib>    // strtoull()
+#include <cstring>    // memcpy() of the image segments
+#include <fcntl.h>    // the image is mapped
+#include <sys/stat.h>
 
 #include "../inc/emulator.h"
+#include "../inc/batch.h"
+#include "../inc/lockstep.h"
+#include "../inc/aot.h"
+#include "../inc/image.h"
 
 /* main program */
+#ifndef EMULATOR_LIBRARY // the static library (see compile.sh) leaves main() to the embedding program
 int main(int argc, const char *argv[]) {
-    // expected format: './emulator <input_file>'
-    if (argc < 2) {
+    // expected format: './emulator [options] <input_file>' or './emulator [options] --batch=<manifest_or_directory>'
+    // or './emulator [options] --lockstep=<inputs_file> <input_file>'
+    // (an executable built by the translator runs its own image when no input file is given, see src/aot.cpp)
+    string inputFilePath = "", batchPath = "", lockstepInputsPath = "";
+    bool decodeCache = true, statistics = false, lazyFlags = true, fusion = true, idleLoopSkip = true, aotCheck = false, profile = false;
+    bool semihosting = false;
+    string profileJsonPath = "", callGraphPath = "", symbolMapPath = "", dumpFilePath = MEMORY_DUMP_FILE;
+    string tracePath = "", decodeTracePath = "";
+    unsigned traceRecords = TRACE_DEFAULT_RECORDS;
+    DUMP_FORMAT dumpFormat = DUMP_FORMAT::hex_dump;
+    ENGINE engine = AotRuntime::program != nullptr ? ENGINE::aot_engine : ENGINE::switch_engine;
+    unsigned long long instructionLimit = ~0ULL;
+    unsigned jobs = thread::hardware_concurrency();
+    unsigned lanes = 16;
+    int snapshotAddress = -1;
+    unsigned restoreRuns = 0;
+
+    /* reading command line arguments */
+    for (int i = 1; i < argc; i++) {
+        string currentArgument = argv[i];
+
+        if (currentArgument == "--no-decode-cache") decodeCache = false;
+        else if (currentArgument == "--stats") statistics = true;
+        else if (currentArgument == "--eager-flags") lazyFlags = false;
+        else if (currentArgument == "--no-fusion") fusion = false;
+        else if (currentArgument == "--no-idle-skip") idleLoopSkip = false;
+        else if (currentArgument == "--profile") profile = true;
+        else if (currentArgument == "--semihosting") semihosting = true;
+        else if (currentArgument.rfind("--profile-json=", 0) == 0) profileJsonPath = currentArgument.substr(15);
+        else if (currentArgument.rfind("--call-graph=", 0) == 0) callGraphPath = currentArgument.substr(13);
+        else if (currentArgument.rfind("--symbols=", 0) == 0) symbolMapPath = currentArgument.substr(10);
+        else if (currentArgument == "--dump=none") dumpFormat = DUMP_FORMAT::no_dump;
+        else if (currentArgument == "--dump=hex") dumpFormat = DUMP_FORMAT::hex_dump;
+        else if (currentArgument == "--dump=bin") dumpFormat = DUMP_FORMAT::bin_dump;
+        else if (currentArgument == "--dump=sparse") dumpFormat = DUMP_FORMAT::sparse_dump;
+        else if (currentArgument == "--dump=diff") dumpFormat = DUMP_FORMAT::diff_dump;
+        else if (currentArgument.rfind("--dump-file=", 0) == 0) dumpFilePath = currentArgument.substr(12);
+        else if (currentArgument.rfind("--trace=", 0) == 0) tracePath = currentArgument.substr(8);
+        else if (currentArgument.rfind("--trace-records=", 0) == 0) traceRecords = strtoul(currentArgument.c_str() + 16, nullptr, 10);
+        else if (currentArgument.rfind("--decode-trace=", 0) == 0) decodeTracePath = currentArgument.substr(15);
+        else if (currentArgument == "--engine=switch") engine = ENGINE::switch_engine;
+        else if (currentArgument == "--engine=threaded") engine = ENGINE::threaded_engine;
+        else if (currentArgument == "--engine=jit") engine = ENGINE::jit_engine;
+        else if (currentArgument == "--engine=aot") engine = ENGINE::aot_engine;
+        else if (currentArgument == "--aot-check") aotCheck = true;
+        else if (currentArgument.rfind("--batch=", 0) == 0) batchPath = currentArgument.substr(8);
+        else if (currentArgument.rfind("--jobs=", 0) == 0) jobs = strtoul(currentArgument.c_str() + 7, nullptr, 10);
+        else if (currentArgument.rfind("--lockstep=", 0) == 0) lockstepInputsPath = currentArgument.substr(11);
+        else if (currentArgument.rfind("--lanes=", 0) == 0) lanes = strtoul(currentArgument.c_str() + 8, nullptr, 10);
+        else if (currentArgument.rfind("--snapshot-at=", 0) == 0) snapshotAddress = 0xFFFF & strtoul(currentArgument.c_str() + 14, nullptr, 0);
+        else if (currentArgument.rfind("--restore-loop=", 0) == 0) restoreRuns = strtoul(currentArgument.c_str() + 15, nullptr, 10);
+        else if (currentArgument.rfind("--max-instructions=", 0) == 0) instructionLimit = strtoull(currentArgument.c_str() + 19, nullptr, 10);
+        else if (currentArgument.rfind("--", 0) == 0) {
+            cout << "Unknown option " << currentArgument << "." << endl;
+            return -1;
+        } else inputFilePath = currentArgument;
+    }
+    if (engine == ENGINE::threaded_engine && !decodeCache) {
+        cout << "The threaded engine executes from the decode cache, --no-decode-cache needs another engine." << endl;
+        return -1;
+    }
+
+    // the same options for a single emulation and for every emulation of a batch
+    auto configure = [&](Emulator &emulator) {
+        emulator.setDecodeCacheEnabled(decodeCache);
+        emulator.setEngine(engine);
+        emulator.setLazyFlagsEnabled(lazyFlags);
+        emulator.setCommandFusionEnabled(fusion);
+        emulator.setIdleLoopSkipEnabled(idleLoopSkip);
+        emulator.setStatisticsEnabled(statistics);
+        emulator.setProfilingEnabled(profile || profileJsonPath != "");
+        emulator.setCallGraphEnabled(callGraphPath != "");
+        emulator.setInstructionLimit(instructionLimit);
+        emulator.setSnapshotHarness(snapshotAddress, restoreRuns);
+        emulator.setSemihostingEnabled(semihosting);
+    };
+
+    /* batch mode */
+    if (batchPath != "") {
+        BatchRunner batch(batchPath, jobs, configure);
+        if (!batch.run()) {
+            batch.printErrorMessages();
+            return -1;
+        }
+        batch.printSummary(cout);
+        return batch.allPassed() ? 0 : -1;
+    }
+
+    /* a trace file of an earlier emulation as text */
+    if (decodeTracePath != "") return Emulator::decodeTrace(decodeTracePath, cout) ? 0 : -1;
+
+    /* translated program against the interpreter */
+    if (aotCheck) return AotRuntime::check(configure, cout) ? 0 : -1;
+
+    if (inputFilePath == "" && AotRuntime::program == nullptr) {
         cout << "Input file is not specified." << endl;
         return -1;
     }
 
+    /* lockstep mode */
+    if (lockstepInputsPath != "") {
+        LockstepRunner lockstep(inputFilePath, lockstepInputsPath, lanes, configure);
+        if (!lockstep.run()) {
+            lockstep.printErrorMessages();
+            return -1;
+        }
+        lockstep.printResults(cout);
+        return lockstep.allHalted() ? 0 : -1;
+    }
+
     /* emulator object creation and emulation */
-    string inputFilePath = argv[1];
     Emulator emulator(inputFilePath);
+    configure(emulator);
+    emulator.setDumpFormat(dumpFormat);
+    if (tracePath != "") emulator.setTraceRecords(traceRecords);
+    if (symbolMapPath != "" && !emulator.loadSymbolMap(symbolMapPath)) {
+        emulator.printErrorMessages();
+        return -1;
+    }
 
-    if (!emulator.emulate()) {
+    // the trace is written after a halt, an error or the instruction limit, with the commands that led there
+    bool emulated = emulator.emulate();
+    if (tracePath != "" && !emulator.writeTrace(tracePath)) emulated = false;
+    if (!emulated) {
         emulator.printErrorMessages();
         return -1;
     }
 
-    emulator.memoryDump(); //memory state after the program execution
+    emulator.memoryDump(dumpFilePath); //memory state after the program execution
+    if (profile) emulator.printProfile(cout);
+    if (profileJsonPath != "" && !emulator.writeProfileJson(profileJsonPath)) {
+        emulator.printErrorMessages();
+        return -1;
+    }
+    if (callGraphPath != "" && !emulator.writeCallGraph(callGraphPath)) {
+        emulator.printErrorMessages();
+        return -1;
+    }
     return 0;
 }
+#endif
 
 /* constructor */
-Emulator::Emulator(string inputPath) : inputFilePath(inputPath), memory(MEMORY_SIZE), registers(NO_REGISTERS) {}
+Emulator::Emulator(string inputPath) : inputFilePath(inputPath), inputImage(nullptr), inputImageSize(0), memory(MEMORY_SIZE + 1), registers(NO_REGISTERS),
+    decodeCacheEnabled(true), decodeCache(MEMORY_SIZE), decodeCacheValid(MEMORY_SIZE), decodeCacheHits(0), decodeCacheInvalidations(0),
+    commandFusionEnabled(true), fusionHits(),
+    lazyFlagsEnabled(true), lazyFlags(),
+    nextEventCycle(~0ULL), timerEventCycle(0), interruptRequests(0), timerInterrupts(0), terminalInterrupts(0),
+    idleLoopSkipEnabled(true), idleLoop(), memoryWrites(0), hostEffects(0), skippedCycles(0), terminalInputFd(STDIN_FILENO), terminalInputClosed(false), terminalSettingsSaved(false),
+    snapshot(), dirtyPages(), snapshotAddress(-1), restoreRuns(0), snapshotRestores(0), restoredPages(0), restoreLoopSeconds(0),
+    engine(ENGINE::switch_engine), statisticsEnabled(false), loadSeconds(0), instructionsRetired(0), instructionLimit(~0ULL), instructionBudget(~0ULL), stopRequested(false), programHalted(false), output(&cout), dumpFormat(DUMP_FORMAT::hex_dump),
+    profilingEnabled(false), profileMnemonics(), profileAddressingModes(), profilePageReads(), profilePageWrites(),
+    traceEnabled(false), traceNext(0), tracePending(false), traceRecords(0),
+    callGraphEnabled(false), callStackOverflow(0), callGraphCharged(0),
+    semihostingEnabled(false), semihostingClockStart(0), busDevicesMapped(false), registersDevice(this),
+    jitCode(nullptr), jitCodeUsed(0), jitCodeWritable(false), jitEnter(nullptr), jitExit(nullptr), jitFlushed(false), jitTranslations(0), jitFlushes(0),
+    aotCodeModified(false), aotBlockEntries(0), aotInterpretedCommands(0) {
+    /* the address space is RAM, except for the page of the device registers */
+    for (unsigned page = 0; page < NO_MEMORY_PAGES; page++)
+        bus[page] = {&memory[page * MEMORY_PAGE_SIZE], nullptr};
+    bus[MMAP_REGISTERS_START_ADDRESS / MEMORY_PAGE_SIZE] = {nullptr, &registersDevice};
+}
+
+Emulator::Emulator(const unsigned char *image, size_t imageSize) : Emulator("") {
+    inputImage = image;
+    inputImageSize = imageSize;
+}
+
+/* destructor */
+Emulator::~Emulator() {
+    if (jitCode != nullptr) munmap(jitCode, JIT_CODE_BUFFER_SIZE);
+    if (terminalSettingsSaved) tcsetattr(terminalInputFd, TCSANOW, &savedTerminalSettings);
+}
+
+void Emulator::setDecodeCacheEnabled(bool enabled) {
+    /* commands cached earlier could be stale after the cache was turned off for a while */
+    if (!enabled) fill(decodeCacheValid.begin(), decodeCacheValid.end(), 0);
+    decodeCacheEnabled = enabled;
+}
+
+void Emulator::setLazyFlagsEnabled(bool enabled) {
+    materializePswFlags();
+    lazyFlagsEnabled = enabled;
+}
+
+void Emulator::setCommandFusionEnabled(bool enabled) {
+    /* superinstructions formed earlier are split back into separate commands */
+    if (!enabled)
+        for (unsigned i = 0; i < decodeCache.size(); i++) {
+            decodeCache[i].fusion = FUSION::no_fusion;
+            decodeCache[i].fusionChecked = false;
+        }
+    commandFusionEnabled = enabled;
+}
+
+void Emulator::setIdleLoopSkipEnabled(bool enabled) {
+    idleLoopSkipEnabled = enabled;
+}
+
+void Emulator::setEngine(ENGINE e) {
+    engine = e;
+}
+
+void Emulator::setProfilingEnabled(bool enabled) {
+    profilingEnabled = enabled;
+    if (enabled && profilePcs.empty()) {
+        profilePcs.assign(MEMORY_SIZE, 0);
+        profileFoldedPcs.assign(MEMORY_SIZE, 0);
+    }
+}
+
+void Emulator::setDumpFormat(DUMP_FORMAT format) {
+    dumpFormat = format;
+}
+
+void Emulator::setTraceRecords(unsigned records) {
+    traceEnabled = records > 0;
+    traceBuffer.assign(records, {});
+    traceNext = 0;
+    tracePending = false;
+    traceRecords = 0;
+}
+
+void Emulator::setCallGraphEnabled(bool enabled) {
+    callGraphEnabled = enabled;
+}
+
+void Emulator::setStatisticsEnabled(bool enabled) {
+    statisticsEnabled = enabled;
+}
+
+void Emulator::setInstructionLimit(unsigned long long limit) {
+    instructionLimit = limit;
+}
+
+void Emulator::setOutputStream(ostream *stream) {
+    output = stream;
+}
+
+void Emulator::setTerminalInput(int fd) {
+    terminalInputFd = fd;
+}
+
+void Emulator::setSnapshotHarness(int address, unsigned runs) {
+    snapshotAddress = address;
+    restoreRuns = runs;
+}
+
+void Emulator::setDeviceCallback(DeviceCallback callback) {
+    deviceCallback = callback;
+}
+
+void Emulator::setInterruptCallback(InterruptCallback callback) {
+    interruptCallback = callback;
+}
+
+void Emulator::setSemihostingEnabled(bool enabled) {
+    semihostingEnabled = enabled;
+}
+
+void Emulator::mapDevice(unsigned page, BusDevice *device) {
+    page %= NO_MEMORY_PAGES;
+    bus[page] = {device == nullptr ? &memory[page * MEMORY_PAGE_SIZE] : nullptr, device};
+
+    busDevicesMapped = false;
+    for (unsigned i = 0; i < NO_MEMORY_PAGES; i++)
+        if (bus[i].device != nullptr && bus[i].device != &registersDevice) busDevicesMapped = true;
+}
+
+bool Emulator::isHalted() {
+    return programHalted;
+}
+
+short Emulator::getRegister(unsigned index) {
+    if (index >= NO_REGISTERS) {
+        reportError(ERROR_KIND::state_error, "There is no register " + to_string(index) + ".");
+        return 0;
+    }
+    if (index == R_INDEX::psw) materializePswFlags();
+    return registers[index];
+}
+
+short Emulator::readMemoryWord(unsigned address) {
+    return (memory[0xFFFF & (address + 1)] << 8) | (0xFF & memory[0xFFFF & address]);
+}
+
+unsigned char Emulator::readMemoryByte(unsigned address) {
+    return memory[0xFFFF & address];
+}
+
+unsigned long long Emulator::getInstructionsRetired() {
+    return instructionsRetired;
+}
+
+const vector<EmulatorError> &Emulator::getErrors() {
+    return emulatingErrors;
+}
+
+vector<string> Emulator::getErrorMessages() {
+    vector<string> messages;
+    for (const EmulatorError &error : emulatingErrors)
+        messages.push_back(error.message);
+    return messages;
+}
 
 /* emulate() and methods called by it */
 bool Emulator::emulate() {
+    if (!prepare()) return false;
+
+    auto startTime = chrono::steady_clock::now();
+
+    /* snapshot harness - the first run continues from the snapshot, the others start again from it */
+    if (restoreRuns > 0) {
+        if (snapshotAddress >= 0 && !executeToAddress(snapshotAddress)) return false;
+        takeSnapshot();
+    }
+
+    if (!execute()) return false;
+
+    auto restoreLoopStartTime = chrono::steady_clock::now();
+    for (unsigned i = 0; i < restoreRuns; i++)
+        if (!restoreSnapshot() || !execute()) return false;
+    restoreLoopSeconds = chrono::duration<double>(chrono::steady_clock::now() - restoreLoopStartTime).count();
+
+    // statistics are those of the first run (the restored runs repeat it)
+    printFinalState(chrono::duration<double>(restoreLoopStartTime - startTime).count());
+    return true;
+}
+
+/* embedding */
+bool Emulator::load() {
+    return prepare();
+}
+
+RUN_RESULT Emulator::run(unsigned long long maxInstructions) {
+    RUN_RESULT result = startRun(maxInstructions);
+    if (result != RUN_RESULT::run_limit || maxInstructions == 0) return result;
+
+    if (!execute()) return RUN_RESULT::run_error;
+    return programHalted ? RUN_RESULT::run_halted : RUN_RESULT::run_limit;
+}
+
+RUN_RESULT Emulator::runUntil(unsigned address, unsigned long long maxInstructions) {
+    RUN_RESULT result = startRun(maxInstructions);
+    if (result != RUN_RESULT::run_limit) return result;
+    if ((0xFFFF & registers[R_INDEX::pc]) == (0xFFFF & address)) return RUN_RESULT::run_address;
+    if (maxInstructions == 0) return result;
+
+    if (!executeCommands(0xFFFF & address)) return RUN_RESULT::run_error;
+    if (programHalted) return RUN_RESULT::run_halted;
+    return stopRequested ? RUN_RESULT::run_limit : RUN_RESULT::run_address;
+}
+
+RUN_RESULT Emulator::step() {
+    RUN_RESULT result = startRun(1);
+    if (result != RUN_RESULT::run_limit) return result;
+
+    if (!executeCommands(-1)) return RUN_RESULT::run_error;
+    return programHalted ? RUN_RESULT::run_halted : RUN_RESULT::run_limit;
+}
+
+RUN_RESULT Emulator::startRun(unsigned long long maxInstructions) {
+    if (!emulatingErrors.empty()) return RUN_RESULT::run_error; // the state after an error is not defined
+    if (programHalted) return RUN_RESULT::run_halted;           // pc points past halt
+
+    // an earlier budget that has not been reached stays in the event queue, handleEvents() ignores it
+    if (maxInstructions != ~0ULL && instructionsRetired + maxInstructions > instructionsRetired) {
+        instructionBudget = instructionsRetired + maxInstructions;
+        scheduleDeviceEvent(DEVICE::instruction_budget, instructionBudget);
+    } else instructionBudget = ~0ULL;
+    return RUN_RESULT::run_limit;
+}
+
+bool Emulator::prepare() {
     /* extracting data from the input file */
+    auto loadStartTime = chrono::steady_clock::now();
     if (!fillMemoryFromInputFile()) return false;
+    loadSeconds = chrono::duration<double>(chrono::steady_clock::now() - loadStartTime).count();
+    if (dumpFormat == DUMP_FORMAT::diff_dump) loadedMemory = memory;
+    semihostingClockStart = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now().time_since_epoch()).count();
 
     /* registers initialization */
     registers[R_INDEX::pc] = readFromMemory(IVT_ENTRY_PROGRAM_START, WORD); // pc <= IVT[0] - program starting point address
     registers[R_INDEX::sp] = MMAP_REGISTERS_START_ADDRESS;                  // sp points to the last occupied location (initially 0xFF00), and increases downwards
     registers[R_INDEX::psw] = 0x6000;                                       // initial value: [0i 1tl 1tr ... 0n 0c 0o 0z]
 
-    bool running = true; // program execution status
+    /* the call graph starts with the routine of the program start */
+    if (callGraphEnabled) {
+        callGraphFrames = {{0, 0xFFFFu & registers[R_INDEX::pc], -1, 0}};
+        callGraphChildren.clear();
+        callStack = {0};
+        callStackOverflow = 0;
+        callGraphCharged = instructionsRetired;
+    }
+
+    startDevices();
+    return true;
+}
+
+bool Emulator::execute() {
+    stopRequested = false;
+
+    // translated code does not count, follow, trace nor call back its commands, so a profiled program runs on the switch engine instead
+    ENGINE core = engine;
+    bool callbacks = deviceCallback != nullptr || interruptCallback != nullptr || busDevicesMapped;
+    if ((engine == ENGINE::jit_engine || engine == ENGINE::aot_engine) && (profilingEnabled || callGraphEnabled || traceEnabled || callbacks))
+        core = ENGINE::switch_engine;
+
+    // the threaded engine (a fallback of the JIT and AOT engines too) turns the decode cache on for its run only
+    bool decodeCache = decodeCacheEnabled;
+    bool executed = true;
+    if (core == ENGINE::threaded_engine) executed = threadedExecute();
+    if (core == ENGINE::jit_engine) executed = jitExecute();
+    if (core == ENGINE::aot_engine) executed = aotExecute();
+    if (!decodeCache && decodeCacheEnabled) setDecodeCacheEnabled(false);
+    if (!executed) return false;
+
+    bool running = core == ENGINE::switch_engine; // program execution status
+
+    // the counters of the profiler stay in a register (the members are reloaded after every store into memory)
+    unsigned long long *pcCounts = profilingEnabled ? &profilePcs[0] : nullptr;
+
     while (running) {
         cd = {}; // every iteration resets values of the 'command data' structure
 
         /* stages of the execution of an assembler command */
-        if (!commandFetchAndDecode() || !commandExecute(running)) return false;
+        if (!commandFetchAndDecode()) return false;
+        instructionsRetired++; // counted before the execution, like in the threaded engine (device registers see the same cycle)
+        if (pcCounts != nullptr) pcCounts[0xFFFF & (registers[R_INDEX::pc] - cd.length)]++;
+        if (traceEnabled) traceCommand();
+        if (!commandExecute(running)) return false;
+        if (instructionsRetired >= nextEventCycle) {
+            handleEvents();
+            if (stopRequested) break;
+        }
 
         /*
         cout << hex;
@@ -62,63 +475,174 @@ bool Emulator::emulate() {
         */
     }
 
-    /* printout of the final status according to the project (after HALT) */
-    if (cd.mnemonic == MNEMONIC::halt) {
-        cout << "Emulated processor executed halt instruction" << endl;
+    // the switch engine also handles the events of the cycle of halt, so a limit reached by halt does not hide it
+    programHalted = core == ENGINE::switch_engine ? !running : !stopRequested;
+    materializePswFlags();
+    if (callGraphEnabled) callGraphCharge();
+    if (tracePending) traceFinish();
+    return true;
+}
+
+bool Emulator::executeCommands(int address) {
+    stopRequested = false;
+
+    // superinstructions are not formed, so the switch engine stops at every command boundary
+    bool fusion = commandFusionEnabled;
+    commandFusionEnabled = false;
+
+    bool running = true, failed = false;
+    while (running && (int)(0xFFFF & registers[R_INDEX::pc]) != address) {
+        cd = {};
+
+        if (!commandFetchAndDecode()) failed = true;
+        else {
+            instructionsRetired++;
+            if (profilingEnabled) profileCommand();
+            if (traceEnabled) traceCommand();
+            if (!commandExecute(running)) failed = true;
+        }
+        if (failed) break;
+        if (instructionsRetired >= nextEventCycle) {
+            handleEvents();
+            if (stopRequested) break;
+        }
     }
-    cout << "Emulated processor state: psw=0b";
-    bitset<16> x(registers[R_INDEX::psw]);
-    cout << x << endl;
-    cout << hex;
-    for (unsigned i = 0; i < 8; i++) {
-        cout << "r" << i << "=0x" << setfill('0') << setw(4) << registers[i];
-        if (i == 3) cout << endl;
-        else cout << "\t";
+
+    // also after an error: a restored snapshot must not run the threaded engine over entries cached without handlers
+    commandFusionEnabled = fusion;
+    if (engine == ENGINE::threaded_engine) { // cached without threaded handlers
+        if (profilingEnabled) profileFoldAll(); // the counted commands leave the cache
+        fill(decodeCacheValid.begin(), decodeCacheValid.end(), 0);
     }
-    cout << dec << endl;
+    if (failed) return false;
 
+    programHalted = !running;
+    materializePswFlags();
+    if (callGraphEnabled) callGraphCharge();
+    if (tracePending) traceFinish();
     return true;
 }
 
-bool Emulator::fillMemoryFromInputFile() {
-    ifstream file; // input binary file
-    unsigned tmp, nOfIterations;
-
-    /* reading a binary input file */
-    // cout << "*** Reading input file ***" << endl;
+bool Emulator::executeToAddress(unsigned address) {
+    if (!executeCommands(address)) return false;
 
-    /* file opening */
-    file.open(inputFilePath, ios::binary);
-    if (file.fail() || !file.is_open()) {
-        emulatingErrors.push_back(inputFilePath + " opening failed.");
+    if ((0xFFFF & registers[R_INDEX::pc]) != address) {
+        ostringstream message;
+        message << "The emulation ended before pc reached 0x" << hex << setfill('0') << setw(4) << address << ".";
+        reportError(ERROR_KIND::state_error, message.str());
         return false;
     }
+    return true;
+}
 
-    /* reading the contents of sections (program segments) */
-    file.read((char *)(&nOfIterations), sizeof(nOfIterations)); // the number of "rows" (sections) in the section table
+void Emulator::printFinalState(double elapsedSeconds) {
+    if (output == nullptr) return;
 
-    for (unsigned i = 0; i < nOfIterations; i++) { // reading section by section
-        ProgramSegmentData ps;
+    /* printout of the final status according to the project (after HALT) */
+    ostream &out = *output;
+    if (programHalted) {
+        out << "Emulated processor executed halt instruction" << endl;
+    }
+    out << "Emulated processor state: psw=0b";
+    bitset<16> x(registers[R_INDEX::psw]);
+    out << x << endl;
+    out << hex;
+    for (unsigned i = 0; i < 8; i++) {
+        out << "r" << i << "=0x" << setfill('0') << setw(4) << registers[i];
+        if (i == 3) out << endl;
+        else out << "\t";
+    }
+    out << dec << endl;
+
+    if (statisticsEnabled) {
+        // skipped cycles are a part of the virtual time, but they were not executed
+        unsigned long long executed = instructionsRetired - skippedCycles;
+        const char *engineNames[] = {"switch", "threaded", "jit", "aot"};
+        out << "Emulation statistics: engine=" << engineNames[engine];
+        out << ", instructions=" << instructionsRetired << ", time=" << elapsedSeconds * 1000 << "ms";
+        out << ", MIPS=" << (elapsedSeconds > 0 ? executed / elapsedSeconds / 1e6 : 0) << endl;
+        out << "Load: time=" << loadSeconds * 1000 << "ms" << endl;
+        out << "Interrupts: timer=" << timerInterrupts << ", terminal=" << terminalInterrupts << endl;
+        if (decodeCacheEnabled)
+            out << "Decode cache: hits=" << decodeCacheHits << ", invalidations=" << decodeCacheInvalidations << endl;
+        if (idleLoopSkipEnabled)
+            out << "Idle loops: skipped cycles=" << skippedCycles << endl;
+        if (engine == ENGINE::jit_engine)
+            out << "JIT: translated blocks=" << jitTranslations << ", flushes=" << jitFlushes << endl;
+        if (engine == ENGINE::aot_engine)
+            out << "AOT: block entries=" << aotBlockEntries << ", interpreted commands=" << aotInterpretedCommands << endl;
+        if (engine == ENGINE::switch_engine && decodeCacheEnabled && commandFusionEnabled) {
+            const char *fusionNames[FUSION::NO_FUSIONS] = {"", "ldr_immed_push", "ldr_immed_push_call", "push_call", "pop_ret", "cmp_jcc", "test_jcc"};
+            out << "Superinstructions: ";
+            for (unsigned i = FUSION::no_fusion + 1; i < FUSION::NO_FUSIONS; i++)
+                out << (i == FUSION::no_fusion + 1 ? "" : ", ") << fusionNames[i] << "=" << fusionHits[i];
+            out << endl;
+        }
+    }
+    if (restoreRuns > 0) {
+        out << "Snapshot: pc=0x" << hex << setfill('0') << setw(4) << (0xFFFF & snapshot.registers[R_INDEX::pc]) << dec;
+        out << ", restores=" << snapshotRestores << ", restored pages=" << restoredPages;
+        out << ", resets/s=" << (restoreLoopSeconds > 0 ? (unsigned long long)(snapshotRestores / restoreLoopSeconds) : 0) << endl;
+    }
+}
+
+bool Emulator::fillMemoryFromInputFile() {
+    const unsigned char *image; // the image is read in place
+    size_t imageSize;
+    void *mapping = MAP_FAILED;
+
+    if (inputImage != nullptr) { // an image given to the constructor
+        image = inputImage;
+        imageSize = inputImageSize;
+    } else if (inputFilePath == "" && AotRuntime::program != nullptr) { // the image built into an executable by the translator
+        image = AotRuntime::program->image;
+        imageSize = AotRuntime::program->imageSize;
+    } else {
+        /* file mapping */
+        int fd = open(inputFilePath.c_str(), O_RDONLY);
+        struct stat fileStatus;
+        if (fd < 0 || fstat(fd, &fileStatus) != 0) {
+            if (fd >= 0) close(fd);
+            reportError(ERROR_KIND::file_error, inputFilePath + " opening failed.");
+            return false;
+        }
+        imageSize = fileStatus.st_size;
+        if (imageSize > 0) mapping = mmap(nullptr, imageSize, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd); // the mapping stays valid
+        if (imageSize > 0 && mapping == MAP_FAILED) {
+            reportError(ERROR_KIND::file_error, inputFilePath + " mapping failed.");
+            return false;
+        }
+        image = (const unsigned char *)mapping;
+    }
 
-        /* ps.segmentData (program segment data) */
-        file.read((char *)(&tmp), sizeof(tmp)); // program segment data length
+    bool loaded = loadImage(image, imageSize);
+    if (mapping != MAP_FAILED) munmap(mapping, imageSize);
+    return loaded;
+}
 
-        ps.segmentData.resize(tmp);
-        file.read((char *)(&ps.segmentData[0]), ps.segmentData.size() * sizeof(ps.segmentData[0]));
+bool Emulator::loadImage(const unsigned char *image, size_t imageSize) {
+    string imageName = inputFilePath != "" ? inputFilePath : inputImage != nullptr ? "The image" : "The built-in image";
 
-        /* ps.baseAddress */
-        file.read((char *)(&ps.baseAddress), sizeof(ps.baseAddress));
+    /* a flat image holds the whole address space, it is copied without parsing (the device registers are left alone) */
+    if (isFlatImage(image, imageSize)) {
+        memcpy(&memory[0], image + FLAT_IMAGE_MAGIC_SIZE, MMAP_REGISTERS_START_ADDRESS);
+        memory[MEMORY_SIZE] = memory[0];
+        return true;
+    }
 
-        /* we load a new segment into the 'memory' array at its address */
-        if (ps.baseAddress + ps.segmentData.size() - 1 > MMAP_REGISTERS_START_ADDRESS) {
-            emulatingErrors.push_back("Program segment overlaps with memory reserved for registers.");
-            return false;
-        }
-        memory.insert(memory.begin() + ps.baseAddress, ps.segmentData.begin(), ps.segmentData.end());
+    /* a linked image - every segment is checked before anything is copied, so a broken image leaves memory untouched */
+    vector<ImageSegment> segments;
+    string error = imageSegments(image, imageSize, MMAP_REGISTERS_START_ADDRESS, imageName, segments);
+    if (error != "") {
+        reportError(ERROR_KIND::image_error, error);
+        return false;
     }
 
-    /* file closing */
-    file.close();
+    /* every segment is copied once, to its address */
+    for (const ImageSegment &segment : segments)
+        if (segment.length > 0) memcpy(&memory[segment.baseAddress], image + segment.offset, segment.length);
+    memory[MEMORY_SIZE] = memory[0];
 
     return true; // everything went well
 }
@@ -126,171 +650,74 @@ bool Emulator::fillMemoryFromInputFile() {
 bool Emulator::commandFetchAndDecode() { // fetching and decoding a command
     // cout << "\n*** FETCH & DECODE: ***" << endl;
 
-    /* reading the first byte of the instruction [opcode (4b) | modifier (4b)] */
+    /* the command may have already been decoded */
+    unsigned commandAddress = 0xFFFF & registers[R_INDEX::pc];
+    if (decodeCacheEnabled && decodeCacheValid[commandAddress]) {
+        if (!decodeCache[commandAddress].fusionChecked && commandFusionEnabled && engine == ENGINE::switch_engine)
+            fuseCommands(commandAddress);
+        cd = decodeCache[commandAddress];
+        registers[R_INDEX::pc] += cd.length;
+        decodeCacheHits++;
+        return true;
+    }
+
+    /* reading the first byte of the instruction [opcode (4b) | modifier (4b)] - the decode table gives its instruction */
     short byte = readFromMemory(0xFFFF & registers[R_INDEX::pc], BYTE); // first byte
-    char operationCode = (0x0F & byte >> 4);
-    char modificator = 0x0F & byte;
+    unsigned operationCode = 0x0F & byte >> 4;
+    const InstructionInfo *instruction = isaDecode(0xFF & byte);
 
     registers[R_INDEX::pc]++;
 
-    // cout << "INSTR : " << (byte & 0xFF) << endl;
-    // cout << "OPCODE : " << (0xFF  & operationCode) << " | MOD : " << (0xFF & modificator) << endl;
-
-    /* we proceed further depending on the operation code */
-    switch (operationCode) {
-        case 0x0: case 0x2: case 0x4:
-            if (modificator != 0x0) {
-                emulatingErrors.push_back("Wrong command specified modificator for operation code: " + (0xFF & operationCode));
-                return false;
-            }
-            cd.mnemonic = operationCode == 0x0 ? MNEMONIC::halt : (operationCode == 0x2 ? MNEMONIC::iret : MNEMONIC::ret);
-            break;
-        case 0x3: case 0x5:
-            switch (byte) { // byte == (operationCode << 4) | modificator
-                case 0x30:
-                    cd.mnemonic = MNEMONIC::call; break;
-                case 0x50:
-                    cd.mnemonic = MNEMONIC::jmp; break;
-                case 0x51:
-                    cd.mnemonic = MNEMONIC::jeq; break;
-                case 0x52:
-                    cd.mnemonic = MNEMONIC::jne; break;
-                case 0x53:
-                    cd.mnemonic = MNEMONIC::jgt; break;
-                default: // wrong modificator for the given opcode
-                    emulatingErrors.push_back("Wrong command specified modificator for operation code: " + (0xFF & operationCode));
-                    return false;
-            }
-
-            /* we read the second byte - [rDst (4b) | rSrc (4b)] */
-            byte = readFromMemory(0xFFFF & registers[R_INDEX::pc], BYTE);
-            cd.rDst = 0x0F & byte >> 4;
-            cd.rSrc = 0x0F & byte;
-
-            // cout << "R_DST = " << cd.rDst << " | DST_VAL = " << (0x0F & (byte >> 4)) << endl;
-
-            registers[R_INDEX::pc]++;
-
-            /* we read the third byte - [update (4b) | addressing mode (4b)] */
-            byte = readFromMemory(0xFFFF & registers[R_INDEX::pc], BYTE);
-            cd.updateType = 0x0F & byte >> 4;
-            cd.addressingMode = 0x0F & byte;
-
-            registers[R_INDEX::pc]++;
-
-            if (cd.addressingMode > ADDRESSING_MODE::regdir_disp) {
-                emulatingErrors.push_back("Wrong command specified addressing mode: " + cd.addressingMode);
-                return false;
-            }
-            if (cd.updateType != UPDATE_TYPE::no_update) {
-                emulatingErrors.push_back("Wrong command specified update type: " + cd.updateType);
-                return false;
-            }
-
-            // depending on 'cd.addressingMode', the command has 3B [regdir, regind] or 5B [immed, regdir_disp, regind_disp, memdir]
-            if (cd.addressingMode != ADDRESSING_MODE::regdir && cd.addressingMode != ADDRESSING_MODE::regind) {
-                cd.payload = readFromMemory(0xFFFF & registers[R_INDEX::pc], WORD, BIG_ENDIAN_ORDER);
-                registers[R_INDEX::pc] += 2;
-            }
-            break;
-        case 0x1: case 0x6: case 0x7: case 0x8: case 0x9:
-            switch (byte) { // byte == (operationCode << 4) | modificator
-                case 0x10:
-                    cd.mnemonic = MNEMONIC::_int; break;
-                case 0x60:
-                    cd.mnemonic = MNEMONIC::xchg; break;
-                case 0x70:
-                    cd.mnemonic = MNEMONIC::add; break;
-                case 0x71:
-                    cd.mnemonic = MNEMONIC::sub; break;
-                case 0x72:
-                    cd.mnemonic = MNEMONIC::mul; break;
-                case 0x73:
-                    cd.mnemonic = MNEMONIC::_div; break;
-                case 0x74:
-                    cd.mnemonic = MNEMONIC::cmp; break;
-                case 0x80:
-                    cd.mnemonic = MNEMONIC::_not; break;
-                case 0x81:
-                    cd.mnemonic = MNEMONIC::_and; break;
-                case 0x82:
-                    cd.mnemonic = MNEMONIC::_or; break;
-                case 0x83:
-                    cd.mnemonic = MNEMONIC::_xor; break;
-                case 0x84:
-                    cd.mnemonic = MNEMONIC::test; break;
-                case 0x90:
-                    cd.mnemonic = MNEMONIC::shl; break;
-                case 0x91:
-                    cd.mnemonic = MNEMONIC::shr; break;
-                default: // wrong modificator for the given opcode
-                    emulatingErrors.push_back("Wrong command specified modificator for operation code: " + (0xFF & operationCode));
-                    return false;
-            }
-
-            /* citamo drugi (poslednji) bajt - [rDst (4b) | rSrc (4b)] */
-            byte = readFromMemory(0xFFFF & registers[R_INDEX::pc], BYTE);
-            cd.rDst = 0x0F & byte >> 4;
-            cd.rSrc = 0x0F & byte;
+    if (instruction == nullptr) {
+        string what = isaOperationCodeExists(operationCode) ? "Wrong command specified modificator for operation code: " : "Wrong command operation code: ";
+        reportError(ERROR_KIND::decode_error, what + to_string(operationCode));
+        return false;
+    }
+    cd.mnemonic = instruction->code;
 
-            registers[R_INDEX::pc]++;
+    /* we read the second byte - [rDst (4b) | rSrc (4b)] */
+    if (instruction->operands != operands_none) {
+        byte = readFromMemory(0xFFFF & registers[R_INDEX::pc], BYTE);
+        cd.rDst = 0x0F & byte >> 4;
+        cd.rSrc = 0x0F & byte;
 
-            if (cd.rDst > R_INDEX::psw
-                || (cd.mnemonic != MNEMONIC::_int && cd.mnemonic != MNEMONIC::_not && cd.rSrc > R_INDEX::psw)
-                || ((cd.mnemonic == MNEMONIC::_int || cd.mnemonic == MNEMONIC::_not) && cd.rSrc != 0xF)) {
-                string errorMessage = "Wrong command specified register indices [rDst = " + cd.rDst;
-                errorMessage += ", rSrc = ";
-                errorMessage += cd.rSrc + "].";
-                emulatingErrors.push_back(errorMessage);
-                return false;
-            }
-            break;
-        case 0xA: case 0xB:
-            if (modificator != 0x0) {
-                emulatingErrors.push_back("Wrong command specified modificator for operation code: " + (0xFF & operationCode));
-                return false;
-            }
-            cd.mnemonic = operationCode == 0xA ? MNEMONIC::ldr_pop : MNEMONIC::str_push;
-
-            /* we read the second byte - [rDst (4b) | rSrc (4b)] */
-            byte = readFromMemory(0xFFFF & registers[R_INDEX::pc], BYTE);
-            cd.rDst = 0x0F & byte >> 4;
-            cd.rSrc = 0x0F & byte;
+        registers[R_INDEX::pc]++;
 
-            // cout << "PC = " << registers[pc] << endl;
-            // cout << "R_DST = " << cd.rDst << " | VAL_DST = " << (0x0F & byte) << endl;
+        if (!isaValidRegisters(*instruction, cd.rDst, cd.rSrc)) {
+            reportError(ERROR_KIND::decode_error, "Wrong command specified register indices [rDst = " + to_string(cd.rDst) + ", rSrc = " + to_string(cd.rSrc) + "].");
+            return false;
+        }
+    }
 
-            registers[R_INDEX::pc]++;
+    /* we read the third byte - [update (4b) | addressing mode (4b)] */
+    if (instruction->length > 2) {
+        byte = readFromMemory(0xFFFF & registers[R_INDEX::pc], BYTE);
+        cd.updateType = 0x0F & byte >> 4;
+        cd.addressingMode = 0x0F & byte;
 
-            if (cd.rDst > R_INDEX::psw) {
-                string errorMessage = "Wrong command specified register indices [rDst = " + cd.rDst;
-                errorMessage += ", rSrc = ";
-                errorMessage += cd.rSrc + "].";
-                emulatingErrors.push_back(errorMessage);
-                return false;
-            }
+        registers[R_INDEX::pc]++;
 
-            /* we read the third byte - [update (4b) | addressing mode (4b)] */
-            byte = readFromMemory(0xFFFF & registers[R_INDEX::pc], BYTE);
-            cd.updateType = 0x0F & byte >> 4;
-            cd.addressingMode = 0x0F & byte;
-
-            registers[R_INDEX::pc]++;
+        if (!isaValidAddressingMode(*instruction, cd.addressingMode)) {
+            reportError(ERROR_KIND::decode_error, "Wrong command specified addressing mode: " + to_string(cd.addressingMode));
+            return false;
+        }
+        if (!isaValidUpdateType(*instruction, cd.updateType)) {
+            reportError(ERROR_KIND::decode_error, "Wrong command specified update type: " + to_string(cd.updateType));
+            return false;
+        }
 
-            if (cd.addressingMode > ADDRESSING_MODE::memdir || (cd.mnemonic == MNEMONIC::str_push && cd.addressingMode == ADDRESSING_MODE::immed)) {
-                emulatingErrors.push_back("Wrong command specified addressing mode: " + cd.addressingMode);
-                return false;
-            }
+        // depending on 'cd.addressingMode', the command has 3B [regdir, regind] or 5B [immed, regind_disp, memdir, regdir_disp]
+        if (isaHasPayload(cd.addressingMode)) {
+            cd.payload = readFromMemory(0xFFFF & registers[R_INDEX::pc], WORD, BIG_ENDIAN_ORDER);
+            registers[R_INDEX::pc] += 2;
+        }
+    }
 
-            // depending on 'cd.addressingMode', the command has 3B [regdir, regind] or 5B [immed, regind_disp, memdir]
-            if (cd.addressingMode != ADDRESSING_MODE::regdir && cd.addressingMode != ADDRESSING_MODE::regind) {
-                cd.payload = readFromMemory(0xFFFF & registers[R_INDEX::pc], WORD, BIG_ENDIAN_ORDER);
-                registers[R_INDEX::pc] += 2;
-            }
-            break;
-        default:
-            emulatingErrors.push_back("Wrong command operation code: " + (0xFF & operationCode));
-            return false;
+    /* successfully decoded commands are kept for the next time the pc reaches them */
+    cd.length = 0xFFFF & (registers[R_INDEX::pc] - commandAddress);
+    if (decodeCacheEnabled) {
+        decodeCache[commandAddress] = cd;
+        decodeCacheValid[commandAddress] = 1;
     }
     return true;
 }
@@ -298,6 +725,69 @@ bool Emulator::commandFetchAndDecode() { // fetching and decoding a command
 bool Emulator::commandExecute(bool &running) { // command execution
     short tmp;
 
+    /* commands that read psw need the flags of the last flag-producing command */
+    bool usesPsw = cd.rDst == R_INDEX::psw || cd.rSrc == R_INDEX::psw;
+    if (lazyFlags.pending && (usesPsw || cd.mnemonic == MNEMONIC::_int))
+        materializePswFlags();
+
+    /* commands that write psw may unmask a pending interrupt request */
+    if (usesPsw || cd.mnemonic == MNEMONIC::iret) requestInterruptCheck();
+
+    /* superinstructions (their commands do not use psw, see fuseCommands()) */
+    unsigned char fusion = cd.fusion; // an index of fusionHits
+    unsigned headAddress = 0xFFFF & (registers[R_INDEX::pc] - cd.length);
+    switch (fusion) {
+        case FUSION::ldr_immed_push: case FUSION::ldr_immed_push_call:
+            // [rX <= payload; push rY (; push pc; pc <= operand)]
+            registers[cd.rDst] = cd.payload;
+            if (!fetchFusedCommand(headAddress, fusion)) return true;
+            registers[cd.rSrc] -= 2;
+            writeToMemory(0xFFFF & registers[cd.rSrc], WORD, registers[cd.rDst]);
+            if (fusion == FUSION::ldr_immed_push_call) {
+                if (!fetchFusedCommand(headAddress, fusion)) return true;
+                pushOnStack(registers[R_INDEX::pc]);
+                registers[R_INDEX::pc] = getOperand();
+                if (emulatingErrors.size() != 0) return false;
+                if (callGraphEnabled) callGraphEnter(0xFFFF & registers[R_INDEX::pc], -1);
+            }
+            fusionHits[fusion]++;
+            return true;
+        case FUSION::push_call:
+            // [push rY; push pc; pc <= operand]
+            registers[cd.rSrc] -= 2;
+            writeToMemory(0xFFFF & registers[cd.rSrc], WORD, registers[cd.rDst]);
+            if (!fetchFusedCommand(headAddress, fusion)) return true;
+            pushOnStack(registers[R_INDEX::pc]);
+            registers[R_INDEX::pc] = getOperand();
+            if (emulatingErrors.size() != 0) return false;
+            if (callGraphEnabled) callGraphEnter(0xFFFF & registers[R_INDEX::pc], -1);
+            fusionHits[fusion]++;
+            return true;
+        case FUSION::pop_ret:
+            // [pop rX; pop pc]
+            registers[cd.rDst] = readFromMemory(0xFFFF & registers[cd.rSrc], WORD);
+            registers[cd.rSrc] += 2;
+            if (!fetchFusedCommand(headAddress, fusion)) return true;
+            registers[R_INDEX::pc] = popFromStack();
+            if (callGraphEnabled) callGraphLeave();
+            fusionHits[fusion]++;
+            return true;
+        case FUSION::cmp_jcc: case FUSION::test_jcc:
+            // [update psw; if (condition) pc <= operand] - jeq and jne only need the z-flag, so psw is not brought up to date for them
+            if (fusion == FUSION::cmp_jcc) tmp = registers[cd.rDst] - registers[cd.rSrc];
+            else tmp = registers[cd.rDst] & registers[cd.rSrc];
+            recordPswFlags(tmp);
+            if (!fetchFusedCommand(headAddress, fusion)) return true;
+            if (cd.mnemonic == MNEMONIC::jgt ? evaluateJumpCondition() : (tmp == 0) == (cd.mnemonic == MNEMONIC::jeq)) {
+                tmp = registers[R_INDEX::pc];
+                registers[R_INDEX::pc] = getOperand();
+                if (emulatingErrors.size() != 0) return false;
+                if (idleLoopSkipEnabled) checkIdleLoop(0xFFFF & tmp);
+            }
+            fusionHits[fusion]++;
+            return true;
+    }
+
     switch (cd.mnemonic) {
         case MNEMONIC::halt:
             /* stops further execution */
@@ -308,12 +798,17 @@ bool Emulator::commandExecute(bool &running) { // command execution
             /* software interrupt (the number of the IVT table entry for which the interrupt request is generated is in 'rDst') */
             // cout << "INT" << endl;
 
-            // [push pc; push psw; pc <= mem[(rDst mod 8)*2]]
+            // [push pc; push psw; pc <= mem[(rDst mod 8)*2]; mask interrupts]
+            if (interruptCallbackHandled(registers[cd.rDst] % 8)) break; // handled by the embedding program
+            if (semihostingEnabled && registers[cd.rDst] % 8 == IVT_ENTRY_SEMIHOSTING) {
+                semihostingRequest(); // handled by the host
+                break;
+            }
             pushOnStack(registers[R_INDEX::pc]);
             pushOnStack(registers[R_INDEX::psw]);
             registers[R_INDEX::pc] = readFromMemory(0xFFFF & (registers[cd.rDst] % 8) * 2, WORD);
-
-            // interrupts should be masked too (but we don't have to because they are not implemented)
+            registers[R_INDEX::psw] |= INTERRUPT_MASK::i;
+            if (callGraphEnabled) callGraphEnter(0xFFFF & registers[R_INDEX::pc], registers[cd.rDst] % 8);
             break;
         case MNEMONIC::iret:
             /* return from interrupt routine */
@@ -322,6 +817,8 @@ bool Emulator::commandExecute(bool &running) { // command execution
             // [pop psw; pop pc]
             registers[R_INDEX::psw] = popFromStack();
             registers[R_INDEX::pc] = popFromStack();
+            lazyFlags.pending = false; // flags are restored together with psw
+            if (callGraphEnabled) callGraphLeave();
             break;
         case MNEMONIC::call:
             /* jump to subroutine */
@@ -331,6 +828,7 @@ bool Emulator::commandExecute(bool &running) { // command execution
             pushOnStack(registers[R_INDEX::pc]);
             registers[R_INDEX::pc] = getOperand();
             if (emulatingErrors.size() != 0) return false;
+            if (callGraphEnabled) callGraphEnter(0xFFFF & registers[R_INDEX::pc], -1);
             break;
         case MNEMONIC::ret:
             /* return from subroutine */
@@ -338,6 +836,7 @@ bool Emulator::commandExecute(bool &running) { // command execution
 
             // [push pc; pc <= operand]
             registers[R_INDEX::pc] = popFromStack();
+            if (callGraphEnabled) callGraphLeave();
             break;
         case MNEMONIC::jmp: case MNEMONIC::jeq: case MNEMONIC::jne: case MNEMONIC::jgt:
             /* conditional jump commands (except 'jmp') */
@@ -345,9 +844,11 @@ bool Emulator::commandExecute(bool &running) { // command execution
 
             // [pc <= operand]
             if (evaluateJumpCondition()) {
+                tmp = registers[R_INDEX::pc];
                 registers[R_INDEX::pc] = getOperand();
                 if (emulatingErrors.size() != 0)
                     return false;
+                if (idleLoopSkipEnabled) checkIdleLoop(0xFFFF & tmp);
             }
             break;
         case MNEMONIC::xchg:
@@ -379,7 +880,7 @@ bool Emulator::commandExecute(bool &running) { // command execution
             // cout << "DIV" << endl;
 
             if (registers[cd.rSrc] == 0) {
-                emulatingErrors.push_back("Division with zero is undefined.");
+                reportError(ERROR_KIND::execution_error, "Division with zero is undefined.");
                 return false;
             }
             registers[cd.rDst] /= registers[cd.rSrc];
@@ -389,7 +890,7 @@ bool Emulator::commandExecute(bool &running) { // command execution
             // cout << "CMP" << endl;
 
             tmp = registers[cd.rDst] - registers[cd.rSrc];
-            updatePswFlags(tmp);
+            recordPswFlags(tmp);
             break;
         case MNEMONIC::_not:
             /* bitwise not of rDst */
@@ -420,7 +921,7 @@ bool Emulator::commandExecute(bool &running) { // command execution
             // cout << "TEST" << endl;
 
             tmp = registers[cd.rDst] & registers[cd.rSrc];
-            updatePswFlags(tmp);
+            recordPswFlags(tmp);
             break;
         case MNEMONIC::shl: case MNEMONIC::shr:
             /* bitwise shift left/right and change of PSW flags */
@@ -430,8 +931,9 @@ bool Emulator::commandExecute(bool &running) { // command execution
             // [rDst <= (rDst >> rSrc); update psw] - SHR
             if (cd.mnemonic == MNEMONIC::shl) tmp = registers[cd.rDst] << registers[cd.rSrc];
             else tmp = registers[cd.rDst] >> registers[cd.rSrc];
-            updatePswFlags(tmp);
+            recordPswFlags(tmp);
             registers[cd.rDst] = tmp;
+            if (cd.rDst == R_INDEX::psw) lazyFlags.pending = false; // the result replaces the flags
             break;
         case MNEMONIC::ldr_pop:
             /* loads an operand to 'rDst' */
@@ -451,23 +953,410 @@ bool Emulator::commandExecute(bool &running) { // command execution
             if (!setOperand()) return false;
             break;
         default:
-            emulatingErrors.push_back("Can not proceed executing unknown instruction.");
+            reportError(ERROR_KIND::execution_error, "Can not proceed executing unknown instruction.");
             return false;
     }
     return true;
 }
 
+/* threaded engine */
+// a command is dispatched by jumping straight to the handler stored in its predecoded form
+#define THREADED_DISPATCH() \
+    do { \
+        if (instructionsRetired >= nextEventCycle) goto events; \
+        commandAddress = 0xFFFF & registers[R_INDEX::pc]; \
+        if (!decodeCacheValid[commandAddress]) goto decode; \
+        cd = decodeCache[commandAddress]; \
+        registers[R_INDEX::pc] += cd.length; \
+        decodeCacheHits++; \
+        instructionsRetired++; \
+        if (pcCounts != nullptr) pcCounts[commandAddress]++; \
+        if (traceEnabled) traceCommand(); \
+        goto *cd.handler; \
+    } while (0)
+
+bool Emulator::threadedExecute() { // command execution using direct-threaded dispatch (GCC labels-as-values)
+    /* handler addresses indexed by the first byte of a command */
+    const void *handlers[256];
+    for (unsigned i = 0; i < 256; i++) handlers[i] = &&unknown_handler;
+
+    handlers[MNEMONIC::halt] = &&halt_handler;
+    handlers[MNEMONIC::_int] = &&int_handler;
+    handlers[MNEMONIC::iret] = &&iret_handler;
+    handlers[MNEMONIC::call] = &&call_handler;
+    handlers[MNEMONIC::ret] = &&ret_handler;
+    handlers[MNEMONIC::jmp] = &&jmp_handler;
+    handlers[MNEMONIC::jeq] = handlers[MNEMONIC::jne] = handlers[MNEMONIC::jgt] = &&conditional_jump_handler;
+    handlers[MNEMONIC::xchg] = &&xchg_handler;
+    handlers[MNEMONIC::add] = &&add_handler;
+    handlers[MNEMONIC::sub] = &&sub_handler;
+    handlers[MNEMONIC::mul] = &&mul_handler;
+    handlers[MNEMONIC::_div] = &&div_handler;
+    handlers[MNEMONIC::cmp] = &&cmp_handler;
+    handlers[MNEMONIC::_not] = &&not_handler;
+    handlers[MNEMONIC::_and] = &&and_handler;
+    handlers[MNEMONIC::_or] = &&or_handler;
+    handlers[MNEMONIC::_xor] = &&xor_handler;
+    handlers[MNEMONIC::test] = &&test_handler;
+    handlers[MNEMONIC::shl] = handlers[MNEMONIC::shr] = &&shift_handler;
+    handlers[MNEMONIC::ldr_pop] = &&ldr_handler;
+    handlers[MNEMONIC::str_push] = &&str_handler;
+
+    // the decode cache is the predecoded command stream of this engine (execute() turns it off again after the run)
+    decodeCacheEnabled = true;
+
+    unsigned commandAddress;
+    const void *handler;
+    unsigned long long *pcCounts = profilingEnabled ? &profilePcs[0] : nullptr; // see execute()
+    bool running;
+    short tmp;
+
+    THREADED_DISPATCH();
+
+decode: // the command at pc is not predecoded yet (or a store has overwritten it)
+    cd = {};
+    if (!commandFetchAndDecode()) return false;
+
+    /* the most common forms of ldr/str get handlers of their own */
+    handler = handlers[cd.mnemonic];
+    if (cd.mnemonic == MNEMONIC::ldr_pop && cd.updateType == UPDATE_TYPE::no_update) {
+        if (cd.addressingMode == ADDRESSING_MODE::immed) handler = &&ldr_immed_handler;
+        else if (cd.addressingMode == ADDRESSING_MODE::regdir) handler = &&ldr_regdir_handler;
+    } else if (cd.mnemonic == MNEMONIC::ldr_pop && cd.updateType == UPDATE_TYPE::post_increment && cd.addressingMode == ADDRESSING_MODE::regind)
+        handler = &&pop_handler;
+    else if (cd.mnemonic == MNEMONIC::str_push && cd.updateType == UPDATE_TYPE::pre_decrement && cd.addressingMode == ADDRESSING_MODE::regind)
+        handler = &&push_handler;
+    if (cd.rDst == R_INDEX::psw || cd.rSrc == R_INDEX::psw) handler = &&generic_handler; // see commandExecute() and the lazy flags
+
+    cd.handler = decodeCache[commandAddress].handler = handler;
+    instructionsRetired++;
+    if (pcCounts != nullptr) pcCounts[commandAddress]++;
+    if (traceEnabled) traceCommand();
+    goto *handler;
+
+events: // device events are due (or psw was written while an interrupt request is pending)
+    handleEvents();
+    if (stopRequested) return true;
+    THREADED_DISPATCH();
+
+halt_handler:
+    return true;
+
+int_handler:
+    materializePswFlags();
+    if (interruptCallbackHandled(registers[cd.rDst] % 8)) THREADED_DISPATCH();
+    if (semihostingEnabled && registers[cd.rDst] % 8 == IVT_ENTRY_SEMIHOSTING) {
+        semihostingRequest();
+        THREADED_DISPATCH();
+    }
+    pushOnStack(registers[R_INDEX::pc]);
+    pushOnStack(registers[R_INDEX::psw]);
+    registers[R_INDEX::pc] = readFromMemory(0xFFFF & (registers[cd.rDst] % 8) * 2, WORD);
+    registers[R_INDEX::psw] |= INTERRUPT_MASK::i;
+    if (callGraphEnabled) callGraphEnter(0xFFFF & registers[R_INDEX::pc], registers[cd.rDst] % 8);
+    THREADED_DISPATCH();
+
+iret_handler:
+    registers[R_INDEX::psw] = popFromStack();
+    registers[R_INDEX::pc] = popFromStack();
+    lazyFlags.pending = false;
+    requestInterruptCheck();
+    if (callGraphEnabled) callGraphLeave();
+    THREADED_DISPATCH();
+
+call_handler:
+    pushOnStack(registers[R_INDEX::pc]);
+    registers[R_INDEX::pc] = getOperand();
+    if (emulatingErrors.size() != 0) return false;
+    if (callGraphEnabled) callGraphEnter(0xFFFF & registers[R_INDEX::pc], -1);
+    THREADED_DISPATCH();
+
+ret_handler:
+    registers[R_INDEX::pc] = popFromStack();
+    if (callGraphEnabled) callGraphLeave();
+    THREADED_DISPATCH();
+
+jmp_handler:
+    tmp = registers[R_INDEX::pc];
+    registers[R_INDEX::pc] = getOperand();
+    if (emulatingErrors.size() != 0) return false;
+    if (idleLoopSkipEnabled) checkIdleLoop(0xFFFF & tmp);
+    THREADED_DISPATCH();
+
+conditional_jump_handler:
+    if (evaluateJumpCondition()) {
+        tmp = registers[R_INDEX::pc];
+        registers[R_INDEX::pc] = getOperand();
+        if (emulatingErrors.size() != 0) return false;
+        if (idleLoopSkipEnabled) checkIdleLoop(0xFFFF & tmp);
+    }
+    THREADED_DISPATCH();
+
+xchg_handler:
+    swap(registers[cd.rDst], registers[cd.rSrc]);
+    THREADED_DISPATCH();
+
+add_handler:
+    registers[cd.rDst] += registers[cd.rSrc];
+    THREADED_DISPATCH();
+
+sub_handler:
+    registers[cd.rDst] -= registers[cd.rSrc];
+    THREADED_DISPATCH();
+
+mul_handler:
+    registers[cd.rDst] *= registers[cd.rSrc];
+    THREADED_DISPATCH();
+
+div_handler:
+    if (registers[cd.rSrc] == 0) {
+        reportError(ERROR_KIND::execution_error, "Division with zero is undefined.");
+        return false;
+    }
+    registers[cd.rDst] /= registers[cd.rSrc];
+    THREADED_DISPATCH();
+
+cmp_handler:
+    tmp = registers[cd.rDst] - registers[cd.rSrc];
+    recordPswFlags(tmp);
+    THREADED_DISPATCH();
+
+not_handler:
+    registers[cd.rDst] = ~registers[cd.rDst];
+    THREADED_DISPATCH();
+
+and_handler:
+    registers[cd.rDst] &= registers[cd.rSrc];
+    THREADED_DISPATCH();
+
+or_handler:
+    registers[cd.rDst] |= registers[cd.rSrc];
+    THREADED_DISPATCH();
+
+xor_handler:
+    registers[cd.rDst] ^= registers[cd.rSrc];
+    THREADED_DISPATCH();
+
+test_handler:
+    tmp = registers[cd.rDst] & registers[cd.rSrc];
+    recordPswFlags(tmp);
+    THREADED_DISPATCH();
+
+shift_handler:
+    if (cd.mnemonic == MNEMONIC::shl) tmp = registers[cd.rDst] << registers[cd.rSrc];
+    else tmp = registers[cd.rDst] >> registers[cd.rSrc];
+    recordPswFlags(tmp);
+    registers[cd.rDst] = tmp;
+    if (cd.rDst == R_INDEX::psw) lazyFlags.pending = false; // the result replaces the flags
+    THREADED_DISPATCH();
+
+ldr_handler:
+    registers[cd.rDst] = getOperand();
+    if (emulatingErrors.size() != 0) return false;
+    updateSource();
+    THREADED_DISPATCH();
+
+ldr_immed_handler: // ldr rDst, $<literal/symbol>
+    registers[cd.rDst] = cd.payload;
+    THREADED_DISPATCH();
+
+ldr_regdir_handler: // ldr rDst, rSrc
+    registers[cd.rDst] = registers[cd.rSrc];
+    THREADED_DISPATCH();
+
+pop_handler: // pop rDst
+    registers[cd.rDst] = readFromMemory(0xFFFF & registers[cd.rSrc], WORD);
+    registers[cd.rSrc] += 2;
+    THREADED_DISPATCH();
+
+str_handler:
+    updateSource();
+    if (!setOperand()) return false;
+    THREADED_DISPATCH();
+
+push_handler: // push rDst
+    registers[cd.rSrc] -= 2;
+    writeToMemory(0xFFFF & registers[cd.rSrc], WORD, registers[cd.rDst]);
+    THREADED_DISPATCH();
+
+generic_handler: // the switch engine executes the command
+    running = true;
+    if (!commandExecute(running)) return false;
+    if (!running) return true;
+    THREADED_DISPATCH();
+
+unknown_handler:
+    reportError(ERROR_KIND::execution_error, "Can not proceed executing unknown instruction.");
+    return false;
+}
+
+#undef THREADED_DISPATCH
+
+/* snapshots */
+void Emulator::takeSnapshot() {
+    materializePswFlags();
+
+    snapshot.taken = true;
+    snapshot.memory = memory;
+    snapshot.registers = registers;
+    snapshot.lazyFlags = lazyFlags;
+    snapshot.deviceEvents = deviceEvents;
+    snapshot.nextEventCycle = nextEventCycle;
+    snapshot.timerEventCycle = timerEventCycle;
+    snapshot.interruptRequests = interruptRequests;
+    snapshot.idleLoop = idleLoop;
+    snapshot.memoryWrites = memoryWrites;
+    snapshot.hostEffects = hostEffects;
+    snapshot.skippedCycles = skippedCycles;
+    snapshot.instructionsRetired = instructionsRetired;
+    snapshot.terminalInputClosed = terminalInputClosed;
+    snapshot.callStack = callStack;
+    snapshot.callStackOverflow = callStackOverflow;
+
+    dirtyPages.reset();
+}
+
+bool Emulator::restoreSnapshot() {
+    if (!snapshot.taken) {
+        reportError(ERROR_KIND::state_error, "There is no snapshot to restore.");
+        return false;
+    }
+
+    /* memory pages written since the snapshot */
+    bool translatedCodeRestored = false;
+    for (unsigned page = 0; page < NO_MEMORY_PAGES; page++) {
+        if (!dirtyPages[page]) continue;
+
+        for (unsigned address = page * MEMORY_PAGE_SIZE; address < (page + 1) * MEMORY_PAGE_SIZE; address++) {
+            if (memory[address] == snapshot.memory[address]) continue;
+
+            // decoded and translated forms of the restored bytes are stale, like after a store
+            if (profilingEnabled && !decodeCacheEnabled) profileCodeChanging(address, 1);
+            memory[address] = snapshot.memory[address];
+            if (address == 0) memory[MEMORY_SIZE] = memory[0];
+            invalidateDecodeCache(address);
+            if (!jitCodeBytes.empty() && jitCodeBytes[address]) translatedCodeRestored = true;
+            if (!aotCodeBytes.empty() && aotCodeBytes[address]) aotCodeModified = true;
+        }
+        restoredPages++;
+    }
+    dirtyPages.reset();
+    if (translatedCodeRestored) jitFlush();
+
+    registers = snapshot.registers;
+    lazyFlags = snapshot.lazyFlags;
+    deviceEvents = snapshot.deviceEvents;
+    nextEventCycle = snapshot.nextEventCycle;
+    timerEventCycle = snapshot.timerEventCycle;
+    interruptRequests = snapshot.interruptRequests;
+    idleLoop = snapshot.idleLoop;
+    memoryWrites = snapshot.memoryWrites;
+    hostEffects = snapshot.hostEffects;
+    skippedCycles = snapshot.skippedCycles;
+    instructionsRetired = snapshot.instructionsRetired;
+    terminalInputClosed = snapshot.terminalInputClosed;
+    callStack = snapshot.callStack;
+    callStackOverflow = snapshot.callStackOverflow;
+    callGraphCharged = instructionsRetired;
+    stopRequested = programHalted = false;
+    emulatingErrors.clear();
+
+    snapshotRestores++;
+    return true;
+}
+
+bool Emulator::resume() {
+    return execute();
+}
+
+void Emulator::setRegister(unsigned index, short value) {
+    if (index >= NO_REGISTERS) {
+        reportError(ERROR_KIND::state_error, "There is no register " + to_string(index) + ".");
+        return;
+    }
+    materializePswFlags(); // a written psw must not be overwritten by the recorded flags
+    registers[index] = value;
+    if (index == R_INDEX::psw) requestInterruptCheck();
+}
+
+void Emulator::writeMemoryWord(unsigned address, short value) {
+    writeToMemory(0xFFFF & address, WORD, value);
+}
+
+void Emulator::writeMemoryByte(unsigned address, unsigned char value) {
+    writeToMemory(0xFFFF & address, BYTE, value);
+}
+
+void Emulator::reportError(ERROR_KIND kind, string message) {
+    emulatingErrors.push_back({kind, (unsigned short)registers[R_INDEX::pc], instructionsRetired, message});
+}
+
 /* utility methods */
 short Emulator::readFromMemory(int startAddress, unsigned nOfBytes, bool littleEndian) {                                                                  // nOfBytes == 1 || nOfBytes == 2
-    int lowerByte = memory[startAddress];                          // lower byte
-    int higherByte = nOfBytes == WORD ? memory[startAddress + 1] : 0; // higher byte
+    // data is read in words, little endian (commands are fetched byte by byte and their payload is big endian)
+    if (profilingEnabled && nOfBytes == WORD && littleEndian) profilePageReads[(0xFFFF & startAddress) / MEMORY_PAGE_SIZE]++;
+
+    // a RAM page is read in place (a word at its end takes the higher byte from the following page, if it is RAM too)
+    const char *ram = bus[(0xFFFF & startAddress) / MEMORY_PAGE_SIZE].ram;
+    bool pageEnd = nOfBytes == WORD && startAddress % MEMORY_PAGE_SIZE == MEMORY_PAGE_SIZE - 1;
+    if (ram == nullptr || (pageEnd && deviceWord(startAddress))) return readFromDevice(startAddress, nOfBytes, littleEndian);
+    ram += startAddress % MEMORY_PAGE_SIZE;
+
+    int lowerByte = ram[0];                          // lower byte
+    int higherByte = nOfBytes == WORD ? ram[1] : 0; // higher byte
 
     if (littleEndian)
         return higherByte << 8 | (0xFF & lowerByte); // 'lowerByte' is the least significant byte
     return lowerByte << 8 | (0xFF & higherByte);     // 'lowerByte' is the most significant byte
 }
 
+short Emulator::readFromDevice(int startAddress, unsigned nOfBytes, bool littleEndian) {
+    // commands are fetched from the stored bytes, only data words are read by the device
+    int lowerByte = memory[0xFFFF & startAddress];
+    int higherByte = nOfBytes == WORD ? memory[0xFFFF & (startAddress + 1)] : 0;
+
+    if (!littleEndian) return lowerByte << 8 | (0xFF & higherByte);
+    short value = higherByte << 8 | (0xFF & lowerByte);
+    if (nOfBytes != WORD) return value;
+
+    BusDevice *device = bus[(0xFFFF & startAddress) / MEMORY_PAGE_SIZE].device;
+    BusDevice *higherDevice = bus[(0xFFFF & (startAddress + 1)) / MEMORY_PAGE_SIZE].device;
+    if (device == higherDevice) return deviceRead(device, 0xFFFF & startAddress, value);
+
+    // a word across two pages is read as two bytes - every device reads the word at its byte and gives the lower byte of it
+    short higherWord = (memory[0xFFFF & (startAddress + 2)] << 8) | (0xFF & higherByte);
+    lowerByte = deviceRead(device, 0xFFFF & startAddress, value);
+    higherByte = deviceRead(higherDevice, 0xFFFF & (startAddress + 1), higherWord);
+    return (0xFF & higherByte) << 8 | (0xFF & lowerByte);
+}
+
+bool Emulator::deviceWord(unsigned address) {
+    return bus[(0xFFFF & address) / MEMORY_PAGE_SIZE].device != nullptr || bus[(0xFFFF & (address + 1)) / MEMORY_PAGE_SIZE].device != nullptr;
+}
+
+short Emulator::deviceRead(BusDevice *device, unsigned address, short value) {
+    if (device == nullptr) return value;
+    if (device != &registersDevice) hostEffects++; // a device of the embedding program (the registers count their callbacks)
+    return device->read(address, value);
+}
+
+void Emulator::deviceWrite(BusDevice *device, unsigned address, short &value) {
+    if (device == nullptr) return;
+    if (device != &registersDevice) hostEffects++;
+    device->write(address, value);
+}
+
 void Emulator::writeToMemory(int startAddress, unsigned nOfBytes, short value) {
+    /* a device sees the write to its page before the value is stored (a word across two pages as two bytes) */
+    BusDevice *device = bus[(0xFFFF & startAddress) / MEMORY_PAGE_SIZE].device;
+    if (nOfBytes == WORD && startAddress % MEMORY_PAGE_SIZE == MEMORY_PAGE_SIZE - 1 && deviceWord(startAddress)) {
+        short lowerByte = 0xFF & value, higherByte = 0xFF & (value >> 8);
+        deviceWrite(device, 0xFFFF & startAddress, lowerByte);
+        deviceWrite(bus[(0xFFFF & (startAddress + 1)) / MEMORY_PAGE_SIZE].device, 0xFFFF & (startAddress + 1), higherByte);
+        value = higherByte << 8 | (0xFF & lowerByte);
+    } else deviceWrite(device, 0xFFFF & startAddress, value);
+
+    if (profilingEnabled && !decodeCacheEnabled) profileCodeChanging(0xFFFF & startAddress, nOfBytes);
     if (nOfBytes == BYTE) memory[startAddress] = 0xFF & value;
     else {
         /* let's prepare lower and younger byte values for writing */
@@ -476,8 +1365,457 @@ void Emulator::writeToMemory(int startAddress, unsigned nOfBytes, short value) {
 
         /* memory write (always little endian) */
         memory[startAddress] = firstByte;
-        memory[startAddress + 1] = secondByte;
+        memory[0xFFFF & (startAddress + 1)] = secondByte;
+    }
+    memory[MEMORY_SIZE] = memory[0]; // reads of a word at 0xFFFF (and the translated code) take its higher byte from here
+
+    memoryWrites++;
+    if (tracePending) {
+        TraceRecord &record = traceBuffer[traceNext];
+        record.written = 1;
+        record.writeAddress = 0xFFFF & startAddress;
+        record.writeValue = nOfBytes == BYTE ? 0xFF & value : value;
     }
+    if (profilingEnabled) profilePageWrites[(0xFFFF & startAddress) / MEMORY_PAGE_SIZE]++;
+    dirtyPages[(0xFFFF & startAddress) / MEMORY_PAGE_SIZE] = true;
+    if (nOfBytes == WORD) dirtyPages[(0xFFFF & (startAddress + 1)) / MEMORY_PAGE_SIZE] = true;
+
+    /* a store into translated code makes all translations stale */
+    if (!jitCodeBytes.empty() && (jitCodeBytes[0xFFFF & startAddress] || (nOfBytes == WORD && jitCodeBytes[0xFFFF & (startAddress + 1)])))
+        jitFlush();
+    if (!aotCodeBytes.empty() && (aotCodeBytes[0xFFFF & startAddress] || (nOfBytes == WORD && aotCodeBytes[0xFFFF & (startAddress + 1)])))
+        aotCodeModified = true; // the dispatcher disables the overwritten blocks
+
+    /* a store into a cached command makes its decoded form stale */
+    if (decodeCacheEnabled) {
+        invalidateDecodeCache(startAddress);
+        if (nOfBytes == WORD) invalidateDecodeCache(startAddress + 1);
+    }
+}
+
+/* semihosting */
+void Emulator::semihostingRequest() {
+    hostEffects++; // the loop of a request is never idle, even if the request changes nothing in the machine
+
+    unsigned operation = 0xFFFF & registers[R_INDEX::r1];
+    unsigned pathAddress = 0xFFFF & registers[R_INDEX::r2];
+    unsigned address = 0xFFFF & registers[R_INDEX::r3];
+    unsigned length = min<unsigned>(0xFFFF & registers[R_INDEX::r4], SEMIHOSTING_MAX_LENGTH); // a longer transfer is cut short
+
+    // a path has to end before the end of memory
+    string path;
+    if (pathAddress != 0) {
+        const char *end = (const char *)memchr(&memory[pathAddress], 0, MEMORY_SIZE - pathAddress);
+        if (end != nullptr) path.assign(&memory[pathAddress], end - &memory[pathAddress]);
+    }
+
+    short result = -1;
+    switch (operation) {
+        case SEMIHOSTING_OPERATION::semihosting_write: case SEMIHOSTING_OPERATION::semihosting_append: {
+            if (!semihostingBuffer(address, length)) break;
+            if (pathAddress == 0) {
+                if (output != nullptr && output->write(&memory[address], length).flush()) result = length;
+                break;
+            }
+            if (path == "") break;
+            ofstream file(path, ios::binary | (operation == SEMIHOSTING_OPERATION::semihosting_append ? ios::app : ios::trunc));
+            if (file.write(&memory[address], length)) result = length;
+            break;
+        }
+        case SEMIHOSTING_OPERATION::semihosting_read: {
+            if (!semihostingBuffer(address, length) || path == "") break;
+            ifstream file(path, ios::binary);
+            if (!file) break;
+            if (profilingEnabled && !decodeCacheEnabled) profileCodeChanging(address, length);
+            file.read(&memory[address], length);
+            size_t bytesRead = file.gcount();
+            memoryCopiedIn(address, bytesRead);
+            result = bytesRead;
+            break;
+        }
+        case SEMIHOSTING_OPERATION::semihosting_clock: {
+            unsigned long long now = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+            unsigned long long elapsed = now - semihostingClockStart;
+            registers[R_INDEX::r2] = 0xFFFF & (elapsed >> 16);
+            result = 0xFFFF & elapsed;
+            break;
+        }
+    }
+    registers[R_INDEX::r1] = result;
+}
+
+bool Emulator::semihostingBuffer(unsigned address, unsigned length) {
+    if (address + length > MEMORY_SIZE) return false;
+    for (unsigned page = address / MEMORY_PAGE_SIZE; length > 0 && page <= (address + length - 1) / MEMORY_PAGE_SIZE; page++)
+        if (bus[page].ram == nullptr) return false; // devices see their registers accessed one word at a time
+    return true;
+}
+
+void Emulator::memoryCopiedIn(unsigned address, unsigned length) {
+    if (length == 0) return;
+    if (address == 0) memory[MEMORY_SIZE] = memory[0];
+    memoryWrites++;
+
+    bool translatedCodeWritten = false;
+    for (unsigned i = address; i < address + length; i++) {
+        if (!jitCodeBytes.empty() && jitCodeBytes[i]) translatedCodeWritten = true;
+        if (!aotCodeBytes.empty() && aotCodeBytes[i]) aotCodeModified = true;
+        if (decodeCacheEnabled) invalidateDecodeCache(i);
+    }
+    for (unsigned page = address / MEMORY_PAGE_SIZE; page <= (address + length - 1) / MEMORY_PAGE_SIZE; page++)
+        dirtyPages[page] = true;
+    if (translatedCodeWritten) jitFlush();
+}
+
+void Emulator::profileCommand() {
+    profilePcs[0xFFFF & (registers[R_INDEX::pc] - cd.length)]++;
+}
+
+void Emulator::profileFold(unsigned address, unsigned char mnemonic, unsigned addressingMode) {
+    unsigned long long count = profilePcs[address] - profileFoldedPcs[address];
+    if (count == 0) return;
+    profileFoldedPcs[address] = profilePcs[address];
+    profileMnemonics[mnemonic] += count;
+
+    // only jumps, call, ldr and str have an addressing mode
+    bool hasOperand = (mnemonic >= MNEMONIC::call && mnemonic <= MNEMONIC::jgt && mnemonic != MNEMONIC::ret) || mnemonic >= MNEMONIC::ldr_pop;
+    profileAddressingModes[hasOperand ? addressingMode : NO_ADDRESSING_MODES] += count;
+}
+
+void Emulator::profileFoldFromMemory(unsigned address) {
+    // the bytes are still those of the counted command, every change is folded first
+    if (profilePcs[address] == profileFoldedPcs[address]) return;
+    const InstructionInfo *instruction = isaDecode(memory[address]);
+    if (instruction != nullptr) profileFold(address, instruction->code, 0x0F & memory[0xFFFF & (address + 2)]);
+}
+
+void Emulator::profileCodeChanging(unsigned address, unsigned length) {
+    for (unsigned i = address + MEMORY_SIZE - (MAX_COMMAND_LENGTH - 1); i != address + MEMORY_SIZE + length; i++)
+        profileFoldFromMemory(0xFFFF & i);
+}
+
+void Emulator::profileFoldAll() {
+    for (unsigned address = 0; address < MEMORY_SIZE; address++)
+        profileFoldFromMemory(address);
+}
+
+/* execution trace */
+void Emulator::traceCommand() {
+    if (tracePending) traceFinish();
+
+    TraceRecord &record = traceBuffer[traceNext];
+    unsigned address = 0xFFFF & (registers[R_INDEX::pc] - cd.length);
+    record.pc = address;
+    record.length = cd.length;
+    if (address <= MEMORY_SIZE - MAX_COMMAND_LENGTH) memcpy(record.bytes, &memory[address], MAX_COMMAND_LENGTH); // bytes past the command are not shown
+    else
+        for (unsigned i = 0; i < (unsigned)cd.length; i++)
+            record.bytes[i] = memory[0xFFFF & (address + i)];
+    record.rDst = (unsigned char)cd.rDst < NO_REGISTERS ? cd.rDst : NO_REGISTERS;
+    record.written = 0;
+    tracePending = true;
+}
+
+void Emulator::traceFinish() {
+    TraceRecord &record = traceBuffer[traceNext];
+    if (record.rDst < NO_REGISTERS) record.rDstValue = registers[record.rDst];
+
+    if (++traceNext == traceBuffer.size()) traceNext = 0;
+    traceRecords++;
+    tracePending = false;
+}
+
+/* call graph */
+void Emulator::callGraphEnter(unsigned address, int interruptEntry) {
+    callGraphCharge();
+    if (callStack.size() >= CALL_GRAPH_MAX_DEPTH) { // e.g. a routine that never returns calls itself
+        callStackOverflow++;
+        return;
+    }
+
+    // a frame stands for a call path, so the same routine gets a frame of its own for every caller
+    unsigned long long key = (unsigned long long)callStack.back() << 32 | (unsigned long long)(0xFF & (interruptEntry + 1)) << 16 | address;
+    auto child = callGraphChildren.find(key);
+    if (child == callGraphChildren.end()) {
+        child = callGraphChildren.insert({key, (unsigned)callGraphFrames.size()}).first;
+        callGraphFrames.push_back({callStack.back(), address, interruptEntry, 0});
+    }
+    callStack.push_back(child->second);
+}
+
+void Emulator::callGraphLeave() {
+    callGraphCharge();
+    if (callStackOverflow > 0) callStackOverflow--;
+    else if (callStack.size() > 1) callStack.pop_back(); // a return without a call stays in the routine of the program start
+}
+
+void Emulator::callGraphCharge() {
+    // every command takes one cycle, so the retired instructions (including skipped idle loops) are the virtual time
+    callGraphFrames[callStack.back()].cycles += instructionsRetired - callGraphCharged;
+    callGraphCharged = instructionsRetired;
+}
+
+string Emulator::callGraphFrameName(const CallGraphFrame &frame) {
+    string name;
+    auto symbol = symbols.find(frame.address);
+    if (symbol != symbols.end()) name = symbol->second;
+    else {
+        ostringstream address;
+        address << "0x" << hex << setfill('0') << setw(4) << frame.address;
+        name = address.str();
+    }
+
+    // interrupt routines are frames of their own, e.g. 'int2:isr_timer'
+    if (frame.interruptEntry >= 0) name = "int" + to_string(frame.interruptEntry) + ":" + name;
+    return name;
+}
+
+/* devices */
+static unsigned long long timerPeriodCycles(short timCfg) {
+    const unsigned long long periods[8] = {500, 1000, 1500, 2000, 5000, 10000, 30000, 60000}; // in milliseconds
+    return periods[timCfg & 0x7] * CYCLES_PER_MILLISECOND;
+}
+
+void Emulator::startDevices() {
+    /* the keyboard is read character by character, without echo */
+    if (terminalInputFd >= 0 && isatty(terminalInputFd) && tcgetattr(terminalInputFd, &savedTerminalSettings) == 0) {
+        struct termios settings = savedTerminalSettings;
+        settings.c_lflag &= ~(ICANON | ECHO);
+        settings.c_cc[VMIN] = 1;
+        settings.c_cc[VTIME] = 0;
+        terminalSettingsSaved = tcsetattr(terminalInputFd, TCSANOW, &settings) == 0;
+    }
+    terminalInputClosed = terminalInputFd < 0;
+
+    timerEventCycle = instructionsRetired + timerPeriodCycles(readMemoryWord(TIM_CFG_ADDRESS));
+    scheduleDeviceEvent(DEVICE::timer_device, timerEventCycle);
+    if (!terminalInputClosed) scheduleDeviceEvent(DEVICE::terminal_device, instructionsRetired + TERMINAL_POLL_CYCLES);
+    if (instructionLimit != ~0ULL) scheduleDeviceEvent(DEVICE::instruction_limit, instructionLimit);
+}
+
+void Emulator::scheduleDeviceEvent(char device, unsigned long long cycle) {
+    deviceEvents.push({cycle, device});
+    if (cycle < nextEventCycle) nextEventCycle = cycle;
+}
+
+bool Emulator::interruptCallbackHandled(int entry) {
+    if (interruptCallback == nullptr) return false;
+    hostEffects++; // the embedding program has seen the command
+    return interruptCallback(entry);
+}
+
+short Emulator::RegistersDevice::read(unsigned address, short value) {
+    if (emulator->deviceCallback != nullptr) {
+        emulator->hostEffects++;
+        emulator->deviceCallback(address, false, value);
+    }
+    return value;
+}
+
+void Emulator::RegistersDevice::write(unsigned address, short &value) {
+    if (emulator->deviceCallback != nullptr) {
+        emulator->hostEffects++;
+        emulator->deviceCallback(address, true, value);
+    }
+    emulator->deviceRegisterWritten(address, value);
+}
+
+void Emulator::deviceRegisterWritten(int address, short value) {
+    switch (address) {
+        case TERM_OUT_ADDRESS:
+            if (output != nullptr) *output << (char)value << flush;
+            break;
+        case TIM_CFG_ADDRESS:
+            // the new period counts from now, the event scheduled with the old one is ignored
+            timerEventCycle = instructionsRetired + timerPeriodCycles(value);
+            scheduleDeviceEvent(DEVICE::timer_device, timerEventCycle);
+            break;
+    }
+}
+
+void Emulator::handleEvents() {
+    // devices and interrupt entries do not belong to the command before them
+    if (tracePending) traceFinish();
+
+    /* due events in the order of their virtual time */
+    while (!deviceEvents.empty() && deviceEvents.top().cycle <= instructionsRetired) {
+        DeviceEvent event = deviceEvents.top();
+        deviceEvents.pop();
+
+        switch (event.device) {
+            case DEVICE::timer_device:
+                if (event.cycle != timerEventCycle) break; // tim_cfg has been written since
+                interruptRequests |= 1 << IVT_ENTRY_TIMER;
+                timerEventCycle = event.cycle + timerPeriodCycles(readMemoryWord(TIM_CFG_ADDRESS));
+                scheduleDeviceEvent(DEVICE::timer_device, timerEventCycle);
+                break;
+            case DEVICE::instruction_limit:
+                stopRequested = true;
+                break;
+            case DEVICE::instruction_budget:
+                if (event.cycle != instructionBudget) break; // a budget of an earlier run
+                stopRequested = true;
+                instructionBudget = ~0ULL;
+                break;
+            case DEVICE::terminal_device: {
+                // with the terminal interrupt unmasked, the next character is taken only after the previous one has been accepted
+                // (a program with the terminal masked polls term_in instead)
+                struct pollfd input = {terminalInputFd, POLLIN, 0};
+                bool previousPending = (interruptRequests & 1 << IVT_ENTRY_TERMINAL) && !(registers[R_INDEX::psw] & INTERRUPT_MASK::tl);
+                if (!previousPending && poll(&input, 1, 0) > 0) {
+                    char character;
+                    if (read(terminalInputFd, &character, 1) == 1) {
+                        writeToMemory(TERM_IN_ADDRESS, WORD, 0xFF & character);
+                        interruptRequests |= 1 << IVT_ENTRY_TERMINAL;
+                    } else terminalInputClosed = true;
+                }
+                if (!terminalInputClosed) scheduleDeviceEvent(DEVICE::terminal_device, event.cycle + TERMINAL_POLL_CYCLES);
+                break;
+            }
+        }
+    }
+
+    /* an unmasked request is accepted (the timer before the terminal) */
+    short pswValue = registers[R_INDEX::psw];
+    int entry = -1;
+    if ((interruptRequests & 1 << IVT_ENTRY_TIMER) && !(pswValue & (INTERRUPT_MASK::i | INTERRUPT_MASK::tr))) {
+        entry = IVT_ENTRY_TIMER;
+        timerInterrupts++;
+    } else if ((interruptRequests & 1 << IVT_ENTRY_TERMINAL) && !(pswValue & (INTERRUPT_MASK::i | INTERRUPT_MASK::tl))) {
+        entry = IVT_ENTRY_TERMINAL;
+        terminalInterrupts++;
+    }
+    if (entry != -1) {
+        // [push pc; push psw; pc <= mem[entry*2]; mask interrupts] - just like the int command
+        interruptRequests &= ~(1 << entry);
+        materializePswFlags();
+        pushOnStack(registers[R_INDEX::pc]);
+        pushOnStack(registers[R_INDEX::psw]);
+        registers[R_INDEX::pc] = readFromMemory(entry * 2, WORD);
+        registers[R_INDEX::psw] |= INTERRUPT_MASK::i;
+        if (callGraphEnabled) callGraphEnter(0xFFFF & registers[R_INDEX::pc], entry);
+    }
+
+    nextEventCycle = deviceEvents.empty() ? ~0ULL : deviceEvents.top().cycle;
+}
+
+void Emulator::requestInterruptCheck() {
+    if (interruptRequests) nextEventCycle = 0; // handleEvents() runs right after the current command
+}
+
+void Emulator::checkIdleLoop(unsigned nextAddress) {
+    unsigned target = 0xFFFF & registers[R_INDEX::pc];
+    if (target >= nextAddress) return; // only backward jumps close a loop
+
+    /* the same state after the same jump - every following iteration repeats this one until memory changes */
+    bool sameState = idleLoop.target == target && idleLoop.memoryWrites == memoryWrites && idleLoop.hostEffects == hostEffects
+        && lazyFlags.pending == idleLoop.lazyFlags.pending && lazyFlags.mnemonic == idleLoop.lazyFlags.mnemonic
+        && lazyFlags.op1 == idleLoop.lazyFlags.op1 && lazyFlags.op2 == idleLoop.lazyFlags.op2 && lazyFlags.result == idleLoop.lazyFlags.result;
+    for (unsigned i = 0; sameState && i < NO_REGISTERS; i++)
+        sameState = registers[i] == idleLoop.registers[i];
+
+    // whole iterations are skipped, so that the event comes in the same command as without skipping
+    unsigned long long length = instructionsRetired - idleLoop.cycle;
+    if (sameState && length > 0 && nextEventCycle != ~0ULL && nextEventCycle > instructionsRetired) {
+        unsigned long long cycles = (nextEventCycle - instructionsRetired - 1) / length * length;
+        instructionsRetired += cycles;
+        skippedCycles += cycles;
+    }
+
+    idleLoop.target = target;
+    idleLoop.cycle = instructionsRetired;
+    idleLoop.memoryWrites = memoryWrites;
+    idleLoop.hostEffects = hostEffects;
+    idleLoop.lazyFlags = lazyFlags;
+    for (unsigned i = 0; i < NO_REGISTERS; i++)
+        idleLoop.registers[i] = registers[i];
+}
+
+void Emulator::invalidateDecodeCache(unsigned address) {
+    // commands are at most 5B long, so only those starting at most 4B before 'address' can contain it
+    for (unsigned i = 0; i < MAX_COMMAND_LENGTH; i++) {
+        unsigned commandAddress = 0xFFFF & (address - i);
+        if (decodeCacheValid[commandAddress] && (unsigned)decodeCache[commandAddress].length > i) {
+            // the entry is the command as it was counted by the profiler
+            if (profilingEnabled) profileFold(commandAddress, decodeCache[commandAddress].mnemonic, decodeCache[commandAddress].addressingMode);
+            decodeCacheValid[commandAddress] = 0;
+            decodeCacheInvalidations++;
+            unfuseCommands(commandAddress);
+        }
+    }
+}
+
+void Emulator::fuseCommands(unsigned address) {
+    CommandData &head = decodeCache[address];
+
+    /* commands of a superinstruction must not change the control flow before its last command or use psw */
+    auto isPush = [](const CommandData &c) {
+        return c.mnemonic == MNEMONIC::str_push && c.updateType == UPDATE_TYPE::pre_decrement && c.addressingMode == ADDRESSING_MODE::regind
+            && c.rDst != R_INDEX::psw && c.rSrc != R_INDEX::psw && c.rSrc != R_INDEX::pc;
+    };
+    auto isLdrImmed = [](const CommandData &c) {
+        return c.mnemonic == MNEMONIC::ldr_pop && c.updateType == UPDATE_TYPE::no_update && c.addressingMode == ADDRESSING_MODE::immed
+            && c.rDst != R_INDEX::psw && c.rDst != R_INDEX::pc;
+    };
+    auto isPop = [](const CommandData &c) {
+        return c.mnemonic == MNEMONIC::ldr_pop && c.updateType == UPDATE_TYPE::post_increment && c.addressingMode == ADDRESSING_MODE::regind
+            && c.rDst != R_INDEX::psw && c.rDst != R_INDEX::pc && c.rSrc != R_INDEX::psw && c.rSrc != R_INDEX::pc;
+    };
+    auto isCall = [](const CommandData &c) {
+        return c.mnemonic == MNEMONIC::call && c.rSrc != R_INDEX::psw;
+    };
+    auto isConditionalJump = [](const CommandData &c) {
+        return (c.mnemonic == MNEMONIC::jeq || c.mnemonic == MNEMONIC::jne || c.mnemonic == MNEMONIC::jgt) && c.rSrc != R_INDEX::psw;
+    };
+
+    bool isFlagProducer = (head.mnemonic == MNEMONIC::cmp || head.mnemonic == MNEMONIC::test) && head.rDst != R_INDEX::psw && head.rSrc != R_INDEX::psw;
+    if (!isLdrImmed(head) && !isPush(head) && !isPop(head) && !isFlagProducer) {
+        head.fusionChecked = true; // this command never starts a superinstruction
+        return;
+    }
+
+    // the following command is only known once it has been executed (and cached) too, so we try again on the next hit
+    unsigned secondAddress = 0xFFFF & (address + head.length);
+    if (!decodeCacheValid[secondAddress]) return;
+    head.fusionChecked = true;
+
+    const CommandData &second = decodeCache[secondAddress];
+    if (isLdrImmed(head) && isPush(second)) {
+        unsigned thirdAddress = 0xFFFF & (secondAddress + second.length);
+        head.fusion = decodeCacheValid[thirdAddress] && isCall(decodeCache[thirdAddress]) ? FUSION::ldr_immed_push_call : FUSION::ldr_immed_push;
+    } else if (isPush(head) && isCall(second))
+        head.fusion = FUSION::push_call;
+    else if (isPop(head) && second.mnemonic == MNEMONIC::ret)
+        head.fusion = FUSION::pop_ret;
+    else if (isFlagProducer && isConditionalJump(second))
+        head.fusion = head.mnemonic == MNEMONIC::cmp ? FUSION::cmp_jcc : FUSION::test_jcc;
+}
+
+void Emulator::unfuseCommands(unsigned address) {
+    // superinstructions have at most 3 commands, so only those starting at most 10B before 'address' can contain it
+    for (unsigned i = 1; i <= 2 * MAX_COMMAND_LENGTH; i++) {
+        unsigned headAddress = 0xFFFF & (address - i);
+        if (decodeCache[headAddress].fusion != FUSION::no_fusion) {
+            decodeCache[headAddress].fusion = FUSION::no_fusion;
+            decodeCache[headAddress].fusionChecked = false;
+        }
+    }
+}
+
+bool Emulator::fetchFusedCommand(unsigned headAddress, unsigned char fusion) {
+    // the previous command may have stored into the superinstruction (see unfuseCommands()), the rest is then fetched as usual
+    if (!decodeCacheValid[headAddress] || decodeCache[headAddress].fusion != fusion) return false;
+
+    // an interrupt may have to be accepted after the previous command
+    if (instructionsRetired >= nextEventCycle) return false;
+
+    cd = decodeCache[0xFFFF & registers[R_INDEX::pc]];
+    registers[R_INDEX::pc] += cd.length;
+    decodeCacheHits++;
+    instructionsRetired++;
+    if (profilingEnabled) profileCommand();
+    if (traceEnabled) traceCommand();
+    return true;
 }
 
 void Emulator::updateSource() {
@@ -504,7 +1842,7 @@ short Emulator::getOperand() {
     case ADDRESSING_MODE::regdir_disp:
         return registers[cd.rSrc] + cd.payload;
     default:
-        emulatingErrors.push_back("Unrecognised addressing mode: " + cd.addressingMode);
+        reportError(ERROR_KIND::execution_error, "Unrecognised addressing mode: " + cd.addressingMode);
         return -1;
     }
 }
@@ -524,7 +1862,7 @@ bool Emulator::setOperand() {
             writeToMemory(0xFFFF & cd.payload, WORD, registers[cd.rDst]);
             break;
         default:
-            emulatingErrors.push_back("Unrecognised or unsuitable addressing mode: " + cd.addressingMode);
+            reportError(ERROR_KIND::execution_error, "Unrecognised or unsuitable addressing mode: " + cd.addressingMode);
             return false;
     }
     return true;
@@ -542,6 +1880,9 @@ short Emulator::popFromStack() {
 }
 
 bool Emulator::evaluateJumpCondition() {
+    if (cd.mnemonic == MNEMONIC::jmp) return true;
+    materializePswFlags();
+
     short condition = registers[R_INDEX::psw] & FLAG_MASK::z; // getting the zero-flag
     switch (cd.mnemonic) {
         case MNEMONIC::jeq:
@@ -556,7 +1897,7 @@ bool Emulator::evaluateJumpCondition() {
     return true; // cd.mnemonic == MNEMONIC::jmp
 }
 
-void Emulator::updatePswFlags(short result) {
+void Emulator::updatePswFlags(short mnemonic, short op1, short op2, short result) {
     /* let's set the z-flag */
     if (result == 0) registers[R_INDEX::psw] |= FLAG_MASK::z;
     else registers[R_INDEX::psw] &= ~FLAG_MASK::z;
@@ -565,37 +1906,27 @@ void Emulator::updatePswFlags(short result) {
     if (result < 0) registers[R_INDEX::psw] |= FLAG_MASK::n;
     else registers[R_INDEX::psw] &= ~FLAG_MASK::n;
 
-    /* setting additional flags according to the command */
-    short op1, op2;
-    switch (cd.mnemonic) {
+    /* setting additional flags according to the command (op1 - rDst value, op2 - rSrc value) */
+    switch (mnemonic) {
         case MNEMONIC::cmp:
             /* let's set the carry-flag (for an expression op1 - op2) */
-            if (registers[cd.rDst] < registers[cd.rSrc])
+            if (op1 < op2)
                 registers[R_INDEX::psw] |= FLAG_MASK::c;
             else registers[R_INDEX::psw] &= ~FLAG_MASK::c;
 
             /* let's set the o-flag (for an expression op1 - op2) */
-            op1 = registers[cd.rDst];
-            op2 = registers[cd.rSrc];
-
             if ((op1 < 0 && op2 > 0 && (op1 - op2) > 0) || (op1 > 0 && op2 < 0 && (op1 - op2) < 0))
                 registers[R_INDEX::psw] |= FLAG_MASK::o;
             else registers[R_INDEX::psw] &= ~FLAG_MASK::o;
             break;
         case MNEMONIC::shl:
             /* let's set the c-flag (for an expression op1 << op2) */
-            op1 = registers[cd.rDst];
-            op2 = registers[cd.rSrc];
-
             // c-flag is set if at op1 << op2 the last shifted bit is 1
             if ((op1 >> (16 - op2)) & 1) registers[R_INDEX::psw] |= FLAG_MASK::c;
             else registers[R_INDEX::psw] &= ~FLAG_MASK::c;
             break;
         case MNEMONIC::shr:
             /* let's set the c-flag (for an expression op1 >> op2) */
-            op1 = registers[cd.rDst];
-            op2 = registers[cd.rSrc];
-
             // c-flag is set if at op1 >> op2 the last shifted bit is 1
             if ((op1 >> (op2 - 1)) & 1) registers[R_INDEX::psw] |= FLAG_MASK::c;
             else registers[R_INDEX::psw] &= ~FLAG_MASK::c;
@@ -603,32 +1934,331 @@ void Emulator::updatePswFlags(short result) {
     }
 }
 
+short Emulator::flagsWrittenBy(short mnemonic) {
+    switch (mnemonic) {
+        case MNEMONIC::cmp:
+            return FLAG_MASK::z | FLAG_MASK::n | FLAG_MASK::c | FLAG_MASK::o;
+        case MNEMONIC::shl: case MNEMONIC::shr:
+            return FLAG_MASK::z | FLAG_MASK::n | FLAG_MASK::c;
+    }
+    return FLAG_MASK::z | FLAG_MASK::n; // test
+}
+
+void Emulator::recordPswFlags(short result) { // called instead of updatePswFlags() by cmp, test, shl and shr
+    if (!lazyFlagsEnabled) {
+        updatePswFlags(cd.mnemonic, registers[cd.rDst], registers[cd.rSrc], result);
+        return;
+    }
+
+    // flags of the pending command that this one leaves unchanged have to reach psw first
+    if (lazyFlags.pending && (flagsWrittenBy(lazyFlags.mnemonic) & ~flagsWrittenBy(cd.mnemonic)))
+        materializePswFlags();
+
+    lazyFlags.pending = true;
+    lazyFlags.mnemonic = cd.mnemonic;
+    lazyFlags.op1 = registers[cd.rDst];
+    lazyFlags.op2 = registers[cd.rSrc];
+    lazyFlags.result = result;
+}
+
+void Emulator::materializePswFlags() {
+    if (!lazyFlags.pending) return;
+
+    lazyFlags.pending = false;
+    updatePswFlags(lazyFlags.mnemonic, lazyFlags.op1, lazyFlags.op2, lazyFlags.result);
+}
+
+/* names of the addressing modes in the profile (the commands are named by isaName()) */
+static const char *addressingModeNames[NO_ADDRESSING_MODES + 1] = {"immed", "regdir", "regind", "regind_disp", "memdir", "regdir_disp", "none"};
+
+/* indices of the nonzero counters, the largest first */
+static vector<unsigned> sortedCounters(const unsigned long long *counters, unsigned nOfCounters) {
+    vector<unsigned> indices;
+    for (unsigned i = 0; i < nOfCounters; i++)
+        if (counters[i] != 0) indices.push_back(i);
+    stable_sort(indices.begin(), indices.end(), [counters](unsigned a, unsigned b) { return counters[a] > counters[b]; });
+    return indices;
+}
+
 /* printing methods */
-bool Emulator::memoryDump() {                  // printing contents of the memory to a file
-    ofstream file; // output text .hex file
+void Emulator::printProfile(ostream &out) {
+    if (profilePcs.empty()) return;
+
+    profileFoldAll();
+
+    unsigned long long profiled = 0, reads = 0, writes = 0;
+    for (unsigned i = 0; i < 256; i++)
+        profiled += profileMnemonics[i];
+    unsigned long long pageAccesses[NO_MEMORY_PAGES];
+    for (unsigned i = 0; i < NO_MEMORY_PAGES; i++) {
+        reads += profilePageReads[i];
+        writes += profilePageWrites[i];
+        pageAccesses[i] = profilePageReads[i] + profilePageWrites[i];
+    }
+    auto percent = [profiled](unsigned long long count) { return profiled ? 100.0 * count / profiled : 0; };
+
+    out << "Profile: instructions=" << profiled << ", memory reads=" << reads << ", memory writes=" << writes << endl;
+    out << fixed << setprecision(1);
+
+    out << "Commands:";
+    for (unsigned i : sortedCounters(profileMnemonics, 256))
+        out << " " << isaName(i) << "=" << profileMnemonics[i] << " (" << percent(profileMnemonics[i]) << "%)";
+    out << endl << "Addressing modes:";
+    for (unsigned i : sortedCounters(profileAddressingModes, NO_ADDRESSING_MODES + 1))
+        out << " " << addressingModeNames[i] << "=" << profileAddressingModes[i];
+    out << endl;
+
+    out << "Hot spots:" << endl;
+    vector<unsigned> pcs = sortedCounters(&profilePcs[0], MEMORY_SIZE);
+    for (unsigned i = 0; i < pcs.size() && i < PROFILE_HOT_SPOTS; i++) {
+        out << "  0x" << hex << setfill('0') << setw(4) << pcs[i] << dec << setfill(' ') << "  " << setw(6) << left << isaName(0xFF & memory[pcs[i]]) << right;
+        out << " " << setw(12) << profilePcs[pcs[i]] << " " << setw(5) << percent(profilePcs[pcs[i]]) << "%" << endl;
+    }
+
+    out << "Memory pages:" << endl;
+    vector<unsigned> pages = sortedCounters(pageAccesses, NO_MEMORY_PAGES);
+    for (unsigned i = 0; i < pages.size() && i < PROFILE_HOT_SPOTS; i++) {
+        out << "  0x" << hex << setfill('0') << setw(4) << pages[i] * MEMORY_PAGE_SIZE << dec << setfill(' ');
+        out << "  reads=" << profilePageReads[pages[i]] << ", writes=" << profilePageWrites[pages[i]] << endl;
+    }
+    out.unsetf(ios::floatfield);
+    out << setprecision(6);
+}
+
+bool Emulator::writeProfileJson(string outputFilePath) {
+    ofstream file(outputFilePath);
+    if (!file.is_open()) {
+        reportError(ERROR_KIND::file_error, outputFilePath + " opening failed.");
+        return false;
+    }
+
+    if (!profilePcs.empty()) profileFoldAll();
+
+    // counters in the order of the report
+    file << "{" << endl << "  \"commands\": {";
+    bool first = true;
+    for (unsigned i : sortedCounters(profileMnemonics, 256)) {
+        file << (first ? "" : ", ") << "\"" << isaName(i) << "\": " << profileMnemonics[i];
+        first = false;
+    }
+    file << "}," << endl << "  \"addressing_modes\": {";
+    first = true;
+    for (unsigned i : sortedCounters(profileAddressingModes, NO_ADDRESSING_MODES + 1)) {
+        file << (first ? "" : ", ") << "\"" << addressingModeNames[i] << "\": " << profileAddressingModes[i];
+        first = false;
+    }
+    file << "}," << endl << "  \"pcs\": [";
+    first = true;
+    if (!profilePcs.empty())
+        for (unsigned i : sortedCounters(&profilePcs[0], MEMORY_SIZE)) {
+            file << (first ? "" : ",") << endl << "    {\"pc\": " << i << ", \"command\": \"" << isaName(0xFF & memory[i]) << "\", \"count\": " << profilePcs[i] << "}";
+            first = false;
+        }
+    file << endl << "  ]," << endl << "  \"pages\": [";
+    first = true;
+    for (unsigned i = 0; i < NO_MEMORY_PAGES; i++) {
+        if (profilePageReads[i] == 0 && profilePageWrites[i] == 0) continue;
+        file << (first ? "" : ",") << endl << "    {\"address\": " << i * MEMORY_PAGE_SIZE << ", \"reads\": " << profilePageReads[i] << ", \"writes\": " << profilePageWrites[i] << "}";
+        first = false;
+    }
+    file << endl << "  ]" << endl << "}" << endl;
+
+    file.close();
+    return true;
+}
+
+bool Emulator::writeTrace(string outputFilePath) {
+    if (tracePending) traceFinish();
+
+    ofstream file(outputFilePath, ios::out | ios::binary);
+    if (!file.is_open()) {
+        reportError(ERROR_KIND::file_error, outputFilePath + " opening failed.");
+        return false;
+    }
+
+    /* header - magic, record size, the number of records and the index of the first one, then the records */
+    unsigned size = traceBuffer.size();
+    unsigned kept = traceRecords < size ? traceRecords : size;
+    unsigned long long firstRecord = traceRecords - kept;
+    unsigned header[2] = {TRACE_FILE_MAGIC, sizeof(TraceRecord)};
+    file.write((char *)header, sizeof(header));
+    file.write((char *)&kept, sizeof(kept));
+    file.write((char *)&firstRecord, sizeof(firstRecord));
+
+    // once the buffer is full, the oldest record is the next one to be overwritten
+    unsigned oldest = traceRecords < size ? 0 : traceNext;
+    if (kept > 0) {
+        file.write((char *)&traceBuffer[oldest], (kept - oldest) * sizeof(TraceRecord));
+        file.write((char *)&traceBuffer[0], oldest * sizeof(TraceRecord));
+    }
+
+    file.close();
+    return true;
+}
+
+bool Emulator::decodeTrace(string traceFilePath, ostream &out) {
+    ifstream file(traceFilePath, ios::binary);
+    unsigned header[2] = {}, kept = 0;
+    unsigned long long firstRecord = 0;
+    file.read((char *)header, sizeof(header));
+    file.read((char *)&kept, sizeof(kept));
+    file.read((char *)&firstRecord, sizeof(firstRecord));
+    if (!file || header[0] != TRACE_FILE_MAGIC || header[1] != sizeof(TraceRecord)) {
+        out << traceFilePath << " is not a trace file." << endl;
+        return false;
+    }
+
+    /* '<index> <pc>: <bytes> <command> [<register>=<value>] [[<address>]=<value>]' for every record */
+    const char *registerNames[NO_REGISTERS] = {"r0", "r1", "r2", "r3", "r4", "r5", "r6", "r7", "psw"};
+    for (unsigned i = 0; i < kept; i++) {
+        TraceRecord record;
+        if (!file.read((char *)&record, sizeof(record)) || record.length == 0 || record.length > MAX_COMMAND_LENGTH) {
+            out << traceFilePath << " ends in record " << i << "." << endl;
+            return false;
+        }
+
+        ostringstream bytes;
+        bytes << hex << setfill('0');
+        for (unsigned j = 0; j < record.length; j++)
+            bytes << setw(2) << (unsigned)record.bytes[j] << " ";
+
+        // the register is shown for the commands that write rDst (jumps, cmp, str and the others only have it as an operand)
+        unsigned char mnemonic = record.bytes[0];
+        bool writesRDst = mnemonic == MNEMONIC::xchg || (mnemonic >= MNEMONIC::add && mnemonic <= MNEMONIC::shr && mnemonic != MNEMONIC::cmp
+            && mnemonic != MNEMONIC::test) || mnemonic == MNEMONIC::ldr_pop;
+
+        ostringstream results;
+        results << hex << setfill('0');
+        if (writesRDst && record.rDst < NO_REGISTERS) results << " " << registerNames[record.rDst] << "=0x" << setw(4) << (0xFFFF & record.rDstValue);
+        if (record.written) results << " [0x" << setw(4) << record.writeAddress << "]=0x" << setw(4) << (0xFFFF & record.writeValue);
+
+        out << setw(10) << firstRecord + i << "  " << hex << setfill('0') << setw(4) << record.pc << dec << setfill(' ') << ": ";
+        string command = isaDisassemble(record.bytes, record.length, record.pc);
+        out << left << setw(16) << bytes.str() << (results.str().empty() ? command : "") << right;
+        if (!results.str().empty()) out << left << setw(24) << command << right << results.str();
+        out << endl;
+    }
+    return true;
+}
+
+bool Emulator::loadSymbolMap(string symbolMapPath) {
+    ifstream file(symbolMapPath);
+    if (!file.is_open()) {
+        reportError(ERROR_KIND::file_error, symbolMapPath + " opening failed.");
+        return false;
+    }
+
+    /* '<address>: <name>' lines written by the linker (the first name of an address is used) */
+    string line;
+    unsigned lineNumber = 0;
+    while (getline(file, line)) {
+        lineNumber++;
+        if (line.empty()) continue;
+
+        char *end;
+        unsigned long address = strtoul(line.c_str(), &end, 16);
+        if (end == line.c_str() || *end != ':' || address > 0xFFFF || line.size() < (unsigned)(end - line.c_str()) + 3) {
+            reportError(ERROR_KIND::file_error, symbolMapPath + ":" + to_string(lineNumber) + ": expected '<address>: <name>'.");
+            return false;
+        }
+        symbols.insert({(unsigned)address, line.substr(end - line.c_str() + 2)});
+    }
+    return true;
+}
+
+bool Emulator::writeCallGraph(string outputFilePath) {
+    ofstream file(outputFilePath);
+    if (!file.is_open()) {
+        reportError(ERROR_KIND::file_error, outputFilePath + " opening failed.");
+        return false;
+    }
+
+    /* folded stacks - 'root;caller;callee cycles' for every call path that was on top of the stack */
+    for (unsigned i = 0; i < callGraphFrames.size(); i++) {
+        if (callGraphFrames[i].cycles == 0) continue;
+
+        vector<unsigned> path = {i};
+        while (path.back() != 0)
+            path.push_back(callGraphFrames[path.back()].parent);
+        for (unsigned j = path.size(); j-- > 0;)
+            file << callGraphFrameName(callGraphFrames[path[j]]) << (j == 0 ? " " : ";");
+        file << callGraphFrames[i].cycles << endl;
+    }
+
+    file.close();
+    return true;
+}
+
+/* text of every byte value - "00 " to "ff " (see memoryDump()) */
+static const struct HexByteTable {
+    char text[256][3];
+    HexByteTable() {
+        const char *digits = "0123456789abcdef";
+        for (unsigned i = 0; i < 256; i++) {
+            text[i][0] = digits[i >> 4];
+            text[i][1] = digits[i & 0xF];
+            text[i][2] = ' ';
+        }
+    }
+} hexBytes;
+
+bool Emulator::memoryDump(string outputFilePath) { // printing contents of the memory to a file
+    if (dumpFormat == DUMP_FORMAT::no_dump) return true;
+
+    ofstream file; // output text .hex file (or the raw memory for bin_dump)
 
     /* file opening */
-    file.open("emulator_out_memory_sample.hex");
+    file.open(outputFilePath, ios::out | ios::binary);
     if (!file.is_open()) {
-        emulatingErrors.push_back("emulator_out_memory_sample.hex opening failed.");
+        reportError(ERROR_KIND::file_error, outputFilePath + " opening failed.");
         return false;
     }
 
-    /* writing into a file */
-    file << "Memory sample:" << endl;
+    if (dumpFormat == DUMP_FORMAT::bin_dump) {
+        file.write(&memory[0], MEMORY_SIZE);
+        file.close();
+        return true;
+    }
 
-    unsigned cnt = 0;
-    file << hex;
-    for (unsigned i = 0; i < memory.size(); i++) {
-        if (cnt % 8 == 0 && cnt != 0)
-            file << "\n";
-        if (cnt % 8 == 0)
-            file << setfill('0') << setw(4) << cnt << ": ";
-        file << setfill('0') << setw(2) << (0xFF & memory[i]) << " ";
+    /* the text is formed in a buffer and written at once */
+    string buffer;
+    buffer.reserve(MEMORY_SIZE / 8 * 31 + 32); // a line per 8 bytes: "0000: " and 8 times "00 "
+    auto appendAddress = [&buffer](unsigned address) {
+        buffer.append(hexBytes.text[0xFF & address >> 8], 2);
+        buffer.append(hexBytes.text[0xFF & address], 2);
+        buffer += ": ";
+    };
+
+    if (dumpFormat == DUMP_FORMAT::diff_dump) {
+        // "<address>: <loaded> -> <current>"
+        buffer += "Memory changes:\n";
+        for (unsigned i = 0; i < MEMORY_SIZE; i++) {
+            if (memory[i] == loadedMemory[i]) continue;
+            appendAddress(i);
+            buffer.append(hexBytes.text[0xFF & loadedMemory[i]], 3);
+            buffer += "-> ";
+            buffer.append(hexBytes.text[0xFF & memory[i]], 2);
+            buffer += "\n";
+        }
+    } else {
+        // lines are separated by a new line (there is none after the last one), sparse_dump leaves out the lines of zeros
+        buffer += "Memory sample:\n";
+        bool first = true;
+        for (unsigned line = 0; line < MEMORY_SIZE; line += 8) {
+            if (dumpFormat == DUMP_FORMAT::sparse_dump) {
+                bool zeros = true;
+                for (unsigned i = line; zeros && i < line + 8; i++) zeros = memory[i] == 0;
+                if (zeros) continue;
+            }
 
-        cnt++;
+            if (!first) buffer += "\n";
+            first = false;
+            appendAddress(line);
+            for (unsigned i = line; i < line + 8; i++)
+                buffer.append(hexBytes.text[0xFF & memory[i]], 3);
+        }
     }
-    file << dec;
+    file.write(buffer.data(), buffer.size());
 
     /* file closing */
     file.close();
@@ -636,12 +2266,16 @@ bool Emulator::memoryDump() {                  // printing contents of the memor
 }
 
 void Emulator::printErrorMessages() {
-    cout << "\n\nEmulating errors:" << endl;
-    for (string e : emulatingErrors)
-        cout << e << endl;
+    if (output == nullptr) return;
+    ostream &out = *output;
+
+    out << "\n\nEmulating errors:" << endl;
+    for (const EmulatorError &e : emulatingErrors)
+        out << e.message << endl;
 
-    cout << "\nUnsuccessful instruction:" << endl;
-    cout << "Instruction at: " << registers[R_INDEX::pc] << endl;
+    materializePswFlags();
+    out << "\nUnsuccessful instruction:" << endl;
+    out << "Instruction at: " << registers[R_INDEX::pc] << endl;
     for (int i = 0; i < registers.size(); i++)
-        cout << "r" << hex << i << " = " << registers[i] << dec << endl;
+        out << "r" << hex << i << " = " << registers[i] << dec << endl;
 }
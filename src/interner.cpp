@@ -0,0 +1,63 @@
+#include <cstring> // memcpy()
+
+#include "../inc/interner.h"
+
+/* constructor */
+StringInterner::StringInterner() : block(nullptr), blockUsed(0), slots(1024, 0) {}
+
+unsigned StringInterner::hash(string_view text) {
+    unsigned hash = 2166136261u; // FNV-1a
+    for (char c : text) hash = (hash ^ (unsigned char)c) * 16777619u;
+    return hash ^ hash >> 16;
+}
+
+unsigned StringInterner::slot(string_view text, unsigned textHash) const {
+    unsigned mask = slots.size() - 1, i = textHash & mask;
+    while (slots[i] != 0 && (hashes[slots[i] - 1] != textHash || strings[slots[i] - 1] != text))
+        i = (i + 1) & mask;
+    return i;
+}
+
+void StringInterner::grow() {
+    slots.assign(slots.size() * 2, 0);
+    unsigned mask = slots.size() - 1;
+    for (unsigned id = 0; id < strings.size(); id++) {
+        unsigned i = hashes[id] & mask;
+        while (slots[i] != 0) i = (i + 1) & mask;
+        slots[i] = id + 1;
+    }
+}
+
+unsigned StringInterner::intern(string_view text) {
+    unsigned textHash = hash(text), i = slot(text, textHash);
+    if (slots[i] != 0) return slots[i] - 1;
+
+    /* a copy in the arena */
+    char *copy;
+    if (text.size() > BLOCK_SIZE) { // a block of its own, the current block stays in use
+        blocks.emplace_back(new char[text.size()]);
+        copy = blocks.back().get();
+    } else {
+        if (block == nullptr || text.size() > BLOCK_SIZE - blockUsed) {
+            blocks.emplace_back(new char[BLOCK_SIZE]);
+            block = blocks.back().get();
+            blockUsed = 0;
+        }
+        copy = block + blockUsed;
+        blockUsed += text.size();
+    }
+    memcpy(copy, text.data(), text.size());
+
+    unsigned id = strings.size();
+    strings.push_back(string_view(copy, text.size()));
+    hashes.push_back(textHash);
+    slots[i] = id + 1;
+
+    if (2 * strings.size() > slots.size()) grow();
+    return id;
+}
+
+unsigned StringInterner::find(string_view text) const {
+    unsigned i = slot(text, hash(text));
+    return slots[i] == 0 ? NONE : slots[i] - 1;
+}
@@ -0,0 +1,577 @@
+#include <cstring>    // memcpy() for the code patching
+#include <algorithm>  // std::fill()
+#include <initializer_list>
+#include <sys/mman.h> // executable code buffer
+
+#include "../inc/emulator.h"
+
+/*
+    JIT engine - basic blocks of the emulated program are translated to x86-64 code
+
+    - a basic block ends with jmp/jeq/jne/jgt/call/ret/iret/int/halt, with a command that writes to pc,
+      or after JIT_MAX_BLOCK_COMMANDS commands
+    - register-to-register arithmetic, ldr/str/push/pop and jumps with a known target are translated directly;
+      every other command is handed over to commandExecute() (e.g. cmp, test, shl, shr, div, int, iret, and
+      commands with pc or psw as an operand, so that the lazily evaluated flags are handled in one place)
+    - exits with a known target are chained: their jump is patched to the translated target block
+    - the code buffer is writable only while a block is translated or an exit is chained, and executable only
+      while translated code runs (W^X, see jitProtect())
+    - a store into translated code drops all translations (see jitFlush())
+    - device events and interrupts are handled by the dispatcher: a block is entered (and continued after a helper
+      call) only while the next event is more than JIT_MAX_BLOCK_COMMANDS cycles away, the commands before the event
+      are interpreted, so events (a run() budget too) happen at the same cycle as in the interpreter
+    - helpers see the cycle of their command in Emulator::instructionsRetired (e.g. a tim_cfg write)
+    - of the idle loops (see checkIdleLoop()) only a jmp to itself is fast-forwarded to the next event
+
+    register usage in the translated code:
+        rbx - Emulator::registers, r12 - Emulator::memory, r13 - Emulator *, r14 - JitContext *
+*/
+
+#if defined(__x86_64__)
+
+/* offsets of the JitContext fields used by the translated code */
+#define JIT_CTX_RETIRED 24
+#define JIT_CTX_NEXT_EVENT 32
+#define JIT_CTX_CHAIN_SITE 40
+#define JIT_CTX_PSW_FLAGS_PENDING 48
+#define JIT_CTX_SKIPPED_CYCLES 56
+#define JIT_CTX_EMULATOR_RETIRED 64
+
+/* the entry trampoline and the common exit occupy the beginning of the code buffer */
+#define JIT_STUBS_SIZE 64
+
+/* return values of the translated code */
+#define JIT_EXIT_CONTINUE 0
+#define JIT_EXIT_HALT 1
+#define JIT_EXIT_ERROR 2
+
+/* x86-64 machine code emitter */
+struct JitEmitter {
+    unsigned char *p;
+
+    void byte(unsigned char b) { *p++ = b; }
+    void bytes(std::initializer_list<unsigned char> bs) { for (unsigned char b : bs) *p++ = b; }
+    void word(unsigned short w) { memcpy(p, &w, 2); p += 2; }
+    void dword(unsigned d) { memcpy(p, &d, 4); p += 4; }
+    void qword(unsigned long long q) { memcpy(p, &q, 8); p += 8; }
+
+    static unsigned char reg(char r) { return 2 * r; } // offset of an emulated register from rbx
+
+    void loadRegister(char r) { bytes({0x0F, 0xB7, 0x43, reg(r)}); }                // movzx eax, word [rbx + r]
+    void loadRegisterEcx(char r) { bytes({0x0F, 0xB7, 0x4B, reg(r)}); }             // movzx ecx, word [rbx + r]
+    void storeRegister(char r) { bytes({0x66, 0x89, 0x43, reg(r)}); }               // mov word [rbx + r], ax
+    void storeRegisterCx(char r) { bytes({0x66, 0x89, 0x4B, reg(r)}); }             // mov word [rbx + r], cx
+    void storeRegisterImmediate(char r, short v) { bytes({0x66, 0xC7, 0x43, reg(r)}); word(v); } // mov word [rbx + r], imm16
+    void addRegisterImmediate(char r, char v) { bytes({0x66, 0x83, 0x43, reg(r), (unsigned char)v}); } // add word [rbx + r], imm8
+    void registerOperation(unsigned char opcode, char r) { bytes({0x66, opcode, 0x43, reg(r)}); } // <op> word [rbx + r], ax
+
+    void addAxImmediate(short v) { byte(0x66); byte(0x05); word(v); } // add ax, imm16
+    void zeroExtendAx() { bytes({0x0F, 0xB7, 0xC0}); }               // movzx eax, ax
+    void loadMemoryAtEax() { bytes({0x41, 0x0F, 0xB7, 0x04, 0x04}); } // movzx eax, word [r12 + rax]
+    void loadMemoryAt(unsigned a) { bytes({0x41, 0x0F, 0xB7, 0x84, 0x24}); dword(a); } // movzx eax, word [r12 + a]
+
+    void call(const void *f) { bytes({0x48, 0xB8}); qword((unsigned long long)f); bytes({0xFF, 0xD0}); } // mov rax, f; call rax
+    void jump(unsigned char *target) { byte(0xE9); dword(target - (p + 4)); }                          // jmp rel32
+
+    /* the emulated address is computed into eax (ax wraps around 0xFFFF like in readFromMemory()) */
+    void operandAddress(char addressingMode, char rSrc, short payload) {
+        switch (addressingMode) {
+            case ADDRESSING_MODE::regind:
+                loadRegister(rSrc); break;
+            case ADDRESSING_MODE::regind_disp:
+                loadRegister(rSrc); addAxImmediate(payload); zeroExtendAx(); break;
+        }
+    }
+
+    /* exits return to the dispatcher, 'retired' commands of the block have been executed */
+    void addRetired(unsigned retired) { bytes({0x49, 0x81, 0x46, JIT_CTX_RETIRED}); dword(retired); } // add qword [r14 + retired], imm32
+    void exitTo(unsigned char *jitExit, unsigned retired, int code) {
+        addRetired(retired);
+        byte(0xB8); dword(code); // mov eax, code
+        jump(jitExit);
+    }
+    void exitAt(unsigned char *jitExit, unsigned retired, unsigned short pc) { // exit with a known pc, but without chaining
+        storeRegisterImmediate(R_INDEX::pc, pc);
+        exitTo(jitExit, retired, JIT_EXIT_CONTINUE);
+    }
+    void chainedExitAt(unsigned char *jitExit, unsigned retired, unsigned short pc) {
+        addRetired(retired);
+        storeRegisterImmediate(R_INDEX::pc, pc);
+
+        // jmp rel32 - leads to the following stub until it gets patched to the translated target block
+        byte(0xE9);
+        unsigned char *site = p;
+        dword(0);
+
+        bytes({0x48, 0x8D, 0x05}); dword(site - (p + 4)); // lea rax, [rip + site]
+        bytes({0x49, 0x89, 0x46, JIT_CTX_CHAIN_SITE});    // mov [r14 + chainSite], rax
+        byte(0xB8); dword(JIT_EXIT_CONTINUE);             // mov eax, JIT_EXIT_CONTINUE
+        jump(jitExit);
+    }
+
+    /* the block exits (with pc already set or set to 'pc') once the next event is JIT_MAX_BLOCK_COMMANDS cycles away */
+    void exitIfEventNear(unsigned char *jitExit, unsigned retired, int pc = -1) {
+        bytes({0x49, 0x8B, 0x46, JIT_CTX_RETIRED});    // mov rax, [r14 + retired]
+        bytes({0x48, 0x05}); dword(retired + JIT_MAX_BLOCK_COMMANDS); // add rax, imm32
+        bytes({0x49, 0x8B, 0x4E, JIT_CTX_NEXT_EVENT}); // mov rcx, [r14 + nextEventCycle]
+        bytes({0x48, 0x3B, 0x01});                     // cmp rax, [rcx]
+        bytes({0x72, 0});                              // jb over the exit
+        unsigned char *skip = p;
+        if (pc >= 0) storeRegisterImmediate(R_INDEX::pc, pc);
+        exitTo(jitExit, retired, JIT_EXIT_CONTINUE);
+        skip[-1] = p - skip;
+    }
+
+    /* Emulator::instructionsRetired is kept only by the dispatcher, a helper gets it counted up to its command */
+    void storeEmulatorRetired(unsigned retired) {
+        bytes({0x49, 0x8B, 0x46, JIT_CTX_RETIRED});          // mov rax, [r14 + retired]
+        bytes({0x48, 0x05}); dword(retired);                 // add rax, imm32
+        bytes({0x49, 0x8B, 0x4E, JIT_CTX_EMULATOR_RETIRED}); // mov rcx, [r14 + emulatorRetired]
+        bytes({0x48, 0x89, 0x01});                           // mov [rcx], rax
+    }
+    void loadEmulatorRetired(unsigned retired) { // after a command that may skip cycles (eax is kept)
+        bytes({0x49, 0x8B, 0x4E, JIT_CTX_EMULATOR_RETIRED}); // mov rcx, [r14 + emulatorRetired]
+        bytes({0x48, 0x8B, 0x09});                           // mov rcx, [rcx]
+        bytes({0x48, 0x81, 0xE9}); dword(retired);           // sub rcx, imm32
+        bytes({0x49, 0x89, 0x4E, JIT_CTX_RETIRED});          // mov [r14 + retired], rcx
+    }
+
+    /* helper results: 0 - continue with the block, otherwise (exit code + 1) */
+    void exitOnHelperResult(unsigned char *jitExit, unsigned retired) {
+        bytes({0x85, 0xC0});      // test eax, eax
+        bytes({0x74, 0});         // jz over the exit
+        unsigned char *skip = p;
+        bytes({0xFF, 0xC8});      // dec eax
+        addRetired(retired);
+        jump(jitExit);
+        skip[-1] = p - skip;
+    }
+};
+
+/* helpers called from the translated code */
+int Emulator::jitExecuteCommand(Emulator *e, unsigned index) { // interpreter fallback for a single command
+    bool running = true;
+
+    e->jitFlushed = false;
+    e->cd = e->jitCommands[index];
+    if (!e->commandExecute(running)) return JIT_EXIT_ERROR + 1;
+    if (!running) return JIT_EXIT_HALT + 1;
+    return e->jitFlushed ? JIT_EXIT_CONTINUE + 1 : 0;
+}
+
+void Emulator::jitMaterializePswFlags(Emulator *e) {
+    e->materializePswFlags();
+}
+
+int Emulator::jitStore(Emulator *e, unsigned address, short value) {
+    e->jitFlushed = false;
+    e->writeToMemory(address, WORD, value);
+    return e->jitFlushed ? JIT_EXIT_CONTINUE + 1 : 0;
+}
+
+/* JIT engine */
+bool Emulator::jitExecute() {
+    /* code buffer with the entry trampoline and the common exit at its beginning */
+    if (jitCode == nullptr) {
+        void *buffer = mmap(nullptr, JIT_CODE_BUFFER_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (buffer == MAP_FAILED) { // the threaded engine takes over if there is no executable memory
+            engine = ENGINE::threaded_engine;
+            return threadedExecute();
+        }
+        jitCode = (unsigned char *)buffer;
+        jitCodeWritable = true;
+
+        JitEmitter e = {jitCode};
+
+        // int jitEnter(JitContext *context, unsigned char *block)
+        jitEnter = e.p;
+        e.bytes({0x53, 0x41, 0x54, 0x41, 0x55, 0x41, 0x56, 0x41, 0x57}); // push rbx, r12, r13, r14, r15
+        e.bytes({0x49, 0x89, 0xFE});                                     // mov r14, rdi
+        e.bytes({0x49, 0x8B, 0x1E});                                     // mov rbx, [r14]
+        e.bytes({0x4D, 0x8B, 0x66, 0x08});                               // mov r12, [r14 + 8]
+        e.bytes({0x4D, 0x8B, 0x6E, 0x10});                               // mov r13, [r14 + 16]
+        e.bytes({0xFF, 0xE6});                                           // jmp rsi
+
+        jitExit = e.p;
+        e.bytes({0x41, 0x5F, 0x41, 0x5E, 0x41, 0x5D, 0x41, 0x5C, 0x5B}); // pop r15, r14, r13, r12, rbx
+        e.byte(0xC3);                                                    // ret
+
+        if (!jitProtect(false)) { // nor if the memory can not be made executable
+            munmap(jitCode, JIT_CODE_BUFFER_SIZE);
+            jitCode = nullptr;
+            engine = ENGINE::threaded_engine;
+            return threadedExecute();
+        }
+
+        jitCodeUsed = JIT_STUBS_SIZE;
+        jitBlocks.assign(MEMORY_SIZE, nullptr);
+        jitCodeBytes.assign(MEMORY_SIZE, 0);
+    }
+
+    JitContext context = {&registers[0], &memory[0], this, instructionsRetired, &nextEventCycle, nullptr, &lazyFlags.pending, &skippedCycles, &instructionsRetired};
+    int (*enter)(JitContext *, unsigned char *) = (int (*)(JitContext *, unsigned char *))jitEnter;
+    unsigned long long flushesBeforeExit = jitFlushes;
+
+    while (true) {
+        /* device events are checked at the entry of every block */
+        instructionsRetired = context.instructionsRetired;
+        if (instructionsRetired >= nextEventCycle) {
+            handleEvents();
+            if (stopRequested) return true;
+        }
+
+        unsigned address = 0xFFFF & registers[R_INDEX::pc];
+        unsigned char *block = jitBlocks[address];
+        if (block == nullptr) block = jitTranslate(address);
+
+        // the interpreter executes (or reports) what can not be translated, and the commands right before an event
+        // (a block could run past it)
+        bool eventNear = nextEventCycle - instructionsRetired <= JIT_MAX_BLOCK_COMMANDS;
+        if (block == nullptr || eventNear) {
+            bool running = true;
+            cd = {};
+            if (!commandFetchAndDecode()) return false;
+            instructionsRetired++; // counted before the execution, like in the switch engine
+            if (!commandExecute(running)) return false;
+            context.instructionsRetired = instructionsRetired;
+            if (!running) break;
+            continue;
+        }
+
+        /* the exit we came from gets to jump straight into this block next time */
+        if (context.chainSite != nullptr && flushesBeforeExit == jitFlushes && jitProtect(true)) {
+            int rel = block - (context.chainSite + 4);
+            memcpy(context.chainSite, &rel, 4);
+        }
+        context.chainSite = nullptr;
+
+        if (!jitProtect(false)) {
+            reportError(ERROR_KIND::execution_error, "The translated code can not be made executable.");
+            return false;
+        }
+        int exitCode = enter(&context, block);
+        flushesBeforeExit = jitFlushes;
+
+        if (exitCode == JIT_EXIT_HALT) {
+            /* 'cd' of halt is expected after the emulation */
+            cd = {};
+            cd.mnemonic = MNEMONIC::halt;
+            break;
+        }
+        if (exitCode == JIT_EXIT_ERROR) {
+            instructionsRetired = context.instructionsRetired;
+            return false;
+        }
+    }
+
+    instructionsRetired = context.instructionsRetired;
+    return true;
+}
+
+unsigned char *Emulator::jitTranslate(unsigned startAddress) {
+    if (!jitProtect(true)) return nullptr; // the block is interpreted
+    if (jitCodeUsed + JIT_MAX_BLOCK_SIZE > JIT_CODE_BUFFER_SIZE) jitFlush();
+
+    JitEmitter e = {jitCode + jitCodeUsed};
+    unsigned char *block = e.p;
+
+    /* the block does nothing once a device event is near (the dispatcher interprets up to it) */
+    e.exitIfEventNear(jitExit, 0);
+    unsigned char *skip;
+
+    unsigned address = startAddress, retired = 0;
+    bool blockEnded = false;
+    while (!blockEnded) {
+        /* decoding without side effects on the emulated state */
+        bool decoded = jitDecode(address);
+        unsigned short nextAddress = address + cd.length;
+
+        if (!decoded) { // it is up to the interpreter to report the error if the command is ever reached
+            if (retired == 0) return nullptr;
+            e.chainedExitAt(jitExit, retired, address);
+            break;
+        }
+        retired++;
+
+        /* commands that use pc or psw as an operand (or change them) are left to the interpreter */
+        bool usesPc = cd.rDst == R_INDEX::pc || cd.rSrc == R_INDEX::pc || cd.rDst == R_INDEX::psw || cd.rSrc == R_INDEX::psw;
+        bool noUpdate = cd.updateType == UPDATE_TYPE::no_update;
+        bool isPop = cd.updateType == UPDATE_TYPE::post_increment && cd.addressingMode == ADDRESSING_MODE::regind;
+        bool isPush = cd.updateType == UPDATE_TYPE::pre_decrement && cd.addressingMode == ADDRESSING_MODE::regind;
+        bool knownTarget = cd.addressingMode == ADDRESSING_MODE::immed || (cd.addressingMode == ADDRESSING_MODE::regdir_disp && cd.rSrc == R_INDEX::pc);
+        unsigned short target = cd.addressingMode == ADDRESSING_MODE::immed ? cd.payload : nextAddress + cd.payload;
+
+        bool translated = true;
+        switch (cd.mnemonic) {
+            case MNEMONIC::halt:
+                e.storeRegisterImmediate(R_INDEX::pc, nextAddress);
+                e.exitTo(jitExit, retired, JIT_EXIT_HALT);
+                blockEnded = true;
+                break;
+            case MNEMONIC::jmp:
+                if (!knownTarget) { translated = false; break; }
+
+                if (target == startAddress && retired == 1 && idleLoopSkipEnabled) {
+                    // jmp to itself - the cycles up to the one before the next event pass at once (the block entry ensures retired < next)
+                    e.bytes({0x49, 0x8B, 0x4E, JIT_CTX_NEXT_EVENT});     // mov rcx, [r14 + nextEventCycle]
+                    e.bytes({0x48, 0x8B, 0x01});                         // mov rax, [rcx]
+                    e.bytes({0x48, 0x83, 0xF8, 0xFF, 0x74, 0});          // cmp rax, -1; je over the skip (no events at all)
+                    skip = e.p;
+                    e.bytes({0x48, 0xFF, 0xC8});                         // dec rax
+                    e.bytes({0x48, 0x89, 0xC2});                         // mov rdx, rax
+                    e.bytes({0x49, 0x2B, 0x56, JIT_CTX_RETIRED});        // sub rdx, [r14 + retired]
+                    e.bytes({0x49, 0x89, 0x46, JIT_CTX_RETIRED});        // mov [r14 + retired], rax
+                    e.bytes({0x49, 0x8B, 0x4E, JIT_CTX_SKIPPED_CYCLES}); // mov rcx, [r14 + skippedCycles]
+                    e.bytes({0x48, 0x01, 0x11});                         // add [rcx], rdx
+                    skip[-1] = e.p - skip;
+                }
+                e.chainedExitAt(jitExit, retired, target);
+                blockEnded = true;
+                break;
+            case MNEMONIC::jeq: case MNEMONIC::jne: case MNEMONIC::jgt: {
+                if (!knownTarget) { translated = false; break; }
+
+                // flags recorded by the last flag-producing command have to reach psw first
+                e.bytes({0x49, 0x8B, 0x46, JIT_CTX_PSW_FLAGS_PENDING}); // mov rax, [r14 + pswFlagsPending]
+                e.bytes({0x80, 0x38, 0x00, 0x74, 0});                   // cmp byte [rax], 0; je over the call
+                skip = e.p;
+                e.bytes({0x4C, 0x89, 0xEF});                            // mov rdi, r13
+                e.call((const void *)&Emulator::jitMaterializePswFlags);
+                skip[-1] = e.p - skip;
+
+                // test word [rbx + psw], mask (the same flags as in evaluateJumpCondition())
+                e.bytes({0x66, 0xF7, 0x43, JitEmitter::reg(R_INDEX::psw)});
+                e.word(cd.mnemonic == MNEMONIC::jgt ? (FLAG_MASK::z | FLAG_MASK::o | FLAG_MASK::n) : FLAG_MASK::z);
+
+                e.bytes({0x0F, (unsigned char)(cd.mnemonic == MNEMONIC::jeq ? 0x85 : 0x84)}); // jnz/jz rel32 to the taken exit
+                unsigned char *taken = e.p;
+                e.dword(0);
+
+                e.chainedExitAt(jitExit, retired, nextAddress);
+                int rel = e.p - (taken + 4);
+                memcpy(taken, &rel, 4);
+                e.chainedExitAt(jitExit, retired, target);
+                blockEnded = true;
+                break;
+            }
+            case MNEMONIC::call:
+                if (!knownTarget) { translated = false; break; }
+
+                // [push pc; pc <= operand]
+                e.addRegisterImmediate(R_INDEX::sp, -2);
+                e.bytes({0x0F, 0xB7, 0x73, JitEmitter::reg(R_INDEX::sp)}); // movzx esi, word [rbx + sp]
+                e.byte(0xBA); e.dword(nextAddress);                         // mov edx, pc
+                e.storeEmulatorRetired(retired);
+                e.bytes({0x4C, 0x89, 0xEF});                                // mov rdi, r13
+                e.call((const void *)&Emulator::jitStore);
+                e.bytes({0x85, 0xC0, 0x74, 0});                             // test eax, eax; jz over the exit
+                skip = e.p;
+                e.exitAt(jitExit, retired, target);
+                skip[-1] = e.p - skip;
+
+                e.chainedExitAt(jitExit, retired, target);
+                blockEnded = true;
+                break;
+            case MNEMONIC::ret:
+                // [pop pc]
+                e.loadRegister(R_INDEX::sp);
+                e.loadMemoryAtEax();
+                e.storeRegister(R_INDEX::pc);
+                e.addRegisterImmediate(R_INDEX::sp, 2);
+                e.exitTo(jitExit, retired, JIT_EXIT_CONTINUE);
+                blockEnded = true;
+                break;
+            case MNEMONIC::xchg:
+                if (usesPc) { translated = false; break; }
+                e.loadRegister(cd.rDst);
+                e.loadRegisterEcx(cd.rSrc);
+                e.storeRegisterCx(cd.rDst);
+                e.storeRegister(cd.rSrc);
+                break;
+            case MNEMONIC::add: case MNEMONIC::sub: case MNEMONIC::_and: case MNEMONIC::_or: case MNEMONIC::_xor: {
+                if (usesPc) { translated = false; break; }
+                unsigned char opcode = 0x01; // add
+                if (cd.mnemonic == MNEMONIC::sub) opcode = 0x29;
+                else if (cd.mnemonic == MNEMONIC::_and) opcode = 0x21;
+                else if (cd.mnemonic == MNEMONIC::_or) opcode = 0x09;
+                else if (cd.mnemonic == MNEMONIC::_xor) opcode = 0x31;
+
+                e.loadRegister(cd.rSrc);
+                e.registerOperation(opcode, cd.rDst);
+                break;
+            }
+            case MNEMONIC::mul:
+                if (usesPc) { translated = false; break; }
+                e.loadRegister(cd.rDst);
+                e.bytes({0x66, 0x0F, 0xAF, 0x43, JitEmitter::reg(cd.rSrc)}); // imul ax, word [rbx + rSrc]
+                e.storeRegister(cd.rDst);
+                break;
+            case MNEMONIC::_not:
+                if (usesPc) { translated = false; break; }
+                e.bytes({0x66, 0xF7, 0x53, JitEmitter::reg(cd.rDst)}); // not word [rbx + rDst]
+                break;
+            case MNEMONIC::ldr_pop:
+                if (usesPc || !(noUpdate || isPop)) { translated = false; break; }
+
+                // [rDst <= operand]
+                switch (cd.addressingMode) {
+                    case ADDRESSING_MODE::immed:
+                        e.storeRegisterImmediate(cd.rDst, cd.payload);
+                        break;
+                    case ADDRESSING_MODE::regdir:
+                        e.loadRegister(cd.rSrc);
+                        e.storeRegister(cd.rDst);
+                        break;
+                    case ADDRESSING_MODE::regind: case ADDRESSING_MODE::regind_disp:
+                        e.operandAddress(cd.addressingMode, cd.rSrc, cd.payload);
+                        e.loadMemoryAtEax();
+                        e.storeRegister(cd.rDst);
+                        break;
+                    case ADDRESSING_MODE::memdir:
+                        e.loadMemoryAt(0xFFFF & cd.payload);
+                        e.storeRegister(cd.rDst);
+                        break;
+                    default:
+                        translated = false;
+                }
+                if (translated && isPop) e.addRegisterImmediate(cd.rSrc, 2);
+                break;
+            case MNEMONIC::str_push:
+                if (usesPc || !(noUpdate || isPush)) { translated = false; break; }
+
+                // [operand <= rDst]
+                if (cd.addressingMode == ADDRESSING_MODE::regdir) {
+                    e.loadRegister(cd.rDst);
+                    e.storeRegister(cd.rSrc);
+                    break;
+                }
+                if (isPush) e.addRegisterImmediate(cd.rSrc, -2);
+
+                if (cd.addressingMode == ADDRESSING_MODE::memdir) {
+                    e.byte(0xBE); e.dword(0xFFFF & cd.payload); // mov esi, address
+                } else {
+                    e.operandAddress(cd.addressingMode, cd.rSrc, cd.payload);
+                    e.bytes({0x89, 0xC6}); // mov esi, eax
+                }
+                e.bytes({0x0F, 0xBF, 0x53, JitEmitter::reg(cd.rDst)}); // movsx edx, word [rbx + rDst]
+                e.storeEmulatorRetired(retired);
+                e.bytes({0x4C, 0x89, 0xEF});                           // mov rdi, r13
+                e.call((const void *)&Emulator::jitStore);
+                e.bytes({0x85, 0xC0, 0x74, 0});                        // test eax, eax; jz over the exit
+                skip = e.p;
+                e.exitAt(jitExit, retired, nextAddress);               // the store hit translated code
+                skip[-1] = e.p - skip;
+                e.exitIfEventNear(jitExit, retired, nextAddress);      // e.g. the timer has been started
+                break;
+            default:
+                translated = false;
+        }
+
+        if (!translated) {
+            /* the interpreter executes the command with pc set just like after its fetch */
+            jitCommands.push_back(cd);
+
+            e.storeRegisterImmediate(R_INDEX::pc, nextAddress);
+            e.storeEmulatorRetired(retired);
+            e.bytes({0x4C, 0x89, 0xEF});                  // mov rdi, r13
+            e.byte(0xBE); e.dword(jitCommands.size() - 1); // mov esi, index
+            e.call((const void *)&Emulator::jitExecuteCommand);
+            e.loadEmulatorRetired(retired);
+            e.exitOnHelperResult(jitExit, retired);
+
+            /* the command may have changed pc */
+            bool writesPc = (cd.mnemonic != MNEMONIC::cmp && cd.mnemonic != MNEMONIC::test && cd.rDst == R_INDEX::pc)
+                || (cd.mnemonic == MNEMONIC::xchg && cd.rSrc == R_INDEX::pc)
+                || (cd.mnemonic == MNEMONIC::str_push && cd.addressingMode == ADDRESSING_MODE::regdir && cd.rSrc == R_INDEX::pc)
+                || ((cd.mnemonic == MNEMONIC::ldr_pop || cd.mnemonic == MNEMONIC::str_push) && !noUpdate && cd.rSrc == R_INDEX::pc);
+            bool isBranch = cd.mnemonic == MNEMONIC::_int || cd.mnemonic == MNEMONIC::iret || cd.mnemonic == MNEMONIC::call
+                || cd.mnemonic == MNEMONIC::jmp || cd.mnemonic == MNEMONIC::jeq || cd.mnemonic == MNEMONIC::jne || cd.mnemonic == MNEMONIC::jgt;
+
+            if (writesPc || isBranch) {
+                e.exitTo(jitExit, retired, JIT_EXIT_CONTINUE);
+                blockEnded = true;
+            } else e.exitIfEventNear(jitExit, retired); // e.g. psw has unmasked an interrupt request
+        }
+
+        if (!blockEnded && retired == JIT_MAX_BLOCK_COMMANDS) {
+            e.chainedExitAt(jitExit, retired, nextAddress);
+            blockEnded = true;
+        }
+        address = nextAddress;
+    }
+
+    /* the block is registered together with the memory it covers */
+    for (unsigned i = startAddress; i != address; i = 0xFFFF & (i + 1))
+        jitCodeBytes[i] = 1;
+    jitBlocks[startAddress] = block;
+    jitBlockStarts.push_back(startAddress);
+
+    jitCodeUsed = e.p - jitCode;
+    jitTranslations++;
+    return block;
+}
+
+bool Emulator::jitDecode(unsigned address) {
+    // the bytes are read in place (not through the bus or the decode cache), with the checks of commandFetchAndDecode()
+    auto byteAt = [this, address](unsigned offset) { return 0xFF & memory[0xFFFF & (address + offset)]; };
+    cd = {};
+
+    const InstructionInfo *instruction = isaDecode(byteAt(0));
+    if (instruction == nullptr) return false;
+    cd.mnemonic = instruction->code;
+    cd.length = instruction->length;
+    if (instruction->operands == operands_none) return true;
+
+    cd.rDst = byteAt(1) >> 4;
+    cd.rSrc = 0x0F & byteAt(1);
+    if (!isaValidRegisters(*instruction, cd.rDst, cd.rSrc)) return false;
+    if (instruction->length == 2) return true;
+
+    cd.updateType = byteAt(2) >> 4;
+    cd.addressingMode = 0x0F & byteAt(2);
+    if (!isaValidAddressingMode(*instruction, cd.addressingMode) || !isaValidUpdateType(*instruction, cd.updateType)) return false;
+    if (isaHasPayload(cd.addressingMode)) {
+        cd.payload = byteAt(3) << 8 | byteAt(4); // big endian
+        cd.length = MAX_COMMAND_LENGTH;
+    }
+    return true;
+}
+
+void Emulator::jitFlush() {
+    for (unsigned startAddress : jitBlockStarts)
+        jitBlocks[startAddress] = nullptr;
+    jitBlockStarts.clear();
+    fill(jitCodeBytes.begin(), jitCodeBytes.end(), 0);
+
+    // the code of a running block stays intact (it only returns to the dispatcher) until the next translation
+    jitCodeUsed = JIT_STUBS_SIZE;
+    jitCommands.clear();
+
+    jitFlushed = true;
+    jitFlushes++;
+}
+
+bool Emulator::jitProtect(bool writable) {
+    // a switch costs a system call, so it happens only on the way between translating and running
+    if (jitCodeWritable == writable) return true;
+    if (mprotect(jitCode, JIT_CODE_BUFFER_SIZE, writable ? PROT_READ | PROT_WRITE : PROT_READ | PROT_EXEC) != 0) return false;
+    jitCodeWritable = writable;
+    return true;
+}
+
+#else
+
+/* hosts other than x86-64 use the threaded engine instead */
+bool Emulator::jitExecute() {
+    engine = ENGINE::threaded_engine;
+    return threadedExecute();
+}
+
+unsigned char *Emulator::jitTranslate(unsigned) { return nullptr; }
+bool Emulator::jitDecode(unsigned) { return false; }
+void Emulator::jitFlush() {}
+bool Emulator::jitProtect(bool) { return false; }
+int Emulator::jitExecuteCommand(Emulator *, unsigned) { return 0; }
+int Emulator::jitStore(Emulator *, unsigned, short) { return 0; }
+
+#endif
@@ -0,0 +1,146 @@
+#include <cstring>
+
+#include "../inc/lexer.h"
+
+/* character classes of the tokens ('C' locale) */
+static bool isLetter(char c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'); }
+static bool isDigit(char c) { return c >= '0' && c <= '9'; }
+static bool isHexDigit(char c) { return isDigit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F'); }
+static bool isSymbolCharacter(char c) { return isLetter(c) || isDigit(c) || c == '_'; }
+
+void Lexer::clearLine(string_view inputLine, string &line) {
+    /* a comment runs from the first '#' to a line terminator (a '\r' of a CRLF file stays in the line) */
+    size_t commentStart = inputLine.find('#'), commentEnd = inputLine.size();
+    if (commentStart == string_view::npos) commentStart = inputLine.size();
+    else commentEnd = min(inputLine.find_first_of("\r\n", commentStart), inputLine.size());
+
+    /* tabs become spaces and a run of spaces becomes a single space */
+    line.clear(); // the capacity is kept from line to line
+    for (size_t i = 0; i < inputLine.size(); i++) {
+        if (i == commentStart) i = commentEnd;
+        if (i == inputLine.size()) break;
+
+        char c = inputLine[i] == '\t' ? ' ' : inputLine[i];
+        if (c != ' ' || line.empty() || line.back() != ' ') line.push_back(c);
+    }
+
+    /* the spaces at both ends are removed from a line of at least two characters (without a line terminator inside) */
+    size_t first = line.size() > 0 && line.front() == ' ' ? 1 : 0;
+    size_t last = line.size() > first && line.back() == ' ' ? line.size() - 1 : line.size();
+    if (last >= first + 2 && line.find_first_of("\r\n", first + 1) >= last - 1) {
+        line.resize(last);
+        line.erase(0, first);
+    }
+
+    /* '... , ...' -> '...,...' and '... : ...' -> '...:...' (in place, the line only gets shorter) */
+    size_t length = 0;
+    for (size_t i = 0; i < line.size(); i++) {
+        bool separator = line[i] == ',' || line[i] == ':';
+        if (line[i] == ' ' && i + 1 < line.size() && (line[i + 1] == ',' || line[i + 1] == ':')) continue;
+        line[length++] = line[i];
+        if (separator && i + 1 < line.size() && line[i + 1] == ' ') i++;
+    }
+    line.resize(length);
+}
+
+bool Lexer::isSymbol(string_view text) {
+    if (text.empty() || !isLetter(text[0])) return false;
+    for (char c : text)
+        if (!isSymbolCharacter(c)) return false;
+    return true;
+}
+
+void Lexer::tokenize(string_view inputLine) {
+    line = inputLine;
+    tokens.clear();
+    next = 0;
+
+    unsigned i = 0, size = line.size();
+    while (i < size) {
+        Token token = {token_other, i, 1};
+        char c = line[i];
+
+        if (isLetter(c)) { // symbol (registers and mnemonics are symbols as well)
+            token.type = token_symbol;
+            while (i + token.length < size && isSymbolCharacter(line[i + token.length])) token.length++;
+        } else if (isDigit(c) || (c == '-' && i + 1 < size && isDigit(line[i + 1]))) { // literal
+            token.type = token_literal;
+            if (c == '0' && i + 2 < size && (line[i + 1] == 'x' || line[i + 1] == 'X') && isHexDigit(line[i + 2])) {
+                token.length = 3;
+                while (i + token.length < size && isHexDigit(line[i + token.length])) token.length++;
+            } else
+                while (i + token.length < size && isDigit(line[i + token.length])) token.length++;
+        } else if (c == ' ')
+            token.type = token_space;
+        else if (c != '\0' && strchr(".,:$%*[]+-", c))
+            token.type = token_punctuator;
+
+        tokens.push_back(token);
+        i += token.length;
+    }
+    tokens.push_back({token_end, size, 0});
+}
+
+string_view Lexer::text(const Token &token) {
+    return line.substr(token.start, token.length);
+}
+
+string_view Lexer::rest() {
+    return line.substr(tokens[next].start);
+}
+
+/* matching methods */
+bool Lexer::is(TOKEN_TYPE type, const char *expected) {
+    const Token &token = tokens[next];
+    if (token.type != type) return false;
+    return expected == nullptr || (strlen(expected) == token.length && line.compare(token.start, token.length, expected) == 0);
+}
+
+bool Lexer::end() {
+    return is(token_end);
+}
+
+bool Lexer::space() {
+    if (!is(token_space)) return false;
+    next++;
+    return true;
+}
+
+bool Lexer::punctuator(char expected) {
+    if (tokens[next].type != token_punctuator || line[tokens[next].start] != expected) return false;
+    next++;
+    return true;
+}
+
+bool Lexer::keyword(const char *expected) {
+    if (!is(token_symbol, expected)) return false;
+    next++;
+    return true;
+}
+
+bool Lexer::symbol(string_view &value) {
+    if (!is(token_symbol)) return false;
+    value = text(tokens[next++]);
+    return true;
+}
+
+bool Lexer::literal(string_view &value) {
+    if (!is(token_literal)) return false;
+    value = text(tokens[next++]);
+    return true;
+}
+
+bool Lexer::literalOrSymbol(string_view &value) {
+    return literal(value) || symbol(value);
+}
+
+bool Lexer::reg(char &index) {
+    const Token &token = tokens[next];
+    if (is(token_symbol, "psw")) index = 8;
+    else if (token.type == token_symbol && token.length == 2 && line[token.start] == 'r' && line[token.start + 1] >= '0' && line[token.start + 1] <= '7')
+        index = line[token.start + 1] - '0'; // 'rX' -> X
+    else return false;
+
+    next++;
+    return true;
+}
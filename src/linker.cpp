@@ -4,10 +4,11 @@
 #include <regex>
 
 #include "../inc/linker.h"
+#include "../inc/image.h" // FLAT_IMAGE_MAGIC
 
 /* main program */
 int main(int argc, const char *argv[]) {
-    // expected format: './linker -hex/-relocatable <-place=<section>@address> -o <output_file> <input_files>'
+    // expected format: './linker -hex/-relocatable <-place=<section>@address> <-map=<map_file>> <-flat=<image_file>> -o <output_file> <input_files>'
     // -relocatable & -place are not implemented
     if (argc < 2) {
         cout << "Files paths are not specified." << endl;
@@ -18,6 +19,8 @@ int main(int argc, const char *argv[]) {
     regex placeOptionRegex("^-place=([a-zA-Z_][a-zA-Z_0-9]*)@(0[xX][0-9A-Fa-f]+)$");
     bool dashOFound = false, hexOutput = false;
     string outputFilePath = "linker_output_generic.o";
+    string mapFilePath = ""; // no symbol map by default
+    string flatFilePath = ""; // no flat image by default
 
     smatch matchedPlaceOptionParts;
     vector<string> inputFiles; // input files paths
@@ -33,7 +36,9 @@ int main(int argc, const char *argv[]) {
         else if (currentArgument == "-relocatable") {
             cout << "-relocatable is not implemented." << endl;
             return -1;
-        } else if (regex_search(currentArgument, matchedPlaceOptionParts, placeOptionRegex)) {
+        } else if (currentArgument.rfind("-map=", 0) == 0) mapFilePath = currentArgument.substr(5);
+        else if (currentArgument.rfind("-flat=", 0) == 0) flatFilePath = currentArgument.substr(6);
+        else if (regex_search(currentArgument, matchedPlaceOptionParts, placeOptionRegex)) {
             cout << "-place is not implemented." << endl;
             return -1;
         } else if (dashOFound) { // output file path
@@ -53,7 +58,7 @@ int main(int argc, const char *argv[]) {
     }
 
     /* linker object creation and linking */
-    Linker linker(inputFiles, outputFilePath);
+    Linker linker(inputFiles, outputFilePath, mapFilePath, flatFilePath);
 
     if (!linker.link()) {
         linker.printErrorMessages();
@@ -63,7 +68,8 @@ int main(int argc, const char *argv[]) {
 }
 
 /* constructor */
-Linker::Linker(vector<string> inputFiles, string outputPath) : outputFilePath(outputPath), inputFilesPaths(inputFiles) {}
+Linker::Linker(vector<string> inputFiles, string outputPath, string mapPath, string flatPath) :
+    inputFilesPaths(inputFiles), outputFilePath(outputPath), mapFilePath(mapPath), flatFilePath(flatPath) {}
 
 /* link() and methods called by it */
 bool Linker::link() {
@@ -75,6 +81,8 @@ bool Linker::link() {
 
     /* output files creation */
     if (!writeHexFile() || !writeBinaryFile()) return false;
+    if (mapFilePath != "" && !writeMapFile()) return false;
+    if (flatFilePath != "" && !writeFlatFile()) return false;
     return true;
 }
 
@@ -298,7 +306,7 @@ bool Linker::setSectionsBaseAddress() {
         /* let's define the position of the section in the output file */
         section.baseAddress = currentSectionVA;
         currentSectionVA += section.length;
-        if (section.baseAddress >= 0xFF00 && section.baseAddress <= 0xFFFF) { // [0xFF00, 0xFFFF] - for MMAP registers
+        if (currentSectionVA > 0xFF00) { // [0xFF00, 0xFFFF] - for MMAP registers (checked before any output file is written)
             linkingErrors.push_back("Section " + section.name + " overlaps with memory reserved for registers.");
             return false;
         }
@@ -400,7 +408,7 @@ void Linker::resolveRelocations() {
         char lByte = sectionTable[relocationTable[i].section].sectionData[relocationTable[i].offset];                             // lower byte
         char hByte = sectionTable[relocationTable[i].section].sectionData[relocationTable[i].offset + (isLittleEndian ? 1 : -1)]; // higher byte
 
-        int finalValue = ((int)lByte | hByte << 8) + patchingPlaceAddition - patchingPlaceAddress;
+        int finalValue = ((0xFF & lByte) | hByte << 8) + patchingPlaceAddition - patchingPlaceAddress;
 
         sectionTable[relocationTable[i].section].sectionData[relocationTable[i].offset] = 0xFF & finalValue;                                    // lower byte
         sectionTable[relocationTable[i].section].sectionData[relocationTable[i].offset + (isLittleEndian ? 1 : -1)] = 0xFF & (finalValue >> 8); // higher byte
@@ -494,6 +502,64 @@ bool Linker::writeBinaryFile() {
     return true; // everything went well
 }
 
+bool Linker::writeMapFile() {
+    ofstream file; // output text symbol map (e.g. for the call graph of the emulator)
+
+    /* file opening */
+    file.open(mapFilePath);
+    if (!file.is_open()) {
+        linkingErrors.push_back(mapFilePath + " opening failed.");
+        return false;
+    }
+
+    // only labels have an address, so sections and symbols of the 'ABS' section (constants) are left out
+    multimap<unsigned, string> symbolsByAddress; // map by default sorts elements by the integer key in the ascending order
+    for (auto item = symbolTable.begin(); item != symbolTable.end(); item++) {
+        SymbolTableRecord &symbol = item->second;
+        if (!symbol.isDefined || symbol.name == symbol.section || symbol.section == "ABS") continue;
+        symbolsByAddress.insert({0xFFFF & symbol.offset, symbol.name});
+    }
+
+    /* writing to the 'file' - one '<address>: <name>' line per symbol */
+    file << hex;
+    for (auto item = symbolsByAddress.begin(); item != symbolsByAddress.end(); item++)
+        file << setfill('0') << setw(4) << item->first << ": " << item->second << "\n";
+    file << dec;
+
+    /* file closing */
+    file.close();
+    return true; // everything went well
+}
+
+bool Linker::writeFlatFile() {
+    ofstream file; // output binary memory image (loaded by the emulator without parsing)
+
+    // every section ends below the memory reserved for registers (see setSectionsBaseAddress())
+
+    /* file opening */
+    file.open(flatFilePath, ios::out | ios::binary);
+    if (!file.is_open()) {
+        linkingErrors.push_back(flatFilePath + " opening failed.");
+        return false;
+    }
+
+    /* every section at its base address, the rest of the 64KB address space (including the registers) is zero */
+    file.write(FLAT_IMAGE_MAGIC, FLAT_IMAGE_MAGIC_SIZE); // the emulator tells it from a linked image by the magic
+    vector<char> image(1 << 16);
+    for (auto item = sectionTable.begin(); item != sectionTable.end(); item++) {
+        SectionTableRecord &section = item->second;
+        if (section.name == "UNDEF" || section.name == "ABS") continue;
+
+        for (size_t i = 0; i < section.sectionData.size(); i++)
+            image[section.baseAddress + i] = section.sectionData[i];
+    }
+    file.write(&image[0], image.size());
+
+    /* file closing */
+    file.close();
+    return true; // everything went well
+}
+
 /* printing methods */
 void Linker::printErrorMessages() {
     cout << "\n\nLinking errors:" << endl;
@@ -0,0 +1,478 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm> // std::fill()
+#include <cstdlib>   // strtol()
+
+#include "../inc/lockstep.h"
+
+/* names of the registers in an inputs file (R_INDEX order) */
+static const char *registerNames[NO_REGISTERS] = {"r0", "r1", "r2", "r3", "r4", "r5", "r6", "r7", "psw"};
+
+/* vector helpers (vectors are passed by reference, there is no AVX-512 calling convention for them) */
+static void assignLanes(LaneVector &destination, const LaneVector &value, const LaneVector &mask) { // 'value' in the lanes of the mask
+    destination = (value & mask) | (destination & ~mask);
+}
+
+static bool anyLane(const LaneVector &v) {
+    for (unsigned i = 0; i < LOCKSTEP_MAX_LANES; i++)
+        if (v[i]) return true;
+    return false;
+}
+
+/* constructor */
+LockstepRunner::LockstepRunner(string programPath, string inputs, unsigned lanesInGroup, function<void(Emulator &)> configureEmulator) :
+    inputFilePath(programPath), inputsPath(inputs), nOfLanes(min(max(lanesInGroup, 1u), (unsigned)LOCKSTEP_MAX_LANES)), configure(configureEmulator),
+    registerFile(), activeLanes(), peeled(), groupFirstInstance(0), groupCycle(0), groupNextEventCycle(0),
+    groupCommands(0), vectorCommands(0), laneCommands(0), peeledLanes(0) {}
+
+/* run() and methods called by it */
+bool LockstepRunner::run() {
+    if (!readInputs()) return false;
+
+    for (unsigned first = 0; first < instances.size(); first += nOfLanes)
+        runGroup(first);
+    return true;
+}
+
+bool LockstepRunner::readInputs() {
+    ifstream file; // input text file
+    string line;
+
+    /* file opening */
+    file.open(inputsPath);
+    if (!file.is_open()) {
+        lockstepErrors.push_back(inputsPath + " opening failed.");
+        return false;
+    }
+
+    for (unsigned lineNumber = 1; getline(file, line); lineNumber++) {
+        if (line.find('#') != string::npos) line = line.substr(0, line.find('#')); // comments
+
+        istringstream items(line);
+        string item;
+        if (!(items >> item)) continue; // an empty line
+
+        Instance instance = {};
+        do {
+            size_t equals = item.find('=');
+            string name = equals == string::npos ? "" : item.substr(0, equals);
+            string value = equals == string::npos ? "" : item.substr(equals + 1);
+            if (name == "sp") name = "r6";
+            if (name == "pc") name = "r7";
+
+            char *end;
+            long number = strtol(value.c_str(), &end, 0);
+            bool correct = !value.empty() && *end == '\0' && number >= -0x8000 && number <= 0xFFFF;
+
+            int index = find(registerNames, registerNames + NO_REGISTERS, name) - registerNames;
+            if (correct && index < NO_REGISTERS) {
+                instance.registerInputs.push_back({index, (short)number});
+                continue;
+            }
+
+            long address = strtol(name.c_str(), &end, 0); // a memory word
+            if (correct && !name.empty() && *end == '\0' && address >= 0 && address <= 0xFFFF) {
+                instance.memoryInputs.push_back({(unsigned)address, (short)number});
+                continue;
+            }
+
+            lockstepErrors.push_back(inputsPath + ":" + to_string(lineNumber) + ": wrong input '" + item + "'.");
+            return false;
+        } while (items >> item);
+        instances.push_back(instance);
+    }
+
+    /* file closing */
+    file.close();
+    return true;
+}
+
+void LockstepRunner::runGroup(unsigned first) {
+    unsigned count = min(nOfLanes, (unsigned)instances.size() - first);
+
+    groupFirstInstance = first;
+    groupCycle = 0;
+    activeLanes = LaneVector{};
+    fill(peeled, peeled + LOCKSTEP_MAX_LANES, false);
+
+    /* every lane is an emulator of its own, with the inputs of its instance */
+    for (unsigned lane = 0; lane < count; lane++) {
+        if (lanes[lane] && lanes[lane]->snapshot.taken) lanes[lane]->restoreSnapshot(); // the program is loaded only for the first group
+        else {
+            lanes[lane].reset(new Emulator(inputFilePath));
+            configure(*lanes[lane]);
+            lanes[lane]->setOutputStream(nullptr); // there is no console and no keyboard in the lockstep mode
+            lanes[lane]->setTerminalInput(-1);
+
+            if (!lanes[lane]->prepare()) {
+                finishLane(lane, "error");
+                continue;
+            }
+            lanes[lane]->takeSnapshot();
+        }
+
+        Emulator &e = *lanes[lane];
+        for (auto input : instances[first + lane].registerInputs)
+            e.setRegister(input.first, input.second);
+        for (auto input : instances[first + lane].memoryInputs)
+            e.writeMemoryWord(input.first, input.second);
+        e.materializePswFlags();
+
+        storeLane(lane);
+        activeLanes[lane] = -1;
+        if (nOfLanes == 1) peelLane(lane);
+    }
+    updateNextEventCycle();
+    keepCommonPc();
+
+    /* the group executes the commands of its leading lane (the first active one) */
+    while (anyLane(activeLanes)) {
+        unsigned leaderLane = 0;
+        while (!activeLanes[leaderLane]) leaderLane++;
+        Emulator &leader = *lanes[leaderLane];
+
+        leader.registers[R_INDEX::pc] = registerFile[R_INDEX::pc][leaderLane];
+        leader.cd = {};
+        if (!leader.commandFetchAndDecode()) {
+            // every lane reports the error on its own
+            for (unsigned lane = 0; lane < count; lane++)
+                if (activeLanes[lane]) peelLane(lane);
+            break;
+        }
+        leader.cd.fusion = FUSION::no_fusion; // commands are executed one by one
+
+        /* lanes that have written into the pages of the command must still have the same command there */
+        unsigned address = 0xFFFF & registerFile[R_INDEX::pc][leaderLane];
+        unsigned firstPage = address / MEMORY_PAGE_SIZE, lastPage = (0xFFFF & (address + leader.cd.length - 1)) / MEMORY_PAGE_SIZE;
+        bool leaderWritten = leader.dirtyPages[firstPage] || leader.dirtyPages[lastPage];
+        for (unsigned lane = leaderLane + 1; lane < count; lane++) {
+            if (!activeLanes[lane]) continue;
+            Emulator &e = *lanes[lane];
+            if (!leaderWritten && !e.dirtyPages[firstPage] && !e.dirtyPages[lastPage]) continue;
+
+            for (unsigned i = 0; i < (unsigned)leader.cd.length; i++)
+                if (e.memory[0xFFFF & (address + i)] != leader.memory[0xFFFF & (address + i)]) {
+                    peelLane(lane);
+                    break;
+                }
+        }
+
+        /* execution */
+        groupCycle++; // counted before the execution, like in the switch engine
+        groupCommands++;
+        for (unsigned lane = 0; lane < count; lane++)
+            if (activeLanes[lane]) laneCommands++;
+
+        assignLanes(registerFile[R_INDEX::pc], registerFile[R_INDEX::pc] + (short)leader.cd.length, activeLanes);
+        if (executeVector(leader)) vectorCommands++;
+        else {
+            executeScalar(leader);
+            updateNextEventCycle();
+        }
+        keepCommonPc();
+
+        if (groupCycle >= groupNextEventCycle) handleDueEvents();
+    }
+
+    /* lanes that have left the group finish on the scalar core */
+    for (unsigned lane = 0; lane < count; lane++) {
+        if (!peeled[lane]) continue;
+
+        Emulator &e = *lanes[lane];
+        if (!e.resume()) finishLane(lane, "error");
+        else finishLane(lane, e.isHalted() ? "halt" : "timeout");
+    }
+}
+
+bool LockstepRunner::executeVector(Emulator &leader) {
+    Emulator::CommandData &cd = leader.cd;
+    LaneVector &pc = registerFile[R_INDEX::pc];
+    LaneVector &sp = registerFile[R_INDEX::sp];
+    LaneVector &psw = registerFile[R_INDEX::psw];
+    LaneVector values = {};
+
+    /* jumps, call and ret with an immediate operand (lanes that do not take a conditional jump leave the group later) */
+    switch (cd.mnemonic) {
+        case MNEMONIC::jmp: case MNEMONIC::jeq: case MNEMONIC::jne: case MNEMONIC::jgt: {
+            if (cd.addressingMode != ADDRESSING_MODE::immed) return false;
+
+            LaneVector taken = LaneVector{} - 1; // jmp
+            if (cd.mnemonic == MNEMONIC::jeq) taken = (psw & (short)FLAG_MASK::z) != 0;
+            if (cd.mnemonic == MNEMONIC::jne) taken = (psw & (short)FLAG_MASK::z) == 0;
+            if (cd.mnemonic == MNEMONIC::jgt) taken = (psw & (short)(FLAG_MASK::z | FLAG_MASK::o | FLAG_MASK::n)) == 0; // see evaluateJumpCondition()
+            assignLanes(pc, LaneVector{} + cd.payload, taken & activeLanes);
+            return true;
+        }
+        case MNEMONIC::call:
+            // [push pc; pc <= operand]
+            if (cd.addressingMode != ADDRESSING_MODE::immed || !writeLanes(sp - 2, pc)) return false;
+            assignLanes(sp, sp - 2, activeLanes);
+            assignLanes(pc, LaneVector{} + cd.payload, activeLanes);
+            return true;
+        case MNEMONIC::ret:
+            // [pop pc]
+            readLanes(sp, values);
+            assignLanes(pc, values, activeLanes);
+            assignLanes(sp, sp + 2, activeLanes);
+            return true;
+    }
+
+    /* the other commands - psw and pc operands need the scalar core (interrupt requests, jumps) */
+    if (cd.rDst < 0 || cd.rDst >= R_INDEX::pc || cd.rSrc == R_INDEX::pc || cd.rSrc == R_INDEX::psw) return false;
+
+    LaneVector unused = {}; // rSrc of commands with one register, an immediate or a memory direct operand (0xF)
+    LaneVector &dst = registerFile[(int)cd.rDst];
+    LaneVector &src = cd.rSrc >= 0 && cd.rSrc < NO_REGISTERS ? registerFile[(int)cd.rSrc] : unused;
+    short update = cd.updateType == UPDATE_TYPE::no_update ? 0 : (cd.updateType == UPDATE_TYPE::pre_decrement || cd.updateType == UPDATE_TYPE::post_decrement ? -2 : 2);
+
+    switch (cd.mnemonic) {
+        case MNEMONIC::add:
+            assignLanes(dst, dst + src, activeLanes);
+            break;
+        case MNEMONIC::sub:
+            assignLanes(dst, dst - src, activeLanes);
+            break;
+        case MNEMONIC::mul:
+            assignLanes(dst, dst * src, activeLanes);
+            break;
+        case MNEMONIC::_not:
+            assignLanes(dst, ~dst, activeLanes);
+            break;
+        case MNEMONIC::_and:
+            assignLanes(dst, dst & src, activeLanes);
+            break;
+        case MNEMONIC::_or:
+            assignLanes(dst, dst | src, activeLanes);
+            break;
+        case MNEMONIC::_xor:
+            assignLanes(dst, dst ^ src, activeLanes);
+            break;
+        case MNEMONIC::xchg: {
+            LaneVector tmp = dst;
+            assignLanes(dst, src, activeLanes);
+            assignLanes(src, tmp, activeLanes);
+            break;
+        }
+        case MNEMONIC::cmp: case MNEMONIC::test: {
+            /* flags are computed eagerly (see updatePswFlags()) */
+            LaneVector result = cd.mnemonic == MNEMONIC::cmp ? dst - src : dst & src;
+            LaneVector flags = ((result == 0) & (short)FLAG_MASK::z) | ((result < 0) & (short)FLAG_MASK::n);
+            short written = FLAG_MASK::z | FLAG_MASK::n;
+            if (cd.mnemonic == MNEMONIC::cmp) {
+                // the o-flag is always cleared, updatePswFlags() computes op1 - op2 in int
+                flags |= (dst < src) & (short)FLAG_MASK::c;
+                written |= FLAG_MASK::c | FLAG_MASK::o;
+            }
+            assignLanes(psw, (psw & (short)~written) | flags, activeLanes);
+            break;
+        }
+        case MNEMONIC::ldr_pop:
+            // [rDst <= operand; update rSrc] (pop is a load with post-increment)
+            switch (cd.addressingMode) {
+                case ADDRESSING_MODE::immed:
+                    values = LaneVector{} + cd.payload;
+                    break;
+                case ADDRESSING_MODE::regdir:
+                    values = src;
+                    break;
+                case ADDRESSING_MODE::regind:
+                    readLanes(src, values);
+                    break;
+                case ADDRESSING_MODE::regind_disp:
+                    readLanes(src + cd.payload, values);
+                    break;
+                case ADDRESSING_MODE::memdir:
+                    readLanes(LaneVector{} + cd.payload, values);
+                    break;
+                default:
+                    return false;
+            }
+            assignLanes(dst, values, activeLanes);
+            assignLanes(src, src + update, activeLanes);
+            break;
+        case MNEMONIC::str_push:
+            // [update rSrc; operand <= rDst] (push is a store with pre-decrement)
+            switch (cd.addressingMode) {
+                case ADDRESSING_MODE::regind:
+                    if (!writeLanes(src + update, dst)) return false;
+                    break;
+                case ADDRESSING_MODE::regind_disp:
+                    if (!writeLanes(src + update + cd.payload, dst)) return false;
+                    break;
+                case ADDRESSING_MODE::memdir:
+                    if (!writeLanes(LaneVector{} + cd.payload, dst)) return false;
+                    break;
+                default:
+                    return false;
+            }
+            assignLanes(src, src + update, activeLanes);
+            break;
+        default:
+            return false;
+    }
+    return true;
+}
+
+void LockstepRunner::readLanes(const LaneVector &addresses, LaneVector &values) {
+    for (unsigned lane = 0; lane < LOCKSTEP_MAX_LANES; lane++)
+        if (activeLanes[lane]) values[lane] = lanes[lane]->readFromMemory(0xFFFF & addresses[lane], WORD);
+}
+
+bool LockstepRunner::writeLanes(const LaneVector &addresses, const LaneVector &values) {
+    // device registers are written by the scalar core (the devices see the virtual time of the emulator)
+    for (unsigned lane = 0; lane < LOCKSTEP_MAX_LANES; lane++)
+        if (activeLanes[lane] && lanes[lane]->deviceWord(0xFFFF & addresses[lane])) return false;
+
+    for (unsigned lane = 0; lane < LOCKSTEP_MAX_LANES; lane++)
+        if (activeLanes[lane]) lanes[lane]->writeToMemory(0xFFFF & addresses[lane], WORD, values[lane]);
+    return true;
+}
+
+void LockstepRunner::executeScalar(Emulator &leader) {
+    Emulator::CommandData cd = leader.cd; // the leader itself may finish
+
+    for (unsigned lane = 0; lane < LOCKSTEP_MAX_LANES; lane++) {
+        if (!activeLanes[lane]) continue;
+        Emulator &e = *lanes[lane];
+
+        loadLane(lane);
+        e.cd = cd;
+
+        bool running = true;
+        if (!e.commandExecute(running)) {
+            finishLane(lane, "error");
+            continue;
+        }
+        e.materializePswFlags();
+
+        if (!running) {
+            e.programHalted = true;
+            finishLane(lane, "halt");
+        } else if (e.instructionsRetired != groupCycle) {
+            peelLane(lane); // an idle loop was skipped to the next device event
+        } else storeLane(lane);
+    }
+}
+
+void LockstepRunner::handleDueEvents() {
+    for (unsigned lane = 0; lane < LOCKSTEP_MAX_LANES; lane++) {
+        if (!activeLanes[lane] || groupCycle < lanes[lane]->nextEventCycle) continue;
+        Emulator &e = *lanes[lane];
+
+        loadLane(lane);
+        e.handleEvents();
+        if (e.stopRequested) finishLane(lane, "timeout");
+        else storeLane(lane);
+    }
+    updateNextEventCycle();
+    keepCommonPc(); // an accepted interrupt request
+}
+
+void LockstepRunner::updateNextEventCycle() {
+    groupNextEventCycle = ~0ULL;
+    for (unsigned lane = 0; lane < LOCKSTEP_MAX_LANES; lane++)
+        if (activeLanes[lane]) groupNextEventCycle = min(groupNextEventCycle, lanes[lane]->nextEventCycle);
+}
+
+void LockstepRunner::keepCommonPc() {
+    LaneVector &pc = registerFile[R_INDEX::pc];
+
+    unsigned leaderLane = 0;
+    while (leaderLane < LOCKSTEP_MAX_LANES && !activeLanes[leaderLane]) leaderLane++;
+    if (leaderLane == LOCKSTEP_MAX_LANES || !anyLane((pc != pc[leaderLane]) & activeLanes)) return;
+
+    /* the group follows the pc of most lanes */
+    short commonPc = pc[leaderLane];
+    unsigned commonLanes = 0;
+    for (unsigned lane = 0; lane < LOCKSTEP_MAX_LANES; lane++) {
+        if (!activeLanes[lane]) continue;
+
+        unsigned lanesWithPc = 0;
+        for (unsigned other = 0; other < LOCKSTEP_MAX_LANES; other++)
+            if (activeLanes[other] && pc[other] == pc[lane]) lanesWithPc++;
+        if (lanesWithPc > commonLanes) {
+            commonPc = pc[lane];
+            commonLanes = lanesWithPc;
+        }
+    }
+
+    for (unsigned lane = 0; lane < LOCKSTEP_MAX_LANES; lane++)
+        if (activeLanes[lane] && pc[lane] != commonPc) peelLane(lane);
+    updateNextEventCycle();
+}
+
+void LockstepRunner::loadLane(unsigned lane) {
+    Emulator &e = *lanes[lane];
+    for (unsigned i = 0; i < NO_REGISTERS; i++)
+        e.registers[i] = registerFile[i][lane];
+    e.instructionsRetired = groupCycle;
+}
+
+void LockstepRunner::storeLane(unsigned lane) {
+    Emulator &e = *lanes[lane];
+    for (unsigned i = 0; i < NO_REGISTERS; i++)
+        registerFile[i][lane] = e.registers[i];
+}
+
+void LockstepRunner::peelLane(unsigned lane) {
+    Emulator &e = *lanes[lane];
+    if (activeLanes[lane] && e.instructionsRetired == groupCycle) loadLane(lane); // not if the emulator is ahead (an idle loop)
+
+    // commands decoded for the group have no threaded handlers
+    if (e.engine == ENGINE::threaded_engine) {
+        if (e.profilingEnabled) e.profileFoldAll(); // the counted commands leave the cache
+        fill(e.decodeCacheValid.begin(), e.decodeCacheValid.end(), 0);
+    }
+
+    activeLanes[lane] = 0;
+    peeled[lane] = true;
+    peeledLanes++;
+}
+
+void LockstepRunner::finishLane(unsigned lane, string status) {
+    Emulator &e = *lanes[lane];
+    Instance &instance = instances[groupFirstInstance + lane];
+
+    instance.status = status;
+    for (unsigned i = 0; i < NO_REGISTERS; i++)
+        instance.registers[i] = e.registers[i];
+    instance.instructionsRetired = e.instructionsRetired;
+    instance.messages = e.getErrorMessages();
+
+    activeLanes[lane] = 0;
+    peeled[lane] = false;
+}
+
+bool LockstepRunner::allHalted() {
+    for (Instance &instance : instances)
+        if (instance.status != "halt") return false;
+    return true;
+}
+
+/* printing methods */
+void LockstepRunner::printResults(ostream &out) {
+    for (unsigned i = 0; i < instances.size(); i++) {
+        Instance &instance = instances[i];
+
+        out << "Instance " << i << ": " << instance.status << ", instructions=" << instance.instructionsRetired << hex;
+        out << ", psw=0x" << setfill('0') << setw(4) << (0xFFFF & instance.registers[R_INDEX::psw]);
+        for (unsigned j = 0; j < 8; j++)
+            out << (j == 0 ? ", " : " ") << "r" << j << "=0x" << setfill('0') << setw(4) << (0xFFFF & instance.registers[j]);
+        out << dec << endl;
+        for (string message : instance.messages)
+            out << "    " << message << endl;
+    }
+
+    unsigned long long laneSlots = groupCommands * nOfLanes;
+    out << "Lockstep: lanes=" << nOfLanes << ", group commands=" << groupCommands << ", vector commands=" << vectorCommands;
+    out << ", lane utilisation=" << fixed << setprecision(1) << (laneSlots > 0 ? 100.0 * laneCommands / laneSlots : 0) << "%";
+    out << ", peeled lanes=" << peeledLanes << endl;
+}
+
+void LockstepRunner::printErrorMessages() {
+    cout << "\n\nLockstep errors:" << endl;
+    for (string e : lockstepErrors)
+        cout << e << endl;
+}
@@ -0,0 +1,97 @@
+#include <cstring>    // memchr(), memmove()
+#include <cerrno>
+#include <fcntl.h>    // open()
+#include <unistd.h>   // read(), close()
+#include <sys/mman.h> // mmap()
+#include <sys/stat.h>
+
+#include "../inc/reader.h"
+
+/* constructor and destructor */
+SourceReader::SourceReader() : fileDescriptor(-1), mapping(nullptr), mappingSize(0), begin(0), end(0), endOfFile(false),
+    position(nullptr), limit(nullptr) {}
+
+SourceReader::~SourceReader() {
+    if (mapping != nullptr) munmap(mapping, mappingSize);
+    if (fileDescriptor > 0) close(fileDescriptor); // the standard input stays open
+}
+
+bool SourceReader::open(const string &path) {
+    fileDescriptor = path == "-" ? 0 : ::open(path.c_str(), O_RDONLY);
+    if (fileDescriptor < 0) return false;
+
+    /* a regular file is mapped and read in order (an empty one has no lines), anything else is read in chunks */
+    struct stat info;
+    if (fstat(fileDescriptor, &info) != 0) return false;
+    if (S_ISREG(info.st_mode) && path != "-") {
+        mappingSize = info.st_size;
+        if (mappingSize == 0) return true;
+
+        void *address = mmap(nullptr, mappingSize, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+        if (address != MAP_FAILED) {
+            madvise(address, mappingSize, MADV_SEQUENTIAL);
+            mapping = (char *)address;
+            position = mapping;
+            limit = mapping + mappingSize;
+            return true;
+        }
+        mappingSize = 0; // e.g. a file system without mmap() support
+    }
+
+    if (S_ISDIR(info.st_mode)) return false;
+    buffer.resize(CHUNK_SIZE);
+    return true;
+}
+
+bool SourceReader::readChunk() {
+    if (endOfFile) return false;
+
+    /* the unread bytes are moved to the front, the buffer is doubled only for a line longer than it */
+    memmove(buffer.data(), buffer.data() + begin, end - begin);
+    end -= begin;
+    begin = 0;
+    if (end == buffer.size()) buffer.resize(buffer.size() * 2);
+
+    ssize_t bytes;
+    do bytes = read(fileDescriptor, buffer.data() + end, buffer.size() - end);
+    while (bytes < 0 && errno == EINTR);
+
+    if (bytes <= 0) {
+        endOfFile = true; // a read error ends the input as well
+        return false;
+    }
+    end += bytes;
+    return true;
+}
+
+bool SourceReader::nextLine(string_view &line) {
+    /* a mapped file */
+    if (mapping != nullptr || buffer.empty()) {
+        if (position == limit) return false;
+
+        const char *newline = (const char *)memchr(position, '\n', limit - position);
+        line = string_view(position, (newline == nullptr ? limit : newline) - position);
+        position = newline == nullptr ? limit : newline + 1;
+        return true;
+    }
+
+    /* the standard input or a pipe */
+    size_t searched = begin; // the bytes before are known to have no '\n'
+    while (true) {
+        char *newline = (char *)memchr(buffer.data() + searched, '\n', end - searched);
+        if (newline != nullptr) {
+            line = string_view(buffer.data() + begin, newline - (buffer.data() + begin));
+            begin = newline - buffer.data() + 1;
+            return true;
+        }
+
+        searched = end - begin; // offset after readChunk() moves the unread bytes to the front
+        if (!readChunk()) break;
+    }
+
+    /* the last line without a '\n' */
+    if (begin == end) return false;
+    line = string_view(buffer.data() + begin, end - begin);
+    begin = end;
+    return true;
+}
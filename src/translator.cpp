@@ -0,0 +1,474 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cstdlib>  // system(), getenv()
+#include <climits>  // PATH_MAX
+#include <unistd.h> // readlink()
+
+#include "../inc/translator.h"
+#include "../inc/image.h"
+
+/* main program */
+int main(int argc, const char *argv[]) {
+    // expected format: './translator [-cpp <source_file>] [-no-build] -o <output_file> <input_file>'
+    if (argc < 2) {
+        cout << "File path is not specified." << endl;
+        return -1;
+    }
+
+    /* variable definitions */
+    bool dashOFound = false, dashCppFound = false, build = true;
+    string inputFilePath = "", outputFilePath = "translator_output_generic", sourceFilePath = "";
+
+    /* reading command line arguments */
+    int i = 1;
+    string currentArgument;
+    while (i < argc) {
+        currentArgument = argv[i++];
+
+        if (currentArgument == "-o") dashOFound = true;
+        else if (currentArgument == "-cpp") dashCppFound = true;
+        else if (currentArgument == "-no-build") build = false;
+        else if (dashOFound) { // output file path
+            outputFilePath = currentArgument;
+            dashOFound = false;
+        } else if (dashCppFound) { // translation unit path
+            sourceFilePath = currentArgument;
+            dashCppFound = false;
+        } else inputFilePath = currentArgument;
+    }
+
+    /* solving possible errors */
+    if (inputFilePath == "") {
+        cout << "Input file path is not specified." << endl;
+        return -1;
+    }
+    if (sourceFilePath == "") sourceFilePath = outputFilePath + ".cpp";
+
+    /* translator object creation and translation */
+    Translator translator(inputFilePath, outputFilePath, sourceFilePath, build);
+
+    if (!translator.translate()) {
+        translator.printErrorMessages();
+        return -1;
+    }
+    return 0;
+}
+
+/* C++ literals of the generated code */
+static string hexLiteral(unsigned value) {
+    ostringstream out;
+    out << "0x" << hex << setfill('0') << setw(4) << (0xFFFF & value);
+    return out.str();
+}
+
+static string registerOperand(char r) {
+    return "r[" + to_string((int)r) + "]";
+}
+
+/* a path as one word of a shell command */
+static string shellQuoted(const string &path) {
+    string quoted = "'";
+    for (char c : path) {
+        if (c == '\'') quoted += "'\\''"; // the quote ends, an escaped ' and a new quote
+        else quoted += c;
+    }
+    return quoted + "'";
+}
+
+/* constructor */
+Translator::Translator(string inputPath, string outputPath, string sourcePath, bool build) : inputFilePath(inputPath),
+    outputFilePath(outputPath), sourceFilePath(sourcePath), buildExecutable(build), memory(MEMORY_SIZE), loaded(MEMORY_SIZE) {}
+
+/* translate() and methods called by it */
+bool Translator::translate() {
+    if (!readImage()) return false;
+
+    findCode();
+    if (leaders.empty()) {
+        translatingErrors.push_back("No code is reachable from the IVT entries of " + inputFilePath + ".");
+        return false;
+    }
+
+    if (!writeSource()) return false;
+    return !buildExecutable || build();
+}
+
+bool Translator::readImage() {
+    ifstream file(inputFilePath, ios::binary);
+    if (file.fail() || !file.is_open()) {
+        translatingErrors.push_back(inputFilePath + " opening failed.");
+        return false;
+    }
+    image.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+    file.close();
+
+    /* the same checks as in Emulator::loadImage() */
+    vector<ImageSegment> segments;
+    string error = imageSegments((const unsigned char *)image.data(), image.size(), MMAP_REGISTERS_START_ADDRESS, inputFilePath, segments);
+    if (error != "") {
+        translatingErrors.push_back(error);
+        return false;
+    }
+    for (const ImageSegment &segment : segments)
+        for (unsigned j = 0; j < segment.length; j++) {
+            memory[segment.baseAddress + j] = image[segment.offset + j];
+            loaded[segment.baseAddress + j] = 1;
+        }
+    return true;
+}
+
+bool Translator::decodeCommand(unsigned address, Command &command) {
+    auto byteAt = [this, address](unsigned offset) { return 0xFF & memory[address + offset]; };
+    auto available = [this, address](unsigned length) {
+        if (address + length > MEMORY_SIZE) return false; // a block does not wrap around the end of memory
+        for (unsigned i = 0; i < length; i++)
+            if (!loaded[address + i]) return false;
+        return true;
+    };
+
+    if (!available(1)) return false;
+    command = {};
+
+    /* the same checks as in Emulator::commandFetchAndDecode(), from the decode table */
+    const InstructionInfo *instruction = isaDecode(byteAt(0));
+    if (instruction == nullptr || !available(instruction->length)) return false;
+    command.mnemonic = instruction->code;
+    command.length = instruction->length;
+    if (instruction->operands == operands_none) return true;
+
+    command.rDst = byteAt(1) >> 4;
+    command.rSrc = 0x0F & byteAt(1);
+    if (!isaValidRegisters(*instruction, command.rDst, command.rSrc)) return false;
+    if (instruction->length == 2) return true;
+
+    command.updateType = byteAt(2) >> 4;
+    command.addressingMode = 0x0F & byteAt(2);
+    if (!isaValidAddressingMode(*instruction, command.addressingMode) || !isaValidUpdateType(*instruction, command.updateType)) return false;
+
+    // 3B [regdir, regind] or 5B commands with a big-endian payload
+    if (isaHasPayload(command.addressingMode)) {
+        if (!available(MAX_COMMAND_LENGTH)) return false;
+        command.payload = byteAt(3) << 8 | byteAt(4);
+        command.length = MAX_COMMAND_LENGTH;
+    }
+    return true;
+}
+
+/* the target of a jump or a call, if it does not depend on the registers */
+static bool knownTarget(short addressingMode, char rSrc, short payload, unsigned nextAddress, unsigned &target) {
+    if (addressingMode == ADDRESSING_MODE::immed) target = 0xFFFF & payload;
+    else if (addressingMode == ADDRESSING_MODE::regdir_disp && rSrc == R_INDEX::pc) target = 0xFFFF & (nextAddress + payload);
+    else return false;
+    return true;
+}
+
+/* commands after which the next command is not necessarily the following one */
+static bool writesPc(short mnemonic, char rDst, char rSrc, char updateType, char addressingMode) {
+    bool noUpdate = updateType == UPDATE_TYPE::no_update;
+    return (mnemonic != MNEMONIC::cmp && mnemonic != MNEMONIC::test && rDst == R_INDEX::pc)
+        || (mnemonic == MNEMONIC::xchg && rSrc == R_INDEX::pc)
+        || (mnemonic == MNEMONIC::str_push && addressingMode == ADDRESSING_MODE::regdir && rSrc == R_INDEX::pc)
+        || ((mnemonic == MNEMONIC::ldr_pop || mnemonic == MNEMONIC::str_push) && !noUpdate && rSrc == R_INDEX::pc);
+}
+
+void Translator::findCode() {
+    /* roots - the routines of the IVT entries (an entry pointing into the IVT itself is unused) */
+    vector<unsigned> work;
+    for (unsigned entry = 0; entry < IVT_NO_ENTRIES; entry++) {
+        if (!loaded[2 * entry] || !loaded[2 * entry + 1]) continue;
+        unsigned routine = (0xFF & memory[2 * entry]) | (0xFF & memory[2 * entry + 1]) << 8;
+        if (routine >= 2 * IVT_NO_ENTRIES) work.push_back(routine);
+    }
+    for (unsigned address : work)
+        leaders.insert(address);
+
+    /* the control flow from every root, as far as the targets are known */
+    while (!work.empty()) {
+        unsigned address = work.back();
+        work.pop_back();
+
+        while (commands.count(address) == 0) {
+            Command command;
+            if (!decodeCommand(address, command)) break;
+            commands[address] = command;
+
+            unsigned nextAddress = address + command.length, target = 0;
+            bool hasTarget = knownTarget(command.addressingMode, command.rSrc, command.payload, nextAddress, target);
+            auto addLeader = [this, &work](unsigned leader) {
+                if (leaders.insert(leader).second) work.push_back(leader);
+            };
+
+            bool flowContinues = false;
+            switch (command.mnemonic) {
+                case MNEMONIC::halt: case MNEMONIC::iret: case MNEMONIC::ret:
+                    break;
+                case MNEMONIC::jmp:
+                    if (hasTarget) addLeader(target);
+                    break;
+                case MNEMONIC::jeq: case MNEMONIC::jne: case MNEMONIC::jgt: case MNEMONIC::call:
+                    if (hasTarget) addLeader(target);
+                    addLeader(nextAddress); // not taken, or the return address
+                    break;
+                case MNEMONIC::_int:
+                    addLeader(nextAddress); // iret returns here
+                    break;
+                default:
+                    flowContinues = !writesPc(command.mnemonic, command.rDst, command.rSrc, command.updateType, command.addressingMode);
+            }
+            if (!flowContinues) break;
+            address = nextAddress;
+        }
+    }
+
+    // a leader without a valid command is left to the interpreter, which reports the error once it is reached
+    for (auto leader = leaders.begin(); leader != leaders.end();)
+        leader = commands.count(*leader) ? next(leader) : leaders.erase(leader);
+}
+
+bool Translator::writeSource() {
+    ofstream file(sourceFilePath);
+    if (!file.is_open()) {
+        translatingErrors.push_back(sourceFilePath + " opening failed.");
+        return false;
+    }
+
+    file << "// " << inputFilePath << " translated ahead of time by the translator (do not edit)" << endl;
+    file << "#include \"inc/aot.h\"" << endl << endl;
+
+    for (unsigned leader : leaders)
+        writeBlock(file, leader);
+
+    /* the image and the block table */
+    file << "static const unsigned char image[] = {";
+    for (unsigned i = 0; i < image.size(); i++)
+        file << (i % 16 == 0 ? "\n    " : " ") << "0x" << hex << setfill('0') << setw(2) << (0xFF & image[i]) << ",";
+    file << dec << "\n};" << endl << endl;
+
+    file << "static const AotBlock blocks[] = {" << endl;
+    for (auto &block : blockLengths) {
+        file << "    {" << hexLiteral(block.first) << ", " << block.second << ", \"";
+        for (unsigned i = 0; i < block.second; i++)
+            file << "\\x" << hex << setfill('0') << setw(2) << (0xFF & memory[block.first + i]) << dec;
+        file << "\", block_" << hex << setfill('0') << setw(4) << block.first << dec << "}," << endl;
+    }
+    file << "};" << endl << endl;
+
+    string imagePath;
+    for (char c : inputFilePath) {
+        if (c == '"' || c == '\\') imagePath += '\\';
+        imagePath += c;
+    }
+    file << "static const AotProgram program = {\"" << imagePath << "\", image, sizeof(image), blocks, sizeof(blocks) / sizeof(blocks[0])};" << endl;
+    file << "static bool registered = AotRuntime::registerProgram(&program);" << endl;
+
+    file.close();
+    return true;
+}
+
+void Translator::writeBlock(ostream &out, unsigned start) {
+    ostringstream body;
+    bool blockEnded = false, loops = false;
+    unsigned address = start;
+
+    while (!blockEnded) {
+        const Command &command = commands[address];
+        unsigned nextAddress = address + command.length;
+
+        body << "    // " << hexLiteral(address) << ": " << isaDisassemble((const unsigned char *)&memory[address], command.length, address) << " -";
+        for (unsigned i = 0; i < (unsigned)command.length; i++)
+            body << " " << hex << setfill('0') << setw(2) << (0xFF & memory[address + i]) << dec;
+        body << endl;
+
+        loops |= writeCommand(body, address, command, start, blockEnded);
+
+        /* the block also ends where another one starts, or before bytes that are not a command */
+        if (!blockEnded && (leaders.count(nextAddress) || !commands.count(nextAddress))) {
+            body << "    r[R_INDEX::pc] = " << hexLiteral(nextAddress) << ";" << endl;
+            body << "    return AOT_EXIT_CONTINUE;" << endl;
+            blockEnded = true;
+        }
+        if (!blockEnded) body << "    AOT_EVENTS(" << hexLiteral(nextAddress) << ");" << endl;
+        address = nextAddress;
+    }
+    blockLengths[start] = address - start;
+
+    out << "static int block_" << hex << setfill('0') << setw(4) << start << dec << "(AotContext &c) {" << endl;
+    out << "    short *r = c.registers;" << endl;
+    if (loops) out << "start:" << endl;
+    out << body.str() << "}" << endl << endl;
+}
+
+bool Translator::writeCommand(ostream &out, unsigned address, const Command &command, unsigned start, bool &blockEnded) {
+    unsigned nextAddress = address + command.length, target = 0;
+    char d = command.rDst, s = command.rSrc;
+    string rd = registerOperand(d), rs = registerOperand(s);
+    bool hasTarget = knownTarget(command.addressingMode, s, command.payload, nextAddress, target);
+    bool loops = false;
+
+    /* registers other than pc and psw (sp is a general purpose register here) */
+    auto general = [](char r) { return r >= R_INDEX::r0 && r < R_INDEX::pc; };
+    bool sourceUsed = command.addressingMode == ADDRESSING_MODE::regdir || command.addressingMode == ADDRESSING_MODE::regind
+        || command.addressingMode == ADDRESSING_MODE::regind_disp || command.updateType != UPDATE_TYPE::no_update;
+    string payload = "(short)" + hexLiteral(command.payload);
+
+    // a taken jump to a known target (the idle loops are detected on backward jumps, like in the interpreter)
+    auto jumpTo = [&](string indent) {
+        out << indent << "r[R_INDEX::pc] = " << hexLiteral(target) << ";" << endl;
+        if (target < nextAddress) out << indent << "AotRuntime::backwardJump(c, " << hexLiteral(nextAddress) << ");" << endl;
+        if (target == start) {
+            out << indent << "AOT_EVENTS(" << hexLiteral(target) << ");" << endl;
+            out << indent << "goto start;" << endl;
+            loops = true;
+        } else out << indent << "return AOT_EXIT_CONTINUE;" << endl;
+    };
+
+    out << "    AOT_RETIRE();" << endl;
+
+    bool translated = true;
+    switch (command.mnemonic) {
+        case MNEMONIC::halt:
+            out << "    r[R_INDEX::pc] = " << hexLiteral(nextAddress) << ";" << endl;
+            out << "    return AOT_EXIT_HALT;" << endl;
+            blockEnded = true;
+            break;
+        case MNEMONIC::jmp:
+            if (!hasTarget) { translated = false; break; }
+            jumpTo("    ");
+            blockEnded = true;
+            break;
+        case MNEMONIC::jeq: case MNEMONIC::jne: case MNEMONIC::jgt:
+            if (!hasTarget) { translated = false; break; }
+            out << "    if (AotRuntime::jumpCondition(c, MNEMONIC::" << isaName(command.mnemonic) << ")) {" << endl;
+            jumpTo("        ");
+            out << "    }" << endl;
+            out << "    r[R_INDEX::pc] = " << hexLiteral(nextAddress) << ";" << endl;
+            out << "    return AOT_EXIT_CONTINUE;" << endl;
+            blockEnded = true;
+            break;
+        case MNEMONIC::call:
+            // [push pc; pc <= operand]
+            if (!hasTarget) { translated = false; break; }
+            out << "    r[R_INDEX::sp] -= 2;" << endl;
+            out << "    AotRuntime::store(c, 0xFFFF & r[R_INDEX::sp], (short)" << hexLiteral(nextAddress) << ");" << endl;
+            out << "    r[R_INDEX::pc] = " << hexLiteral(target) << ";" << endl;
+            out << "    return AOT_EXIT_CONTINUE;" << endl;
+            blockEnded = true;
+            break;
+        case MNEMONIC::ret:
+            // [pop pc]
+            out << "    r[R_INDEX::pc] = AotRuntime::load(c, 0xFFFF & r[R_INDEX::sp]);" << endl;
+            out << "    r[R_INDEX::sp] += 2;" << endl;
+            out << "    return AOT_EXIT_CONTINUE;" << endl;
+            blockEnded = true;
+            break;
+        case MNEMONIC::xchg:
+            if (!general(d) || !general(s)) { translated = false; break; }
+            out << "    { short tmp = " << rd << "; " << rd << " = " << rs << "; " << rs << " = tmp; }" << endl;
+            break;
+        case MNEMONIC::add: case MNEMONIC::sub: case MNEMONIC::mul: case MNEMONIC::_and: case MNEMONIC::_or: case MNEMONIC::_xor: {
+            if (!general(d) || !general(s)) { translated = false; break; }
+            const char *operation = "+=";
+            if (command.mnemonic == MNEMONIC::sub) operation = "-=";
+            else if (command.mnemonic == MNEMONIC::mul) operation = "*=";
+            else if (command.mnemonic == MNEMONIC::_and) operation = "&=";
+            else if (command.mnemonic == MNEMONIC::_or) operation = "|=";
+            else if (command.mnemonic == MNEMONIC::_xor) operation = "^=";
+            out << "    " << rd << " " << operation << " " << rs << ";" << endl;
+            break;
+        }
+        case MNEMONIC::_not:
+            if (!general(d)) { translated = false; break; }
+            out << "    " << rd << " = ~" << rd << ";" << endl;
+            break;
+        case MNEMONIC::cmp: case MNEMONIC::test:
+            if (!general(d) || !general(s)) { translated = false; break; }
+            out << "    AotRuntime::recordFlags(c, MNEMONIC::" << isaName(command.mnemonic) << ", " << (int)d << ", " << (int)s << ", ";
+            out << rd << (command.mnemonic == MNEMONIC::cmp ? " - " : " & ") << rs << ");" << endl;
+            break;
+        case MNEMONIC::ldr_pop: {
+            // [rDst <= operand] and the update of rSrc after it
+            if (!general(d) || (sourceUsed && !general(s))) { translated = false; break; }
+            string operand;
+            switch (command.addressingMode) {
+                case ADDRESSING_MODE::immed: operand = payload; break;
+                case ADDRESSING_MODE::regdir: operand = rs; break;
+                case ADDRESSING_MODE::regind: operand = "AotRuntime::load(c, 0xFFFF & " + rs + ")"; break;
+                case ADDRESSING_MODE::regind_disp: operand = "AotRuntime::load(c, 0xFFFF & (" + rs + " + " + payload + "))"; break;
+                case ADDRESSING_MODE::memdir: operand = "AotRuntime::load(c, " + hexLiteral(command.payload) + ")"; break;
+            }
+            out << "    " << rd << " = " << operand << ";" << endl;
+            if (command.updateType == UPDATE_TYPE::pre_decrement || command.updateType == UPDATE_TYPE::post_decrement) out << "    " << rs << " -= 2;" << endl;
+            if (command.updateType == UPDATE_TYPE::pre_increment || command.updateType == UPDATE_TYPE::post_increment) out << "    " << rs << " += 2;" << endl;
+            break;
+        }
+        case MNEMONIC::str_push: {
+            // the update of rSrc before [operand <= rDst]
+            if (!general(d) || (sourceUsed && !general(s))) { translated = false; break; }
+            if (command.updateType == UPDATE_TYPE::pre_decrement || command.updateType == UPDATE_TYPE::post_decrement) out << "    " << rs << " -= 2;" << endl;
+            if (command.updateType == UPDATE_TYPE::pre_increment || command.updateType == UPDATE_TYPE::post_increment) out << "    " << rs << " += 2;" << endl;
+
+            string address;
+            switch (command.addressingMode) {
+                case ADDRESSING_MODE::regdir: out << "    " << rs << " = " << rd << ";" << endl; break;
+                case ADDRESSING_MODE::regind: address = "0xFFFF & " + rs; break;
+                case ADDRESSING_MODE::regind_disp: address = "0xFFFF & (" + rs + " + " + payload + ")"; break;
+                case ADDRESSING_MODE::memdir: address = hexLiteral(command.payload); break;
+            }
+            if (address != "") { // a store into translated code leaves the block
+                out << "    if (int exitCode = AotRuntime::store(c, " << address << ", " << rd << ")) {" << endl;
+                out << "        r[R_INDEX::pc] = " << hexLiteral(nextAddress) << ";" << endl;
+                out << "        return exitCode - 1;" << endl;
+                out << "    }" << endl;
+            }
+            break;
+        }
+        default:
+            translated = false;
+    }
+
+    if (!translated) {
+        /* the interpreter executes the command (e.g. div, int, iret, shl, shr, jumps through registers and pc or psw operands) */
+        out << "    if (int exitCode = AotRuntime::execute(c, " << hexLiteral(address) << ")) return exitCode - 1;" << endl;
+
+        bool isBranch = command.mnemonic == MNEMONIC::_int || command.mnemonic == MNEMONIC::iret || command.mnemonic == MNEMONIC::call
+            || command.mnemonic == MNEMONIC::jmp || command.mnemonic == MNEMONIC::jeq || command.mnemonic == MNEMONIC::jne || command.mnemonic == MNEMONIC::jgt;
+        if (isBranch || writesPc(command.mnemonic, d, s, command.updateType, command.addressingMode)) {
+            out << "    return AOT_EXIT_CONTINUE;" << endl; // pc has been set by the command
+            blockEnded = true;
+        }
+    }
+    return loops;
+}
+
+bool Translator::build() {
+    /* the emulator sources are next to the translator executable */
+    char executablePath[PATH_MAX];
+    ssize_t length = readlink("/proc/self/exe", executablePath, sizeof(executablePath) - 1);
+    if (length <= 0) {
+        translatingErrors.push_back("The directory of the emulator sources could not be found.");
+        return false;
+    }
+    string root = string(executablePath, length);
+    root = root.substr(0, root.find_last_of('/') + 1);
+
+    // CXX is split by the shell like in make (e.g. "ccache g++"), the paths are single words
+    const char *compiler = getenv("CXX");
+    string command = string(compiler != nullptr ? compiler : TRANSLATOR_DEFAULT_COMPILER) + " " + TRANSLATOR_COMPILER_FLAGS;
+    command += " -I" + shellQuoted(root) + " -o " + shellQuoted(outputFilePath) + " " + shellQuoted(sourceFilePath);
+    for (string source : TRANSLATOR_RUNTIME_SOURCES)
+        command += " " + shellQuoted(root + source);
+
+    if (system(command.c_str()) != 0) {
+        translatingErrors.push_back("Building of " + outputFilePath + " failed: " + command);
+        return false;
+    }
+    return true;
+}
+
+void Translator::printErrorMessages() {
+    cout << "\n\nTranslating errors:" << endl;
+    for (string e : translatingErrors)
+        cout << e << endl;
+}
@@ -0,0 +1,48 @@
+# the measured assembler is built with optimisations (compile.sh builds without them)
+CXX=${CXX:-g++}
+ASSEMBLER=./assembler_benchmark
+RUNS=${RUNS:-5}         # repetitions of the measurement
+BLOCKS=${BLOCKS:-20000} # blocks of 16 source lines in the generated source
+FILES=${FILES:-1}       # copies of the generated source, assembled by one run with 'JOBS' threads
+JOBS=${JOBS:-$(nproc)}
+${CXX} -O2 -o ${ASSEMBLER} ../src/assembler.cpp ../src/lexer.cpp ../src/reader.cpp ../src/interner.cpp -pthread || exit 1
+
+# a generated source with every directive and addressing mode, comments, tabs and spaces around the separators
+awk -v blocks=${BLOCKS} 'BEGIN {
+    print ".global start_0\n.extern printf, puts"
+    for (i = 0; i < blocks; i++) {
+        if (i % 1000 == 0) printf ".section code_%d\n", i / 1000
+        printf "start_%d:\tldr r1, $0x10   # the loop counter\n", i
+        printf "loop_%d:  add r1 , r2\n\tsub r1, r3\n\tcmp r1,r0\n\tjne %%loop_%d\n", i, i
+        printf "\tldr r2, [r6 + 4]\n\tstr r2, data_%d\n\tldr r3, %%data_%d\n\tjmp *[r1 - 2]\n", i, i
+        printf "\tcall far_%d\n\tcall *printf\n\tpush r1\n\tpop r1\n\tint psw\n", i
+        printf "far_%d: .word start_%d, -5, 0x7F, puts\n", i, i
+        printf "data_%d: .skip 2\n", i
+    }
+    print ".end"
+}' > assembler_benchmark.s
+LINES=$(( $(wc -l < assembler_benchmark.s) * FILES ))
+SOURCES=assembler_benchmark.s
+if [ ${FILES} -gt 1 ]; then
+    mkdir -p assembler_benchmark_files
+    SOURCES=$(for FILE in $(seq ${FILES}); do cp assembler_benchmark.s assembler_benchmark_files/source_${FILE}.s; echo assembler_benchmark_files/source_${FILE}.s; done)
+fi
+
+# one JSON object (times of the whole assembler run, reading the source and writing both object files)
+for RUN in $(seq ${RUNS}); do
+    START=$(date +%s%N)
+    if [ ${FILES} -gt 1 ]; then ${ASSEMBLER} -j ${JOBS} -o assembler_benchmark_files ${SOURCES} > /dev/null || exit 1
+    else ${ASSEMBLER} -o assembler_benchmark.o assembler_benchmark.s > /dev/null || exit 1; fi
+    echo $(( ($(date +%s%N) - START) / 1000 ))
+done | awk -v lines=${LINES} -v files=${FILES} -v jobs=$([ ${FILES} -gt 1 ] && echo ${JOBS} || echo 1) '
+    { runs++; times[runs] = $1 / 1000; timeSum += $1 / 1000 }
+    END {
+        timeMean = timeSum / runs
+        for (i = 1; i <= runs; i++) timeVariance += (times[i] - timeMean) ^ 2
+        if (runs > 1) timeVariance /= runs - 1
+        printf "{\"tool\": \"assembler\", \"runs\": %d, \"files\": %d, \"jobs\": %d, \"lines\": %d, \"time_ms\": %.3f, \"time_ms_stddev\": %.3f, \"lines_per_second\": %.0f}\n",
+            runs, files, jobs, lines, timeMean, sqrt(timeVariance), lines * 1000 / timeMean
+    }'
+status=$?
+rm -rf ${ASSEMBLER} assembler_benchmark.s assembler_benchmark.o assembler_benchmark_text.o assembler_benchmark_files
+exit ${status}
@@ -0,0 +1,31 @@
+# file: bench_arith.s
+# benchmark: a tight loop of arithmetic, logic and shift commands (about 23M commands)
+
+.section ivt
+.word arith_start
+.skip 14
+
+.section arith_code
+arith_start:
+  ldr r4, $32 # outer iterations
+  ldr r5, $0  # result
+arith_outer:
+  ldr r3, $0  # inner counter, back to 0 after 65536 iterations
+arith_loop:
+  ldr r0, $7
+  mul r0, r3
+  add r5, r0
+  ldr r1, $3
+  shr r5, r1
+  xor r5, r3
+  ldr r1, $1
+  add r3, r1
+  ldr r2, $0
+  cmp r3, r2
+  jne arith_loop
+  sub r4, r1
+  cmp r4, r2
+  jne arith_outer
+  halt
+
+.end
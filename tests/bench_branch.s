@@ -0,0 +1,46 @@
+# file: bench_branch.s
+# benchmark: branch-heavy code - conditional jumps on pseudo-random bits (about 21M commands)
+
+.section ivt
+.word branch_start
+.skip 14
+
+.section branch_code
+branch_start:
+  ldr r4, $0  # result
+  ldr r5, $1  # generator state
+  ldr r1, $1
+  ldr r2, $0
+  ldr r6, $24 # outer iterations
+branch_outer:
+  ldr r3, $0  # inner counter, back to 0 after 65536 iterations
+branch_loop:
+  # r5 <= r5 * 25173 + 13849
+  ldr r0, $25173
+  mul r5, r0
+  ldr r0, $13849
+  add r5, r0
+  ldr r0, $0x0100
+  test r5, r0
+  jeq branch_even
+  add r4, r1
+  jmp branch_sign
+branch_even:
+  sub r4, r1
+branch_sign:
+  cmp r4, r2
+  jgt branch_next
+  ldr r0, $0x1000
+  test r5, r0
+  jne branch_next
+  xor r4, r3
+branch_next:
+  add r3, r1
+  cmp r3, r2
+  jne branch_loop
+  sub r6, r1
+  cmp r6, r2
+  jne branch_outer
+  halt
+
+.end
@@ -0,0 +1,41 @@
+# file: bench_copy.s
+# benchmark: a memory copy loop - 8KB copied back and forth 400 times (about 23M commands)
+
+.section ivt
+.word copy_start
+.skip 14
+
+.section copy_code
+copy_start:
+  ldr r5, $800 # copies
+  ldr r2, $2
+copy_next:
+  # even copies go from 0x4000 to 0x6000, odd ones back, each word is incremented on the way
+  ldr r1, $0x4000
+  ldr r3, $0x6000
+  ldr r0, $1
+  test r5, r0
+  jeq copy_words
+  ldr r1, $0x6000
+  ldr r3, $0x4000
+copy_words:
+  ldr r4, r1
+  ldr r0, $0x2000
+  add r4, r0 # the end of the source
+copy_loop:
+  ldr r0, [r1]
+  add r0, r2
+  str r0, [r3]
+  add r1, r2
+  add r3, r2
+  cmp r1, r4
+  jne copy_loop
+  ldr r0, $1
+  sub r5, r0
+  ldr r0, $0
+  cmp r5, r0
+  jne copy_next
+  ldr r5, 0x4000 # 800 copies incremented it by 2
+  halt
+
+.end
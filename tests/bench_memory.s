@@ -0,0 +1,40 @@
+# file: bench_memory.s
+# benchmark: data loads and stores - 13 of the 18 commands of the loop access RAM words (about 24M commands)
+
+.section ivt
+.word memory_start
+.skip 14
+
+.section memory_code
+memory_start:
+  ldr r4, $20 # outer iterations
+  ldr r1, $0x5000
+  ldr r2, $1
+memory_outer:
+  ldr r5, $0 # 65536 inner iterations
+memory_loop:
+  ldr r0, 0x5000 # memory direct
+  ldr r3, [r1 + 2]
+  str r0, [r1 + 4]
+  str r3, 0x5006
+  push r0
+  push r3
+  pop r3
+  pop r0
+  ldr r0, [r1]
+  add r0, r2
+  str r0, [r1]
+  ldr r3, [r1 + 6]
+  str r3, [r1 + 2]
+  ldr r0, 0x5004
+  sub r5, r2
+  ldr r0, $0
+  cmp r5, r0
+  jne memory_loop
+  sub r4, r2
+  cmp r4, r0
+  jne memory_outer
+  ldr r5, 0x5000 # incremented once per iteration
+  halt
+
+.end
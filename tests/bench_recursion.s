@@ -0,0 +1,43 @@
+# file: bench_recursion.s
+# benchmark: call/ret-heavy recursion - fib(18) computed 250 times (about 20M commands)
+
+.section ivt
+.word recursion_start
+.skip 14
+
+.section recursion_code
+recursion_start:
+  ldr r6, $0xFEFE # init SP
+  ldr r4, $250    # repetitions
+recursion_loop:
+  ldr r0, $18
+  call recursion_fib
+  ldr r5, r0      # fib(18) = 2584
+  ldr r1, $1
+  sub r4, r1
+  ldr r1, $0
+  cmp r4, r1
+  jne recursion_loop
+  halt
+
+# r0 <= fib(r0), r1 is not preserved
+recursion_fib:
+  ldr r1, $1
+  cmp r0, r1
+  jgt recursion_fib_sum
+  ret # fib(0) = 0, fib(1) = 1
+recursion_fib_sum:
+  push r0 # n
+  sub r0, r1
+  call recursion_fib
+  pop r1
+  push r0 # fib(n - 1)
+  ldr r0, $2
+  sub r1, r0
+  ldr r0, r1
+  call recursion_fib
+  pop r1
+  add r0, r1
+  ret
+
+.end
@@ -0,0 +1,48 @@
+ASSEMBLER=../assembler
+LINKER=../linker
+TRANSLATOR=../translator
+
+# the measured emulator is built with optimisations (compile.sh builds without them)
+CXX=${CXX:-g++}
+EMULATOR=./emulator_benchmark
+RUNS=${RUNS:-5}                                  # repetitions of every measurement
+ENGINES=${ENGINES:-"switch threaded jit aot"}   # aot - the workload translated by the translator
+WORKLOADS=${WORKLOADS:-"bench_arith bench_recursion bench_copy bench_branch bench_memory"}
+${CXX} -O2 -o ${EMULATOR} ../src/emulator.cpp ../src/jit.cpp ../src/batch.cpp ../src/lockstep.cpp ../src/aot.cpp -pthread || exit 1
+
+# one JSON object per line and per workload and engine (times of the emulation only, without the program load)
+for WORKLOAD in ${WORKLOADS}; do
+    ${ASSEMBLER} -o ${WORKLOAD}.o ${WORKLOAD}.s
+    ${LINKER} -hex -o ${WORKLOAD}.hex ${WORKLOAD}.o
+
+    for ENGINE in ${ENGINES}; do
+        COMMAND="${EMULATOR} --engine=${ENGINE}"
+        if [ ${ENGINE} = aot ]; then
+            ${TRANSLATOR} -o ${WORKLOAD}_native ${WORKLOAD}.hex || exit 1
+            COMMAND=./${WORKLOAD}_native
+        fi
+
+        for RUN in $(seq ${RUNS}); do
+            ${COMMAND} --stats --dump=none ${WORKLOAD}.hex < /dev/null | grep "^Emulation statistics"
+        done | awk -v workload=${WORKLOAD#bench_} -v engine=${ENGINE} '
+            # Emulation statistics: engine=switch, instructions=23068803, time=814.704ms, MIPS=28.3156
+            {
+                split($0, fields, /[=,]/)
+                instructions = fields[4]; time = fields[6] + 0; mips = fields[8] + 0
+                runs++; times[runs] = time; mipsValues[runs] = mips
+                timeSum += time; mipsSum += mips
+            }
+            END {
+                if (runs == 0) { printf "{\"workload\": \"%s\", \"engine\": \"%s\", \"error\": \"no run finished\"}\n", workload, engine; exit 1 }
+                timeMean = timeSum / runs; mipsMean = mipsSum / runs
+                for (i = 1; i <= runs; i++) { timeVariance += (times[i] - timeMean) ^ 2; mipsVariance += (mipsValues[i] - mipsMean) ^ 2 }
+                if (runs > 1) { timeVariance /= runs - 1; mipsVariance /= runs - 1 }
+                printf "{\"workload\": \"%s\", \"engine\": \"%s\", \"runs\": %d, \"instructions\": %s, ", workload, engine, runs, instructions
+                printf "\"time_ms\": %.3f, \"time_ms_stddev\": %.3f, \"mips\": %.2f, \"mips_stddev\": %.2f, \"ns_per_instruction\": %.3f}\n",
+                    timeMean, sqrt(timeVariance), mipsMean, sqrt(mipsVariance), timeMean * 1e6 / instructions
+            }' || status=1
+        rm -f ${WORKLOAD}_native ${WORKLOAD}_native.cpp
+    done
+done
+rm -f ${EMULATOR}
+exit ${status:-0}
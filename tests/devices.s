@@ -0,0 +1,54 @@
+# file: devices.s
+# timer and terminal interrupts: typed characters are echoed, the program halts on the second timer tick
+
+.section ivt
+.word devices_start
+.skip 2
+.word devices_timer
+.word devices_terminal
+.skip 8
+
+.section devices_code
+devices_start:
+  ldr r6, $0xFEFE
+  ldr r0, $0
+  str r0, 0xFF10 # tim_cfg: 500ms
+  ldr psw, $0 # the timer and the terminal are not masked anymore
+devices_wait:
+  jmp devices_wait
+
+devices_timer:
+  push r0
+  push r1
+  ldr r0, devices_ticks
+  ldr r1, $1
+  add r0, r1
+  str r0, devices_ticks
+  ldr r1, $2
+  cmp r0, r1
+  jne devices_timer_end
+  halt
+devices_timer_end:
+  pop r1
+  pop r0
+  iret
+
+devices_terminal:
+  push r0
+  push r1
+  ldr r0, 0xFF02 # term_in
+  str r0, 0xFF00 # term_out
+  ldr r0, devices_characters
+  ldr r1, $1
+  add r0, r1
+  str r0, devices_characters
+  pop r1
+  pop r0
+  iret
+
+devices_ticks:
+.word 0
+devices_characters:
+.word 0
+
+.end
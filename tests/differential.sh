@@ -0,0 +1,182 @@
+ASSEMBLER=../assembler
+LINKER=../linker
+EMULATOR=../emulator
+TRANSLATOR=../translator
+
+# every engine and option has to end in the same processor state and memory as the reference run
+status=0
+for PROGRAM in flags fusion devices timer; do
+    ${ASSEMBLER} -o ${PROGRAM}.o ${PROGRAM}.s
+    ${LINKER} -hex -o ${PROGRAM}.hex ${PROGRAM}.o
+    INPUT=/dev/null # what is typed in on the terminal
+    if [ -f ${PROGRAM}_input.txt ]; then INPUT=${PROGRAM}_input.txt; fi
+
+    ${EMULATOR} --engine=switch --eager-flags --no-fusion --no-idle-skip ${PROGRAM}.hex < ${INPUT} > output.txt.tmp; head -n 4 output.txt.tmp > reference.txt
+    cat emulator_out_memory_sample.hex >> reference.txt
+
+    for OPTIONS in "--engine=switch" "--engine=switch --eager-flags" "--engine=switch --no-fusion" "--engine=threaded" "--engine=threaded --eager-flags" "--engine=jit" "--engine=jit --eager-flags" "--engine=jit --no-idle-skip" "--no-decode-cache"; do
+        ${EMULATOR} ${OPTIONS} ${PROGRAM}.hex < ${INPUT} > output.txt.tmp; head -n 4 output.txt.tmp > output.txt
+        cat emulator_out_memory_sample.hex >> output.txt
+        if cmp -s reference.txt output.txt; then
+            echo "${PROGRAM} ${OPTIONS}: OK"
+        else
+            echo "${PROGRAM} ${OPTIONS}: MISMATCH"
+            status=1
+        fi
+    done
+
+    # the program translated ahead of time, and its own check against the interpreter
+    ${TRANSLATOR} -o ${PROGRAM}_native ${PROGRAM}.hex
+    ./${PROGRAM}_native < ${INPUT} > output.txt.tmp; head -n 4 output.txt.tmp > output.txt
+    cat emulator_out_memory_sample.hex >> output.txt
+    if cmp -s reference.txt output.txt && ./${PROGRAM}_native --aot-check > /dev/null; then
+        echo "${PROGRAM} translated: OK"
+    else
+        echo "${PROGRAM} translated: MISMATCH"
+        status=1
+    fi
+    rm -f ${PROGRAM}_native ${PROGRAM}_native.cpp
+done
+
+# a linked image of exactly 64KB is parsed (it ends like its flat image), a flat image is told by its magic
+${ASSEMBLER} -o image_64k.o image_64k.s
+${LINKER} -hex -flat=image_64k.img -o image_64k.hex image_64k.o
+${EMULATOR} image_64k.img > output.txt.tmp; head -n 4 output.txt.tmp > reference.txt
+cat emulator_out_memory_sample.hex >> reference.txt
+${EMULATOR} image_64k.hex > output.txt.tmp; head -n 4 output.txt.tmp > output.txt
+cat emulator_out_memory_sample.hex >> output.txt
+if [ $(wc -c < image_64k.hex) -eq 65536 ] && cmp -s reference.txt output.txt && grep -q "r1=0x1234	r2=0x5678" output.txt; then
+    echo "64KB linked image: OK"
+else
+    echo "64KB linked image: MISMATCH"
+    status=1
+fi
+rm -f image_64k.img
+
+# a section that runs into the device registers fails the link before any output file is written
+printf '.section too_long\n.skip 0xFF01\n.end\n' > too_long.s
+${ASSEMBLER} -o too_long.o too_long.s > /dev/null
+rm -f too_long.hex too_long.img
+if ! ${LINKER} -hex -flat=too_long.img -o too_long.hex too_long.o > /dev/null && [ ! -e too_long.hex ] && [ ! -e too_long.img ]; then
+    echo "linker register overlap: OK"
+else
+    echo "linker register overlap: MISMATCH"
+    status=1
+fi
+rm -f too_long.s too_long.o too_long_text.o too_long.hex too_long_text.hex too_long.img
+
+# lockstep groups have to end every instance in the state of its scalar run
+${ASSEMBLER} -o lockstep.o lockstep.s
+${LINKER} -hex -o lockstep.hex lockstep.o
+${EMULATOR} --lockstep=lockstep_inputs.txt --lanes=1 lockstep.hex | head -n -1 > reference.txt
+for OPTIONS in "--lanes=8" "--lanes=16" "--lanes=32" "--lanes=32 --engine=threaded" "--lanes=32 --engine=jit"; do
+    ${EMULATOR} --lockstep=lockstep_inputs.txt ${OPTIONS} lockstep.hex | head -n -1 > output.txt
+    if cmp -s reference.txt output.txt; then
+        echo "lockstep ${OPTIONS}: OK"
+    else
+        echo "lockstep ${OPTIONS}: MISMATCH"
+        status=1
+    fi
+done
+
+# the call graph does not depend on the engine (calls, returns and interrupts are followed by all of them)
+for SOURCE in main math ivt isr_reset isr_terminal isr_timer isr_user0; do ${ASSEMBLER} -o ${SOURCE}.o ${SOURCE}.s; done
+${LINKER} -hex -map=program.map -o program.hex ivt.o math.o main.o isr_reset.o isr_terminal.o isr_timer.o isr_user0.o
+${EMULATOR} --engine=switch --no-fusion --no-idle-skip --symbols=program.map --call-graph=reference.txt program.hex < /dev/null > /dev/null
+for OPTIONS in "--engine=switch" "--engine=threaded" "--engine=jit" "--restore-loop=3"; do
+    ${EMULATOR} ${OPTIONS} --symbols=program.map --call-graph=output.txt program.hex < /dev/null > /dev/null
+    if [ "${OPTIONS}" = "--restore-loop=3" ]; then awk '{ $NF = $NF / 4; print }' output.txt > output.txt.tmp; mv output.txt.tmp output.txt; fi
+    if cmp -s reference.txt output.txt; then
+        echo "call graph ${OPTIONS}: OK"
+    else
+        echo "call graph ${OPTIONS}: MISMATCH"
+        status=1
+    fi
+done
+
+# so does the execution trace (with a ring buffer smaller than the program)
+${EMULATOR} --engine=switch --no-fusion --no-idle-skip --trace=reference.txt --trace-records=50 program.hex < /dev/null > /dev/null
+for OPTIONS in "--engine=switch" "--engine=threaded" "--engine=jit"; do
+    ${EMULATOR} ${OPTIONS} --trace=output.txt --trace-records=50 program.hex < /dev/null > /dev/null
+    if cmp -s reference.txt output.txt; then
+        echo "trace ${OPTIONS}: OK"
+    else
+        echo "trace ${OPTIONS}: MISMATCH"
+        status=1
+    fi
+done
+
+# semihosting requests end in the same state, print the same output and write the same file on every engine
+# (sed reads the whole output - a pipe closed early could stop the emulator before it writes the files)
+${ASSEMBLER} -o semihosting.o semihosting.s
+${LINKER} -hex -o semihosting.hex semihosting.o
+${EMULATOR} --semihosting --engine=switch --eager-flags --no-fusion --no-idle-skip semihosting.hex < /dev/null | sed -n 1,5p > reference.txt
+cat emulator_out_memory_sample.hex semihosting.txt >> reference.txt; wc -c < semihosting.bin >> reference.txt
+${TRANSLATOR} -o semihosting_native semihosting.hex
+for OPTIONS in "--engine=switch" "--engine=threaded" "--engine=jit" "--engine=aot"; do
+    rm -f semihosting.txt semihosting.bin
+    if [ "${OPTIONS}" = "--engine=aot" ]; then ./semihosting_native --semihosting < /dev/null | sed -n 1,5p > output.txt
+    else ${EMULATOR} --semihosting ${OPTIONS} semihosting.hex < /dev/null | sed -n 1,5p > output.txt; fi
+    cat emulator_out_memory_sample.hex semihosting.txt >> output.txt; wc -c < semihosting.bin >> output.txt
+    if cmp -s reference.txt output.txt; then
+        echo "semihosting ${OPTIONS}: OK"
+    else
+        echo "semihosting ${OPTIONS}: MISMATCH"
+        status=1
+    fi
+done
+rm -f semihosting_native semihosting_native.cpp semihosting.txt semihosting.bin
+
+# a loop that prints while it waits for the timer is not idle, so every engine prints each of its iterations
+${ASSEMBLER} -o semihosting_wait.o semihosting_wait.s
+${LINKER} -hex -o semihosting_wait.hex semihosting_wait.o
+${EMULATOR} --semihosting --engine=switch --no-idle-skip semihosting_wait.hex < /dev/null | sed -n 1,4p > reference.txt
+cat emulator_out_memory_sample.hex >> reference.txt
+${TRANSLATOR} -o semihosting_wait_native semihosting_wait.hex
+for OPTIONS in "--engine=switch" "--engine=threaded" "--engine=jit" "--engine=aot"; do
+    if [ "${OPTIONS}" = "--engine=aot" ]; then ./semihosting_wait_native --semihosting < /dev/null | sed -n 1,4p > output.txt
+    else ${EMULATOR} --semihosting ${OPTIONS} semihosting_wait.hex < /dev/null | sed -n 1,4p > output.txt; fi
+    cat emulator_out_memory_sample.hex >> output.txt
+    if cmp -s reference.txt output.txt; then
+        echo "semihosting wait ${OPTIONS}: OK"
+    else
+        echo "semihosting wait ${OPTIONS}: MISMATCH"
+        status=1
+    fi
+done
+rm -f semihosting_wait_native semihosting_wait_native.cpp
+
+# a parallel run of the assembler writes the same object files and prints the same reports as one run per source
+mkdir -p parallel
+for SOURCE in *.s; do ${ASSEMBLER} -o parallel/${SOURCE%.s}_reference.o ${SOURCE}; done > reference.txt
+${ASSEMBLER} -j 4 -o parallel *.s > output.txt
+for SOURCE in *.s; do
+    for SUFFIX in .o _text.o; do cmp -s parallel/${SOURCE%.s}_reference${SUFFIX} parallel/${SOURCE%.s}${SUFFIX} || echo ${SOURCE} >> output.txt; done
+done
+if cmp -s reference.txt output.txt; then
+    echo "assembler -j 4: OK"
+else
+    echo "assembler -j 4: MISMATCH"
+    status=1
+fi
+
+# input files that would write the same object file are rejected before anything is assembled
+mkdir -p parallel/copy && cp main.s parallel/copy/main.s && rm -f parallel/main.o
+if ! ${ASSEMBLER} -o parallel main.s parallel/copy/main.s > /dev/null && [ ! -e parallel/main.o ]; then
+    echo "assembler duplicate outputs: OK"
+else
+    echo "assembler duplicate outputs: MISMATCH"
+    status=1
+fi
+
+# the standard input (here a pipe) is assembled as the file itself
+cat main.s | ${ASSEMBLER} -o parallel/main.o - > /dev/null
+if cmp -s parallel/main_reference.o parallel/main.o && cmp -s parallel/main_reference_text.o parallel/main_text.o; then
+    echo "assembler stdin: OK"
+else
+    echo "assembler stdin: MISMATCH"
+    status=1
+fi
+rm -rf parallel
+rm -f reference.txt output.txt output.txt.tmp program.map
+exit ${status}
@@ -0,0 +1,225 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iterator>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "../inc/emulator.h"
+#include "../inc/image.h"
+
+using namespace std;
+
+/*
+    A program that embeds the emulator (lib/libemulator.a) - an image is run in parts through the library interface,
+    and every way of running it has to end in the state of a single run
+
+    expected format: './embed <image> [<terminal_input_file>]'
+*/
+
+static vector<unsigned char> image;
+static string inputPath;
+
+/* the final state of an emulation */
+struct State {
+    RUN_RESULT result;
+    short registers[NO_REGISTERS];
+    vector<unsigned char> memory;
+    unsigned long long instructionsRetired;
+    string output;
+};
+
+/* a device on the bus that only counts the accesses of its page */
+struct CountingDevice : BusDevice {
+    unsigned reads = 0, writes = 0;
+
+    short read(unsigned address, short value) override {
+        reads++;
+        return value;
+    }
+    void write(unsigned address, short &value) override { writes++; }
+};
+
+static bool sameState(const State &a, const State &b) {
+    for (unsigned i = 0; i < NO_REGISTERS; i++)
+        if (a.registers[i] != b.registers[i]) return false;
+    return a.result == b.result && a.memory == b.memory && a.output == b.output; // the JIT engine takes interrupts at block boundaries
+}
+
+/* loads the image from memory, 'runner' runs it (false - the runner has found a problem of its own) */
+static bool emulate(ENGINE engine, function<bool(Emulator &)> runner, State &state, function<void(Emulator &)> configure = nullptr) {
+    Emulator emulator(image.data(), image.size());
+    ostringstream output;
+    int input = inputPath != "" ? open(inputPath.c_str(), O_RDONLY) : -1;
+    emulator.setEngine(engine);
+    emulator.setOutputStream(&output);
+    emulator.setTerminalInput(input);
+    if (configure) configure(emulator);
+
+    bool succeeded = emulator.load() && runner(emulator);
+    if (input >= 0) close(input);
+
+    state.result = emulator.isHalted() ? RUN_RESULT::run_halted : RUN_RESULT::run_error;
+    for (unsigned i = 0; i < NO_REGISTERS; i++)
+        state.registers[i] = emulator.getRegister(i);
+    state.memory.resize(MEMORY_SIZE);
+    for (unsigned i = 0; i < MEMORY_SIZE; i++)
+        state.memory[i] = emulator.readMemoryByte(i);
+    state.instructionsRetired = emulator.getInstructionsRetired();
+    state.output = output.str();
+    return succeeded;
+}
+
+int main(int argc, const char *argv[]) {
+    if (argc < 2) {
+        cout << "Input file is not specified." << endl;
+        return -1;
+    }
+    string imagePath = argv[1];
+    if (argc > 2) inputPath = argv[2];
+
+    ifstream file(imagePath, ios::binary);
+    if (!file) {
+        cout << imagePath << " opening failed." << endl;
+        return -1;
+    }
+    image.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+
+    /* the reference - one run until halt */
+    State reference;
+    auto runToHalt = [](Emulator &e) { return e.run(~0ULL) == RUN_RESULT::run_halted; };
+    if (!emulate(ENGINE::switch_engine, runToHalt, reference)) {
+        cout << imagePath << ": the reference run did not halt" << endl;
+        return -1;
+    }
+
+    int status = 0;
+    auto check = [&](string name, bool passed) {
+        cout << imagePath << " " << name << ": " << (passed ? "OK" : "MISMATCH") << endl;
+        if (!passed) status = 1;
+    };
+    State state;
+
+    /* runs of 7 commands (that end in the middle of blocks) - each of them has to stop exactly at its budget */
+    const char *engineNames[] = {"switch", "threaded", "jit"};
+    for (ENGINE engine : {ENGINE::switch_engine, ENGINE::threaded_engine, ENGINE::jit_engine}) {
+        auto runInParts = [](Emulator &e) {
+            while (true) {
+                unsigned long long before = e.getInstructionsRetired();
+                RUN_RESULT result = e.run(7);
+                if (result == RUN_RESULT::run_halted) return true;
+                if (result != RUN_RESULT::run_limit || e.getInstructionsRetired() != before + 7) return false;
+            }
+        };
+        check(string("run(7) ") + engineNames[engine], emulate(engine, runInParts, state) && sameState(reference, state));
+    }
+
+    /* single steps (without idle loop skips, every step is one command) */
+    auto stepToHalt = [](Emulator &e) {
+        while (true) {
+            unsigned long long before = e.getInstructionsRetired();
+            RUN_RESULT result = e.step();
+            if (e.getInstructionsRetired() != before + 1) return false;
+            if (result == RUN_RESULT::run_halted) return true;
+            if (result != RUN_RESULT::run_limit) return false;
+        }
+    };
+    State unskipped;
+    auto noIdleSkip = [](Emulator &e) { e.setIdleLoopSkipEnabled(false); };
+    check("step()", emulate(ENGINE::switch_engine, runToHalt, unskipped, noIdleSkip)
+        && emulate(ENGINE::switch_engine, stepToHalt, state, noIdleSkip) && sameState(unskipped, state));
+
+    /* a breakpoint at the command the program executes after its 100th one */
+    unsigned breakpoint = 0;
+    State stepped;
+    emulate(ENGINE::switch_engine, [&](Emulator &e) {
+        e.run(100);
+        breakpoint = 0xFFFF & e.getRegister(R_INDEX::pc);
+        return true;
+    }, stepped);
+    auto runToBreakpoint = [&](Emulator &e) {
+        if (e.runUntil(breakpoint) != RUN_RESULT::run_address || (0xFFFF & e.getRegister(R_INDEX::pc)) != breakpoint) return false;
+        return e.getInstructionsRetired() <= 100 && e.run(~0ULL) == RUN_RESULT::run_halted;
+    };
+    check("runUntil()", emulate(ENGINE::switch_engine, runToBreakpoint, state) && sameState(reference, state));
+
+    /* callbacks that only watch - the terminal output is seen by the device callback */
+    string written = "";
+    unsigned interrupts = 0;
+    auto watch = [&](Emulator &e) {
+        e.setDeviceCallback([&](unsigned address, bool write, short &value) {
+            if (write && address == TERM_OUT_ADDRESS) written += (char)value;
+        });
+        e.setInterruptCallback([&](int entry) {
+            interrupts++;
+            return false;
+        });
+    };
+    check("callbacks", emulate(ENGINE::jit_engine, runToHalt, state, watch) && sameState(reference, state) && written == reference.output);
+
+    /* the page of the stack (below 0xFF00) mapped to a device that lets every access through */
+    CountingDevice stackDevice;
+    auto mapStack = [&](Emulator &e) { e.mapDevice(MMAP_REGISTERS_START_ADDRESS / MEMORY_PAGE_SIZE - 1, &stackDevice); };
+    check("bus device", emulate(ENGINE::jit_engine, runToHalt, state, mapStack) && sameState(reference, state));
+
+    /* structured errors */
+    Emulator broken(image.data(), 3);
+    broken.setTerminalInput(-1);
+    broken.setOutputStream(nullptr);
+    bool reported = !broken.load() && broken.getErrors().size() == 1 && broken.getErrors()[0].kind == ERROR_KIND::image_error;
+    check("errors", reported && broken.run(1) == RUN_RESULT::run_error);
+
+    /* a flat image of 'ldr r1, $5' and an invalid command at 0x100 - after the error, the snapshot runs again */
+    vector<unsigned char> flat(FLAT_IMAGE_SIZE, 0);
+    copy(FLAT_IMAGE_MAGIC, FLAT_IMAGE_MAGIC + FLAT_IMAGE_MAGIC_SIZE, flat.begin());
+    flat[FLAT_IMAGE_MAGIC_SIZE + 1] = 0x01; // IVT[0] = 0x0100
+    const unsigned char commands[] = {0xA0, 0x1F, 0x00, 0x00, 0x05, 0xFF};
+    copy(begin(commands), end(commands), flat.begin() + FLAT_IMAGE_MAGIC_SIZE + 0x100);
+    Emulator restored(flat.data(), flat.size());
+    restored.setEngine(ENGINE::threaded_engine);
+    restored.setTerminalInput(-1);
+    restored.setOutputStream(nullptr);
+    bool failedRun = restored.load() && (restored.takeSnapshot(), restored.runUntil(0x200) == RUN_RESULT::run_error);
+    check("restore after error", failedRun && restored.restoreSnapshot() && restored.run(1) == RUN_RESULT::run_limit && restored.getRegister(1) == 5);
+
+    /* registers past psw are refused with a state error (like any other error, it ends the emulation) */
+    Emulator indexed(image.data(), image.size());
+    indexed.setTerminalInput(-1);
+    indexed.setOutputStream(nullptr);
+    bool loadedIndexed = indexed.load();
+    indexed.setRegister(NO_REGISTERS, 0x1234);
+    bool refused = loadedIndexed && indexed.getRegister(NO_REGISTERS + 7) == 0 && indexed.getErrors().size() == 2;
+    for (const EmulatorError &error : indexed.getErrors())
+        refused = refused && error.kind == ERROR_KIND::state_error;
+    check("register index", refused && indexed.run(1) == RUN_RESULT::run_error);
+
+    /* words at the end of a RAM page reach the device of the following page - a mapped one and the terminal */
+    vector<unsigned char> crossing(FLAT_IMAGE_SIZE, 0);
+    copy(FLAT_IMAGE_MAGIC, FLAT_IMAGE_MAGIC + FLAT_IMAGE_MAGIC_SIZE, crossing.begin());
+    crossing[FLAT_IMAGE_MAGIC_SIZE + 1] = 0x01; // IVT[0] = 0x0100
+    const unsigned char crossingCommands[] = {
+        0xA0, 0x1F, 0x04, 0x12, 0xFF, // ldr r1, 0x12FF
+        0xB0, 0x1F, 0x04, 0x12, 0xFF, // str r1, 0x12FF
+        0xA0, 0x2F, 0x00, 0x41, 0x00, // ldr r2, $0x4100
+        0xB0, 0x2F, 0x04, 0xFE, 0xFF, // str r2, 0xFEFF (term_out gets 'A')
+        0x00};                        // halt
+    copy(begin(crossingCommands), end(crossingCommands), crossing.begin() + FLAT_IMAGE_MAGIC_SIZE + 0x100);
+    crossing[FLAT_IMAGE_MAGIC_SIZE + 0x12FF] = 0x34;
+    crossing[FLAT_IMAGE_MAGIC_SIZE + 0x1300] = 0x12;
+    for (ENGINE engine : {ENGINE::switch_engine, ENGINE::threaded_engine, ENGINE::jit_engine}) {
+        CountingDevice pageDevice;
+        Emulator crossed(crossing.data(), crossing.size());
+        ostringstream terminal;
+        crossed.setEngine(engine);
+        crossed.setTerminalInput(-1);
+        crossed.setOutputStream(&terminal);
+        crossed.mapDevice(0x13, &pageDevice);
+        bool halted = crossed.load() && crossed.run(~0ULL) == RUN_RESULT::run_halted;
+        bool seen = pageDevice.reads == 1 && pageDevice.writes == 1 && crossed.getRegister(1) == 0x1234;
+        check(string("page crossing ") + engineNames[engine], halted && seen && terminal.str().rfind("A", 0) == 0);
+    }
+
+    cout << imagePath << ": " << reference.instructionsRetired << " instructions, " << interrupts << " int commands, ";
+    cout << stackDevice.reads << " stack reads, " << stackDevice.writes << " stack writes" << endl;
+    return status;
+}
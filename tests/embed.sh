@@ -0,0 +1,15 @@
+ASSEMBLER=../assembler
+LINKER=../linker
+
+# a program linked with the emulator library runs the images in parts (see embed.cpp)
+g++ -O2 -o embed embed.cpp ../lib/libemulator.a -pthread || exit 1
+status=0
+for PROGRAM in flags fusion devices; do
+    ${ASSEMBLER} -o ${PROGRAM}.o ${PROGRAM}.s
+    ${LINKER} -hex -o ${PROGRAM}.hex ${PROGRAM}.o
+    INPUT=""
+    if [ -f ${PROGRAM}_input.txt ]; then INPUT=${PROGRAM}_input.txt; fi
+    ./embed ${PROGRAM}.hex ${INPUT} || status=1
+done
+rm -f embed
+exit ${status}
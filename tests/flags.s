@@ -0,0 +1,103 @@
+# file: flags.s
+# psw flags of cmp, test, shl and shr as seen by jumps, push psw, xchg and ldr/str with psw
+
+.section ivt
+.word flags_start
+.skip 2
+.word flags_isr
+.skip 10
+
+.section flags_code
+flags_start:
+  ldr r6, $0xFEFE
+  ldr r5, $0 # the number of taken jumps
+
+  # cmp followed by conditional jumps
+  ldr r0, $5
+  ldr r1, $7
+  cmp r0, r1
+  jeq flags_skip1
+  ldr r2, $1
+  add r5, r2
+flags_skip1:
+  cmp r1, r0
+  jgt flags_skip2
+  ldr r2, $2
+  add r5, r2
+flags_skip2:
+  ldr r0, $0x8000
+  ldr r1, $1
+  cmp r0, r1
+  push psw # flags of cmp with a negative and a positive operand
+  jgt flags_skip3
+  ldr r2, $4
+  add r5, r2
+flags_skip3:
+
+  # test leaves c and o flags of the previous cmp unchanged
+  ldr r0, $0x7FFF
+  ldr r1, $0x8000
+  cmp r0, r1
+  test r0, r1
+  push psw
+  jne flags_skip4
+  ldr r2, $8
+  add r5, r2
+flags_skip4:
+
+  # shl and shr set the carry flag, the overflow flag stays from cmp
+  ldr r0, $0xC001
+  ldr r1, $1
+  shl r0, r1
+  push psw
+  ldr r0, $0x0003
+  shr r0, r1
+  push psw
+  cmp r1, r0
+  ldr r3, $4
+  shl r0, r3
+  jeq flags_skip5
+  ldr r2, $16
+  add r5, r2
+flags_skip5:
+
+  # psw as an operand of xchg, ldr and str
+  ldr r0, $3
+  ldr r1, $3
+  cmp r0, r1
+  ldr r2, psw
+  xchg r3, psw
+  xchg r3, psw
+  str psw, flags_saved
+  test r0, r0
+  ldr r4, flags_saved
+  xor r4, r2
+
+  # flags saved by int and restored by iret
+  ldr r0, $0
+  ldr r1, $1
+  cmp r0, r1
+  ldr r0, $2
+  int r0
+  push psw
+
+  # results: r0-r3 <= pushed psw values, r4 == 0, r5 == taken jumps mask
+  pop r0
+  pop r1
+  pop r2
+  pop r3
+  pop r4
+  add r3, r4
+  pop r4
+  add r3, r4
+  ldr r4, flags_saved
+  halt
+
+flags_isr:
+  test r0, r0
+  iret
+
+.section flags_data
+flags_saved:
+.word 0
+.end
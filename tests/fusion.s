@@ -0,0 +1,54 @@
+# file: fusion.s
+# superinstructions (ldr/push/call, pop/ret, cmp/jcc) and a push that overwrites the call it is fused with
+
+.section ivt
+.word fusion_start
+.skip 14
+
+.section fusion_code
+fusion_start:
+  ldr r5, $0 # the sum of the values added by the subroutines
+  ldr r3, $4 # loop counter
+fusion_loop:
+  ldr r6, $0xFEFE
+  ldr r0, $3
+  push r0
+  call fusion_add
+  pop r0
+  ldr r0, $0
+  ldr r1, $1
+  cmp r3, r1
+  jne fusion_push
+  # last iteration: the stack is moved just behind the call, so the push replaces its target with fusion_sub2
+  ldr r6, $fusion_patched
+  ldr r0, $fusion_sub2
+  ldr r1, $8
+  shl r0, r1 # the payload of a command is big endian
+fusion_push:
+  push r0
+  call fusion_sub1
+fusion_patched:
+  ldr r6, $0xFEFE
+  ldr r1, $1
+  sub r3, r1
+  ldr r1, $0
+  cmp r3, r1
+  jne fusion_loop
+  halt
+
+fusion_add:
+  push r1
+  ldr r1, [r6 + 4]
+  add r5, r1
+  pop r1
+  ret
+fusion_sub1:
+  ldr r1, $1
+  add r5, r1
+  ret
+fusion_sub2:
+  ldr r1, $16
+  add r5, r1
+  ret
+
+.end
@@ -0,0 +1,107 @@
+# file: image_64k.s
+# a linked image of exactly 64KB - 32 segment headers and 65276 bytes of sections, so the emulator has to tell it from
+# a flat image by its format, not by its size
+# the final state: r1 = 0x1234, r2 = 0x5678 (a word at the end of the last section)
+
+.section ivt
+.word image_start
+.skip 14
+
+.section image_code
+image_start:
+  ldr r1, $0x1234
+  ldr r2, image_end
+  halt
+
+.section image_fill_0
+.skip 2048
+
+.section image_fill_1
+.skip 2048
+
+.section image_fill_2
+.skip 2048
+
+.section image_fill_3
+.skip 2048
+
+.section image_fill_4
+.skip 2048
+
+.section image_fill_5
+.skip 2048
+
+.section image_fill_6
+.skip 2048
+
+.section image_fill_7
+.skip 2048
+
+.section image_fill_8
+.skip 2048
+
+.section image_fill_9
+.skip 2048
+
+.section image_fill_10
+.skip 2048
+
+.section image_fill_11
+.skip 2048
+
+.section image_fill_12
+.skip 2048
+
+.section image_fill_13
+.skip 2048
+
+.section image_fill_14
+.skip 2048
+
+.section image_fill_15
+.skip 2048
+
+.section image_fill_16
+.skip 2048
+
+.section image_fill_17
+.skip 2048
+
+.section image_fill_18
+.skip 2048
+
+.section image_fill_19
+.skip 2048
+
+.section image_fill_20
+.skip 2048
+
+.section image_fill_21
+.skip 2048
+
+.section image_fill_22
+.skip 2048
+
+.section image_fill_23
+.skip 2048
+
+.section image_fill_24
+.skip 2048
+
+.section image_fill_25
+.skip 2048
+
+.section image_fill_26
+.skip 2048
+
+.section image_fill_27
+.skip 2048
+
+.section image_fill_28
+.skip 2048
+
+.section image_fill_29
+.skip 5855
+image_end:
+.word 0x5678
+.end
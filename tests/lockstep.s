@@ -0,0 +1,47 @@
+# file: lockstep.s
+# the same program on different inputs (r1, r2 and the word at 0xF000, see lockstep_inputs.txt)
+
+.section ivt
+.word lockstep_start
+.skip 14
+
+.section lockstep_code
+lockstep_start:
+  ldr r6, $0xFEFE
+  ldr r0, 0xF000
+  ldr r3, $8 # loop counter
+  ldr r5, $1
+lockstep_loop:
+  add r0, r1
+  xor r0, r2
+  ldr r4, r0
+  not r4
+  and r4, r2
+  or r0, r4
+  push r0
+  call lockstep_mix
+  pop r0
+  sub r3, r5
+  ldr r4, $0
+  cmp r3, r4
+  jne lockstep_loop
+
+  # only the instances with r1 > r2 skip the exchange
+  cmp r1, r2
+  jgt lockstep_end
+  ldr r4, $0x10
+  xchg r0, r4
+  mul r4, r2
+lockstep_end:
+  test r0, r1
+  str r0, 0xF002
+  halt
+
+lockstep_mix:
+  shl r1, r5
+  ldr r4, $0x0F
+  and r1, r4
+  add r1, r5
+  ret
+
+.end
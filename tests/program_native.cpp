@@ -0,0 +1,439 @@
+// program.hex translated ahead of time by the translator (do not edit)
+#include "inc/aot.h"
+
+static int block_0010(AotContext &c) {
+    short *r = c.registers;
+    // 0x0010: push r1 - b0 16 12
+    AOT_RETIRE();
+    r[6] -= 2;
+    if (int exitCode = AotRuntime::store(c, 0xFFFF & r[6], r[1])) {
+        r[R_INDEX::pc] = 0x0013;
+        return exitCode - 1;
+    }
+    AOT_EVENTS(0x0013);
+    // 0x0013: ldr r0, [r6 + 0x0004] - a0 06 03 00 04
+    AOT_RETIRE();
+    r[0] = AotRuntime::load(c, 0xFFFF & (r[6] + (short)0x0004));
+    AOT_EVENTS(0x0018);
+    // 0x0018: ldr r1, [r6 + 0x0006] - a0 16 03 00 06
+    AOT_RETIRE();
+    r[1] = AotRuntime::load(c, 0xFFFF & (r[6] + (short)0x0006));
+    AOT_EVENTS(0x001d);
+    // 0x001d: add r0, r1 - 70 01
+    AOT_RETIRE();
+    r[0] += r[1];
+    AOT_EVENTS(0x001f);
+    // 0x001f: pop r1 - a0 16 42
+    AOT_RETIRE();
+    r[1] = AotRuntime::load(c, 0xFFFF & r[6]);
+    r[6] += 2;
+    AOT_EVENTS(0x0022);
+    // 0x0022: ret - 40
+    AOT_RETIRE();
+    r[R_INDEX::pc] = AotRuntime::load(c, 0xFFFF & r[R_INDEX::sp]);
+    r[R_INDEX::sp] += 2;
+    return AOT_EXIT_CONTINUE;
+}
+
+static int block_005c(AotContext &c) {
+    short *r = c.registers;
+    // 0x005c: ldr r6, $0xfefe - a0 6f 00 fe fe
+    AOT_RETIRE();
+    r[6] = (short)0xfefe;
+    AOT_EVENTS(0x0061);
+    // 0x0061: ldr r0, $0x0004 - a0 0f 00 00 04
+    AOT_RETIRE();
+    r[0] = (short)0x0004;
+    AOT_EVENTS(0x0066);
+    // 0x0066: int r0 - 10 0f
+    AOT_RETIRE();
+    if (int exitCode = AotRuntime::execute(c, 0x0066)) return exitCode - 1;
+    return AOT_EXIT_CONTINUE;
+}
+
+static int block_0068(AotContext &c) {
+    short *r = c.registers;
+    // 0x0068: ldr r0, $0x0000 - a0 0f 00 00 00
+    AOT_RETIRE();
+    r[0] = (short)0x0000;
+    AOT_EVENTS(0x006d);
+    // 0x006d: push r0 - b0 06 12
+    AOT_RETIRE();
+    r[6] -= 2;
+    if (int exitCode = AotRuntime::store(c, 0xFFFF & r[6], r[0])) {
+        r[R_INDEX::pc] = 0x0070;
+        return exitCode - 1;
+    }
+    AOT_EVENTS(0x0070);
+    // 0x0070: ldr r0, $0x0001 - a0 0f 00 00 01
+    AOT_RETIRE();
+    r[0] = (short)0x0001;
+    AOT_EVENTS(0x0075);
+    // 0x0075: push r0 - b0 06 12
+    AOT_RETIRE();
+    r[6] -= 2;
+    if (int exitCode = AotRuntime::store(c, 0xFFFF & r[6], r[0])) {
+        r[R_INDEX::pc] = 0x0078;
+        return exitCode - 1;
+    }
+    AOT_EVENTS(0x0078);
+    // 0x0078: call 0x0010 - 30 ff 00 00 10
+    AOT_RETIRE();
+    r[R_INDEX::sp] -= 2;
+    AotRuntime::store(c, 0xFFFF & r[R_INDEX::sp], (short)0x007d);
+    r[R_INDEX::pc] = 0x0010;
+    return AOT_EXIT_CONTINUE;
+}
+
+static int block_007d(AotContext &c) {
+    short *r = c.registers;
+    // 0x007d: str r0, 0x012c - b0 0f 04 01 2c
+    AOT_RETIRE();
+    if (int exitCode = AotRuntime::store(c, 0x012c, r[0])) {
+        r[R_INDEX::pc] = 0x0082;
+        return exitCode - 1;
+    }
+    AOT_EVENTS(0x0082);
+    // 0x0082: ldr r0, $0x0001 - a0 0f 00 00 01
+    AOT_RETIRE();
+    r[0] = (short)0x0001;
+    AOT_EVENTS(0x0087);
+    // 0x0087: push r0 - b0 06 12
+    AOT_RETIRE();
+    r[6] -= 2;
+    if (int exitCode = AotRuntime::store(c, 0xFFFF & r[6], r[0])) {
+        r[R_INDEX::pc] = 0x008a;
+        return exitCode - 1;
+    }
+    AOT_EVENTS(0x008a);
+    // 0x008a: ldr r0, $0x0001 - a0 0f 00 00 01
+    AOT_RETIRE();
+    r[0] = (short)0x0001;
+    AOT_EVENTS(0x008f);
+    // 0x008f: push r0 - b0 06 12
+    AOT_RETIRE();
+    r[6] -= 2;
+    if (int exitCode = AotRuntime::store(c, 0xFFFF & r[6], r[0])) {
+        r[R_INDEX::pc] = 0x0092;
+        return exitCode - 1;
+    }
+    AOT_EVENTS(0x0092);
+    // 0x0092: call %0x0010 - 30 f7 05 ff 79
+    AOT_RETIRE();
+    r[R_INDEX::sp] -= 2;
+    AotRuntime::store(c, 0xFFFF & r[R_INDEX::sp], (short)0x0097);
+    r[R_INDEX::pc] = 0x0010;
+    return AOT_EXIT_CONTINUE;
+}
+
+static int block_0097(AotContext &c) {
+    short *r = c.registers;
+    // 0x0097: str r0, 0x012e - b0 0f 04 01 2e
+    AOT_RETIRE();
+    if (int exitCode = AotRuntime::store(c, 0x012e, r[0])) {
+        r[R_INDEX::pc] = 0x009c;
+        return exitCode - 1;
+    }
+    AOT_EVENTS(0x009c);
+    // 0x009c: ldr r0, $0x0008 - a0 0f 00 00 08
+    AOT_RETIRE();
+    r[0] = (short)0x0008;
+    AOT_EVENTS(0x00a1);
+    // 0x00a1: push r0 - b0 06 12
+    AOT_RETIRE();
+    r[6] -= 2;
+    if (int exitCode = AotRuntime::store(c, 0xFFFF & r[6], r[0])) {
+        r[R_INDEX::pc] = 0x00a4;
+        return exitCode - 1;
+    }
+    AOT_EVENTS(0x00a4);
+    // 0x00a4: ldr r0, $0x000b - a0 0f 00 00 0b
+    AOT_RETIRE();
+    r[0] = (short)0x000b;
+    AOT_EVENTS(0x00a9);
+    // 0x00a9: push r0 - b0 06 12
+    AOT_RETIRE();
+    r[6] -= 2;
+    if (int exitCode = AotRuntime::store(c, 0xFFFF & r[6], r[0])) {
+        r[R_INDEX::pc] = 0x00ac;
+        return exitCode - 1;
+    }
+    AOT_EVENTS(0x00ac);
+    // 0x00ac: ldr r0, $0x0002 - a0 0f 00 00 02
+    AOT_RETIRE();
+    r[0] = (short)0x0002;
+    AOT_EVENTS(0x00b1);
+    // 0x00b1: ldr r1, $0x0138 - a0 1f 00 01 38
+    AOT_RETIRE();
+    r[1] = (short)0x0138;
+    AOT_EVENTS(0x00b6);
+    // 0x00b6: add r0, r1 - 70 01
+    AOT_RETIRE();
+    r[0] += r[1];
+    AOT_EVENTS(0x00b8);
+    // 0x00b8: call *[r0] - 30 f0 02
+    AOT_RETIRE();
+    if (int exitCode = AotRuntime::execute(c, 0x00b8)) return exitCode - 1;
+    return AOT_EXIT_CONTINUE;
+}
+
+static int block_00bb(AotContext &c) {
+    short *r = c.registers;
+    // 0x00bb: str r0, 0x0130 - b0 0f 04 01 30
+    AOT_RETIRE();
+    if (int exitCode = AotRuntime::store(c, 0x0130, r[0])) {
+        r[R_INDEX::pc] = 0x00c0;
+        return exitCode - 1;
+    }
+    AOT_EVENTS(0x00c0);
+    // 0x00c0: ldr r0, $0x0002 - a0 0f 00 00 02
+    AOT_RETIRE();
+    r[0] = (short)0x0002;
+    AOT_EVENTS(0x00c5);
+    // 0x00c5: push r0 - b0 06 12
+    AOT_RETIRE();
+    r[6] -= 2;
+    if (int exitCode = AotRuntime::store(c, 0xFFFF & r[6], r[0])) {
+        r[R_INDEX::pc] = 0x00c8;
+        return exitCode - 1;
+    }
+    AOT_EVENTS(0x00c8);
+    // 0x00c8: ldr r0, $0x0002 - a0 0f 00 00 02
+    AOT_RETIRE();
+    r[0] = (short)0x0002;
+    AOT_EVENTS(0x00cd);
+    // 0x00cd: push r0 - b0 06 12
+    AOT_RETIRE();
+    r[6] -= 2;
+    if (int exitCode = AotRuntime::store(c, 0xFFFF & r[6], r[0])) {
+        r[R_INDEX::pc] = 0x00d0;
+        return exitCode - 1;
+    }
+    AOT_EVENTS(0x00d0);
+    // 0x00d0: ldr r0, $0x0004 - a0 0f 00 00 04
+    AOT_RETIRE();
+    r[0] = (short)0x0004;
+    AOT_EVENTS(0x00d5);
+    // 0x00d5: call *[r0 + 0x0138] - 30 f0 03 01 38
+    AOT_RETIRE();
+    if (int exitCode = AotRuntime::execute(c, 0x00d5)) return exitCode - 1;
+    return AOT_EXIT_CONTINUE;
+}
+
+static int block_00da(AotContext &c) {
+    short *r = c.registers;
+    // 0x00da: str r0, 0x0132 - b0 0f 04 01 32
+    AOT_RETIRE();
+    if (int exitCode = AotRuntime::store(c, 0x0132, r[0])) {
+        r[R_INDEX::pc] = 0x00df;
+        return exitCode - 1;
+    }
+    AOT_EVENTS(0x00df);
+    // 0x00df: ldr r0, $0x0005 - a0 0f 00 00 05
+    AOT_RETIRE();
+    r[0] = (short)0x0005;
+    AOT_EVENTS(0x00e4);
+    // 0x00e4: push r0 - b0 06 12
+    AOT_RETIRE();
+    r[6] -= 2;
+    if (int exitCode = AotRuntime::store(c, 0xFFFF & r[6], r[0])) {
+        r[R_INDEX::pc] = 0x00e7;
+        return exitCode - 1;
+    }
+    AOT_EVENTS(0x00e7);
+    // 0x00e7: ldr r0, $0x0019 - a0 0f 00 00 19
+    AOT_RETIRE();
+    r[0] = (short)0x0019;
+    AOT_EVENTS(0x00ec);
+    // 0x00ec: push r0 - b0 06 12
+    AOT_RETIRE();
+    r[6] -= 2;
+    if (int exitCode = AotRuntime::store(c, 0xFFFF & r[6], r[0])) {
+        r[R_INDEX::pc] = 0x00ef;
+        return exitCode - 1;
+    }
+    AOT_EVENTS(0x00ef);
+    // 0x00ef: ldr r0, $0x0006 - a0 0f 00 00 06
+    AOT_RETIRE();
+    r[0] = (short)0x0006;
+    AOT_EVENTS(0x00f4);
+    // 0x00f4: ldr r1, $0x0138 - a0 1f 00 01 38
+    AOT_RETIRE();
+    r[1] = (short)0x0138;
+    AOT_EVENTS(0x00f9);
+    // 0x00f9: add r0, r1 - 70 01
+    AOT_RETIRE();
+    r[0] += r[1];
+    AOT_EVENTS(0x00fb);
+    // 0x00fb: ldr r0, [r0] - a0 00 02
+    AOT_RETIRE();
+    r[0] = AotRuntime::load(c, 0xFFFF & r[0]);
+    AOT_EVENTS(0x00fe);
+    // 0x00fe: call *r0 - 30 f0 01
+    AOT_RETIRE();
+    if (int exitCode = AotRuntime::execute(c, 0x00fe)) return exitCode - 1;
+    return AOT_EXIT_CONTINUE;
+}
+
+static int block_0101(AotContext &c) {
+    short *r = c.registers;
+    // 0x0101: str r0, 0x0134 - b0 0f 04 01 34
+    AOT_RETIRE();
+    if (int exitCode = AotRuntime::store(c, 0x0134, r[0])) {
+        r[R_INDEX::pc] = 0x0106;
+        return exitCode - 1;
+    }
+    AOT_EVENTS(0x0106);
+    // 0x0106: ldr r0, 0x012a - a0 0f 04 01 2a
+    AOT_RETIRE();
+    r[0] = AotRuntime::load(c, 0x012a);
+    AOT_EVENTS(0x010b);
+    // 0x010b: ldr r1, 0x012c - a0 1f 04 01 2c
+    AOT_RETIRE();
+    r[1] = AotRuntime::load(c, 0x012c);
+    AOT_EVENTS(0x0110);
+    // 0x0110: ldr r2, 0x012e - a0 2f 04 01 2e
+    AOT_RETIRE();
+    r[2] = AotRuntime::load(c, 0x012e);
+    AOT_EVENTS(0x0115);
+    // 0x0115: ldr r3, 0x0130 - a0 3f 04 01 30
+    AOT_RETIRE();
+    r[3] = AotRuntime::load(c, 0x0130);
+    AOT_EVENTS(0x011a);
+    // 0x011a: ldr r4, 0x0132 - a0 4f 04 01 32
+    AOT_RETIRE();
+    r[4] = AotRuntime::load(c, 0x0132);
+    AOT_EVENTS(0x011f);
+    // 0x011f: ldr r5, 0x0134 - a0 5f 04 01 34
+    AOT_RETIRE();
+    r[5] = AotRuntime::load(c, 0x0134);
+    AOT_EVENTS(0x0124);
+    // 0x0124: ldr r6, 0x0136 - a0 6f 04 01 36
+    AOT_RETIRE();
+    r[6] = AotRuntime::load(c, 0x0136);
+    AOT_EVENTS(0x0129);
+    // 0x0129: halt - 00
+    AOT_RETIRE();
+    r[R_INDEX::pc] = 0x012a;
+    return AOT_EXIT_HALT;
+}
+
+static int block_0140(AotContext &c) {
+    short *r = c.registers;
+    // 0x0140: jmp 0x005c - 50 ff 00 00 5c
+    AOT_RETIRE();
+    r[R_INDEX::pc] = 0x005c;
+    AotRuntime::backwardJump(c, 0x0145);
+    return AOT_EXIT_CONTINUE;
+}
+
+static int block_0145(AotContext &c) {
+    short *r = c.registers;
+    // 0x0145: iret - 20
+    AOT_RETIRE();
+    if (int exitCode = AotRuntime::execute(c, 0x0145)) return exitCode - 1;
+    return AOT_EXIT_CONTINUE;
+}
+
+static int block_0146(AotContext &c) {
+    short *r = c.registers;
+    // 0x0146: iret - 20
+    AOT_RETIRE();
+    if (int exitCode = AotRuntime::execute(c, 0x0146)) return exitCode - 1;
+    return AOT_EXIT_CONTINUE;
+}
+
+static int block_0147(AotContext &c) {
+    short *r = c.registers;
+    // 0x0147: push r0 - b0 06 12
+    AOT_RETIRE();
+    r[6] -= 2;
+    if (int exitCode = AotRuntime::store(c, 0xFFFF & r[6], r[0])) {
+        r[R_INDEX::pc] = 0x014a;
+        return exitCode - 1;
+    }
+    AOT_EVENTS(0x014a);
+    // 0x014a: push r1 - b0 16 12
+    AOT_RETIRE();
+    r[6] -= 2;
+    if (int exitCode = AotRuntime::store(c, 0xFFFF & r[6], r[1])) {
+        r[R_INDEX::pc] = 0x014d;
+        return exitCode - 1;
+    }
+    AOT_EVENTS(0x014d);
+    // 0x014d: ldr r0, $0xabcd - a0 0f 00 ab cd
+    AOT_RETIRE();
+    r[0] = (short)0xabcd;
+    AOT_EVENTS(0x0152);
+    // 0x0152: ldr r1, $0x012a - a0 1f 00 01 2a
+    AOT_RETIRE();
+    r[1] = (short)0x012a;
+    AOT_EVENTS(0x0157);
+    // 0x0157: str r0, [r1] - b0 01 02
+    AOT_RETIRE();
+    if (int exitCode = AotRuntime::store(c, 0xFFFF & r[1], r[0])) {
+        r[R_INDEX::pc] = 0x015a;
+        return exitCode - 1;
+    }
+    AOT_EVENTS(0x015a);
+    // 0x015a: pop r1 - a0 16 42
+    AOT_RETIRE();
+    r[1] = AotRuntime::load(c, 0xFFFF & r[6]);
+    r[6] += 2;
+    AOT_EVENTS(0x015d);
+    // 0x015d: pop r0 - a0 06 42
+    AOT_RETIRE();
+    r[0] = AotRuntime::load(c, 0xFFFF & r[6]);
+    r[6] += 2;
+    AOT_EVENTS(0x0160);
+    // 0x0160: iret - 20
+    AOT_RETIRE();
+    if (int exitCode = AotRuntime::execute(c, 0x0160)) return exitCode - 1;
+    return AOT_EXIT_CONTINUE;
+}
+
+static const unsigned char image[] = {
+    0x05, 0x00, 0x00, 0x00, 0x10, 0x00, 0x00, 0x00, 0x40, 0x01, 0x00, 0x00, 0x46, 0x01, 0x45, 0x01,
+    0x47, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x4c, 0x00, 0x00, 0x00,
+    0xb0, 0x16, 0x12, 0xa0, 0x06, 0x03, 0x00, 0x04, 0xa0, 0x16, 0x03, 0x00, 0x06, 0x70, 0x01, 0xa0,
+    0x16, 0x42, 0x40, 0xb0, 0x16, 0x12, 0xa0, 0x06, 0x03, 0x00, 0x04, 0xa0, 0x16, 0x03, 0x00, 0x06,
+    0x71, 0x01, 0xa0, 0x16, 0x42, 0x40, 0xb0, 0x16, 0x12, 0xa0, 0x06, 0x03, 0x00, 0x04, 0xa0, 0x16,
+    0x03, 0x00, 0x06, 0x72, 0x01, 0xa0, 0x16, 0x42, 0x40, 0xb0, 0x16, 0x12, 0xa0, 0x06, 0x03, 0x00,
+    0x04, 0xa0, 0x16, 0x03, 0x00, 0x06, 0x73, 0x01, 0xa0, 0x16, 0x42, 0x40, 0x10, 0x00, 0x00, 0x00,
+    0xce, 0x00, 0x00, 0x00, 0xa0, 0x6f, 0x00, 0xfe, 0xfe, 0xa0, 0x0f, 0x00, 0x00, 0x04, 0x10, 0x0f,
+    0xa0, 0x0f, 0x00, 0x00, 0x00, 0xb0, 0x06, 0x12, 0xa0, 0x0f, 0x00, 0x00, 0x01, 0xb0, 0x06, 0x12,
+    0x30, 0xff, 0x00, 0x00, 0x10, 0xb0, 0x0f, 0x04, 0x01, 0x2c, 0xa0, 0x0f, 0x00, 0x00, 0x01, 0xb0,
+    0x06, 0x12, 0xa0, 0x0f, 0x00, 0x00, 0x01, 0xb0, 0x06, 0x12, 0x30, 0xf7, 0x05, 0xff, 0x79, 0xb0,
+    0x0f, 0x04, 0x01, 0x2e, 0xa0, 0x0f, 0x00, 0x00, 0x08, 0xb0, 0x06, 0x12, 0xa0, 0x0f, 0x00, 0x00,
+    0x0b, 0xb0, 0x06, 0x12, 0xa0, 0x0f, 0x00, 0x00, 0x02, 0xa0, 0x1f, 0x00, 0x01, 0x38, 0x70, 0x01,
+    0x30, 0xf0, 0x02, 0xb0, 0x0f, 0x04, 0x01, 0x30, 0xa0, 0x0f, 0x00, 0x00, 0x02, 0xb0, 0x06, 0x12,
+    0xa0, 0x0f, 0x00, 0x00, 0x02, 0xb0, 0x06, 0x12, 0xa0, 0x0f, 0x00, 0x00, 0x04, 0x30, 0xf0, 0x03,
+    0x01, 0x38, 0xb0, 0x0f, 0x04, 0x01, 0x32, 0xa0, 0x0f, 0x00, 0x00, 0x05, 0xb0, 0x06, 0x12, 0xa0,
+    0x0f, 0x00, 0x00, 0x19, 0xb0, 0x06, 0x12, 0xa0, 0x0f, 0x00, 0x00, 0x06, 0xa0, 0x1f, 0x00, 0x01,
+    0x38, 0x70, 0x01, 0xa0, 0x00, 0x02, 0x30, 0xf0, 0x01, 0xb0, 0x0f, 0x04, 0x01, 0x34, 0xa0, 0x0f,
+    0x04, 0x01, 0x2a, 0xa0, 0x1f, 0x04, 0x01, 0x2c, 0xa0, 0x2f, 0x04, 0x01, 0x2e, 0xa0, 0x3f, 0x04,
+    0x01, 0x30, 0xa0, 0x4f, 0x04, 0x01, 0x32, 0xa0, 0x5f, 0x04, 0x01, 0x34, 0xa0, 0x6f, 0x04, 0x01,
+    0x36, 0x00, 0x5c, 0x00, 0x00, 0x00, 0x16, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x23, 0x00, 0x36, 0x00, 0x49, 0x00,
+    0x2a, 0x01, 0x00, 0x00, 0x21, 0x00, 0x00, 0x00, 0x50, 0xff, 0x00, 0x00, 0x5c, 0x20, 0x20, 0xb0,
+    0x06, 0x12, 0xb0, 0x16, 0x12, 0xa0, 0x0f, 0x00, 0xab, 0xcd, 0xa0, 0x1f, 0x00, 0x01, 0x2a, 0xb0,
+    0x01, 0x02, 0xa0, 0x16, 0x42, 0xa0, 0x06, 0x42, 0x20, 0x40, 0x01, 0x00, 0x00,
+};
+
+static const AotBlock blocks[] = {
+    {0x0010, 19, "\xb0\x16\x12\xa0\x06\x03\x00\x04\xa0\x16\x03\x00\x06\x70\x01\xa0\x16\x42\x40", block_0010},
+    {0x005c, 12, "\xa0\x6f\x00\xfe\xfe\xa0\x0f\x00\x00\x04\x10\x0f", block_005c},
+    {0x0068, 21, "\xa0\x0f\x00\x00\x00\xb0\x06\x12\xa0\x0f\x00\x00\x01\xb0\x06\x12\x30\xff\x00\x00\x10", block_0068},
+    {0x007d, 26, "\xb0\x0f\x04\x01\x2c\xa0\x0f\x00\x00\x01\xb0\x06\x12\xa0\x0f\x00\x00\x01\xb0\x06\x12\x30\xf7\x05\xff\x79", block_007d},
+    {0x0097, 36, "\xb0\x0f\x04\x01\x2e\xa0\x0f\x00\x00\x08\xb0\x06\x12\xa0\x0f\x00\x00\x0b\xb0\x06\x12\xa0\x0f\x00\x00\x02\xa0\x1f\x00\x01\x38\x70\x01\x30\xf0\x02", block_0097},
+    {0x00bb, 31, "\xb0\x0f\x04\x01\x30\xa0\x0f\x00\x00\x02\xb0\x06\x12\xa0\x0f\x00\x00\x02\xb0\x06\x12\xa0\x0f\x00\x00\x04\x30\xf0\x03\x01\x38", block_00bb},
+    {0x00da, 39, "\xb0\x0f\x04\x01\x32\xa0\x0f\x00\x00\x05\xb0\x06\x12\xa0\x0f\x00\x00\x19\xb0\x06\x12\xa0\x0f\x00\x00\x06\xa0\x1f\x00\x01\x38\x70\x01\xa0\x00\x02\x30\xf0\x01", block_00da},
+    {0x0101, 41, "\xb0\x0f\x04\x01\x34\xa0\x0f\x04\x01\x2a\xa0\x1f\x04\x01\x2c\xa0\x2f\x04\x01\x2e\xa0\x3f\x04\x01\x30\xa0\x4f\x04\x01\x32\xa0\x5f\x04\x01\x34\xa0\x6f\x04\x01\x36\x00", block_0101},
+    {0x0140, 5, "\x50\xff\x00\x00\x5c", block_0140},
+    {0x0145, 1, "\x20", block_0145},
+    {0x0146, 1, "\x20", block_0146},
+    {0x0147, 26, "\xb0\x06\x12\xb0\x16\x12\xa0\x0f\x00\xab\xcd\xa0\x1f\x00\x01\x2a\xb0\x01\x02\xa0\x16\x42\xa0\x06\x42\x20", block_0147},
+};
+
+static const AotProgram program = {"program.hex", image, sizeof(image), blocks, sizeof(blocks) / sizeof(blocks[0])};
+static bool registered = AotRuntime::registerProgram(&program);
@@ -0,0 +1,149 @@
+# file: semihosting.s
+# semihosting (--semihosting): a message is printed and written to a file with one int each, the file is read back and the host clock is read
+# transfers longer than 0x7FFF bytes are cut to 0x7FFF (a 64KB file is written in two parts and read back by one request)
+# the final state: r0 = 1 (the clock did not go back), r1-r3 = 12 (bytes written), r4 = 24 (bytes read back), r5 = 0 (differing words and
+# long transfers of another length), z = 1
+
+.section ivt
+.word semihosting_start
+.skip 14
+
+.section semihosting_code
+semihosting_start:
+  ldr r0, $7 # IVT entry of the semihosting requests
+  ldr r3, $message
+  ldr r4, $message_end
+  sub r4, r3 # the message length
+
+  ldr r1, $1 # write to the terminal output
+  ldr r2, $0
+  int r0
+  str r1, written_terminal
+
+  ldr r1, $1 # write to the file
+  ldr r2, $path
+  int r0
+  str r1, written_file
+
+  ldr r1, $2 # append to the file
+  int r0
+  str r1, appended_file
+
+  ldr r1, $3 # read the file back
+  ldr r3, $buffer
+  ldr r4, $32
+  int r0
+  str r1, read_file
+
+  ldr r1, $1 # a buffer that wraps around the end of memory is refused
+  ldr r2, $0
+  ldr r3, $0xFFF0
+  ldr r4, $0x20
+  int r0
+  str r1, refused
+
+  ldr r1, $1 # a long transfer - 0x7FFF bytes of (zeroed) memory are written twice and read back at once
+  ldr r2, $long_path
+  ldr r3, $0x4000
+  ldr r4, $0xA000
+  int r0
+  str r1, long_written
+  ldr r1, $2
+  int r0
+  str r1, long_appended
+  ldr r1, $3
+  int r0
+  str r1, long_read
+
+  # the file holds the message twice
+  ldr r0, $12 # words
+  ldr r1, $buffer
+  ldr r2, $message
+  ldr r5, $0 # differing words
+  ldr r3, $0x7FFF # the length of a long transfer
+  ldr r4, long_written
+  cmp r3, r4
+  jeq long_written_ok
+  ldr r5, $1
+long_written_ok:
+  ldr r4, long_appended
+  cmp r3, r4
+  jeq long_appended_ok
+  ldr r5, $1
+long_appended_ok:
+  ldr r4, long_read
+  cmp r3, r4
+  jeq compare_word
+  ldr r5, $1
+compare_word:
+  ldr r3, [r1]
+  ldr r4, [r2]
+  cmp r3, r4
+  jeq same_word
+  ldr r3, $1
+  add r5, r3
+same_word:
+  ldr r3, $2
+  add r1, r3
+  add r2, r3
+  ldr r3, $message_end
+  cmp r2, r3
+  jne next_word
+  ldr r2, $message
+next_word:
+  ldr r3, $1
+  sub r0, r3
+  ldr r3, $0
+  cmp r0, r3
+  jne compare_word
+
+  # two readings of the host clock (their lower words are enough for a short interval)
+  ldr r0, $7
+  ldr r1, $4
+  int r0
+  ldr r3, r1
+  ldr r1, $4
+  int r0
+  sub r1, r3
+  ldr r3, $0
+  ldr r0, $1
+  cmp r1, r3
+  jgt clock_read
+  jeq clock_read
+  ldr r0, $0
+clock_read:
+  ldr r1, written_terminal
+  ldr r2, written_file
+  ldr r3, appended_file
+  ldr r4, read_file
+  test r5, r5 # psw does not depend on the clock
+  halt
+
+.section semihosting_data
+message: # "semihosting\n"
+.word 0x6573, 0x696D, 0x6F68, 0x7473, 0x6E69, 0x0A67
+message_end:
+path: # "semihosting.txt"
+.word 0x6573, 0x696D, 0x6F68, 0x7473, 0x6E69, 0x2E67, 0x7874, 0x0074
+written_terminal:
+.word 0
+written_file:
+.word 0
+appended_file:
+.word 0
+read_file:
+.word 0
+refused:
+.word 0
+long_path: # "semihosting.bin"
+.word 0x6573, 0x696D, 0x6F68, 0x7473, 0x6E69, 0x2E67, 0x6962, 0x006E
+long_written:
+.word 0
+long_appended:
+.word 0
+long_read:
+.word 0
+buffer:
+.skip 32
+
+.end
@@ -0,0 +1,39 @@
+# file: semihosting_wait.s
+# semihosting (--semihosting): a loop prints a dot with every iteration while it waits for the first timer tick, so the
+# printed dots show that no iteration is skipped as idle (a request has an effect outside of the registers and memory)
+
+.section ivt
+.word wait_start
+.skip 2
+.word wait_tick
+.skip 10
+
+.section wait_code
+wait_start:
+  ldr r0, $0
+  str r0, 0xFF10 # tim_cfg: 500ms
+  ldr psw, $0 # the timer is not masked anymore
+wait_loop:
+  ldr r0, $7 # IVT entry of the semihosting requests
+  ldr r1, $1 # write to the terminal output
+  ldr r2, $0
+  ldr r3, $dot
+  ldr r4, $1
+  int r0
+  ldr r5, ticked
+  cmp r5, r2
+  jeq wait_loop
+  halt
+
+wait_tick:
+  push r5
+  ldr r5, $1
+  str r5, ticked
+  pop r5
+  iret
+
+dot:
+.word 0x2E
+ticked:
+.word 0
+.end
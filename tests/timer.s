@@ -0,0 +1,29 @@
+# file: timer.s
+# the timer is started a few commands into the program and a loop counts until the first tick halts it, so the count
+# shows the exact cycle of the interrupt
+
+.section ivt
+.word timer_start
+.skip 2
+.word timer_tick
+.skip 10
+
+.section timer_code
+timer_start:
+  ldr r6, $0xFEFE
+  ldr r0, $0
+  ldr r1, $1
+  add r0, r1
+  add r0, r1
+  add r0, r1
+  ldr r0, $0
+  str r0, 0xFF10 # tim_cfg: 500ms
+  ldr r5, $0
+  ldr psw, $0 # the timer is not masked anymore
+timer_count:
+  add r5, r1
+  jmp timer_count
+
+timer_tick:
+  halt
+.end